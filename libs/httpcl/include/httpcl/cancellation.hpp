@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace httpcl
+{
+
+/**
+ * Thread-safe flag to cancel running requests. Transports register
+ * callbacks which abort their blocking socket operations on cancel().
+ */
+class CancellationToken
+{
+public:
+    using Callback = std::function<void()>;
+
+    /**
+     * Registration of a callback, which is removed on destruction.
+     */
+    class Subscription
+    {
+    public:
+        Subscription() = default;
+        Subscription(std::shared_ptr<CancellationToken> token, std::uint64_t id);
+        Subscription(Subscription&& other) noexcept;
+        Subscription& operator= (Subscription&& other) noexcept;
+        ~Subscription();
+
+    private:
+        std::shared_ptr<CancellationToken> token_;
+        std::uint64_t id_ = 0;
+    };
+
+    /**
+     * Set the cancelled flag and call all registered callbacks.
+     * Callbacks must not (un)subscribe on the same token.
+     */
+    void cancel();
+
+    bool cancelled() const {
+        return cancelled_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Register a callback for cancel(). If the token is already cancelled,
+     * the callback is called immediately.
+     */
+    static Subscription subscribe(std::shared_ptr<CancellationToken> const& token, Callback callback);
+
+private:
+    std::atomic<bool> cancelled_{false};
+    std::mutex mutex_;
+    std::uint64_t nextId_ = 1;
+    std::map<std::uint64_t, Callback> callbacks_;
+};
+
+/**
+ * Wait for the given duration. Returns false early if the token is cancelled.
+ */
+bool sleepUnlessCancelled(std::chrono::steady_clock::duration duration,
+                          std::shared_ptr<CancellationToken> const& cancellation);
+
+}
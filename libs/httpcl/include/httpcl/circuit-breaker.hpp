@@ -0,0 +1,125 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "http-settings.hpp"
+
+namespace httpcl
+{
+
+/**
+ * Circuit breaker for the requests to one origin.
+ *
+ * While closed, requests are sent and their outcomes are recorded. If the
+ * rate of failures (no response, 5xx, or too slow) in the recent requests
+ * exceeds the policy's threshold, the circuit opens, and requests fail
+ * immediately. After the open duration, the circuit is half-open: Single
+ * probe requests are sent, and the circuit closes again once enough of
+ * them succeeded. A failed probe opens the circuit again.
+ */
+class CircuitBreaker
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State {
+        Closed,
+        Open,
+        HalfOpen
+    };
+
+    enum class Outcome {
+        Success,
+        Failure,
+
+        /**
+         * The request was cancelled, and says nothing about the origin.
+         */
+        Ignored
+    };
+
+    /**
+     * Permission to send a request, which must be passed to record().
+     */
+    struct Permit
+    {
+        std::uint64_t generation = 0;
+        bool probe = false;
+    };
+
+    explicit CircuitBreaker(CircuitBreakerPolicy policy);
+
+    /**
+     * Ask for permission to send a request. Returns nothing
+     * while the circuit is open, or while a probe is running.
+     */
+    std::optional<Permit> tryAcquire(Clock::time_point now = Clock::now());
+
+    /**
+     * Record the outcome of a request. Outcomes of requests which were
+     * permitted before the last state change are ignored.
+     */
+    void record(Permit const& permit, Outcome outcome, Clock::time_point now = Clock::now());
+
+    State state() const;
+
+    CircuitBreakerPolicy const& policy() const {
+        return policy_;
+    }
+
+private:
+    void transition(State state, Clock::time_point now);
+
+    const CircuitBreakerPolicy policy_;
+
+    mutable std::mutex mutex_;
+    State state_ = State::Closed;
+    std::uint64_t generation_ = 0;
+    Clock::time_point openedAt_;
+
+    // Ring buffer of recent outcomes while closed.
+    std::vector<bool> failed_;
+    std::size_t next_ = 0;
+    std::size_t count_ = 0;
+    std::size_t failures_ = 0;
+
+    // Probe state while half-open.
+    bool probeRunning_ = false;
+    unsigned probeSuccesses_ = 0;
+};
+
+/**
+ * Get the name of a circuit state, e.g. "half-open".
+ */
+std::string to_string(CircuitBreaker::State state);
+
+/**
+ * Circuit breakers of all origins which a transport talks to.
+ */
+class CircuitBreakers
+{
+public:
+    /**
+     * Get the circuit breaker of an origin (scheme, host and port).
+     * It is created with the given policy on first use.
+     */
+    std::shared_ptr<CircuitBreaker> get(std::string const& origin, CircuitBreakerPolicy const& policy);
+
+    /**
+     * Current state of each circuit.
+     */
+    std::map<std::string, CircuitBreaker::State> states() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<CircuitBreaker>> breakers_;
+};
+
+}
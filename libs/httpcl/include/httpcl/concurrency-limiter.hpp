@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "cancellation.hpp"
+#include "http-settings.hpp"
+
+namespace httpcl
+{
+
+/**
+ * Adaptive limit for the number of concurrent requests to one origin.
+ *
+ * The limit follows the gradient between the long-term and the recent
+ * round-trip time: While recent requests are not slower than the long-term
+ * average (times the policy's tolerance), the limit grows by about its
+ * square root per request. If they get slower, or fail, it shrinks. The
+ * limit only changes while it is actually used, so an idle origin keeps
+ * its limit. Requests beyond the limit wait for a free slot, up to the
+ * policy's maximum wait time.
+ */
+class ConcurrencyLimiter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Outcome {
+        Success,
+
+        /**
+         * The origin did not answer, or answered with a 5xx status.
+         */
+        Dropped,
+
+        /**
+         * The request was cancelled, and says nothing about the origin.
+         */
+        Ignored
+    };
+
+    struct Stats
+    {
+        unsigned limit = 0;
+        unsigned inFlight = 0;
+        unsigned queued = 0;
+
+        /**
+         * Number of requests which were rejected after waiting.
+         */
+        std::uint64_t shed = 0;
+    };
+
+    explicit ConcurrencyLimiter(ConcurrencyLimitPolicy policy);
+
+    /**
+     * Wait for a free slot until the given point in time. Returns
+     * false if there was none, or if the token was cancelled.
+     */
+    bool acquire(Clock::time_point waitUntil,
+                 std::shared_ptr<CancellationToken> const& cancellation = {});
+
+    /**
+     * Free the slot of a request, and adapt the limit to its outcome.
+     */
+    void release(Outcome outcome, Clock::duration rtt);
+
+    Stats stats() const;
+
+    ConcurrencyLimitPolicy const& policy() const {
+        return policy_;
+    }
+
+private:
+    const ConcurrencyLimitPolicy policy_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable freed_;
+    double limit_;
+    unsigned inFlight_ = 0;
+    unsigned queued_ = 0;
+    std::uint64_t shed_ = 0;
+
+    // Smoothed round-trip times in microseconds, zero until measured.
+    double shortRtt_ = 0.;
+    double longRtt_ = 0.;
+};
+
+/**
+ * Concurrency limiters of all origins which a transport talks to.
+ */
+class ConcurrencyLimiters
+{
+public:
+    /**
+     * Get the limiter of an origin (scheme, host and port).
+     * It is created with the given policy on first use.
+     */
+    std::shared_ptr<ConcurrencyLimiter> get(std::string const& origin, ConcurrencyLimitPolicy const& policy);
+
+    /**
+     * Current limit and load of each origin.
+     */
+    std::map<std::string, ConcurrencyLimiter::Stats> stats() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<ConcurrencyLimiter>> limiters_;
+};
+
+}
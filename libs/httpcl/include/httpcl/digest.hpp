@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace httpcl
+{
+
+/**
+ * SHA-256 digest (32 raw bytes) of some data. Used to tell secrets
+ * apart, e.g. in cache keys, without keeping them in plain text.
+ * Throws if the digest cannot be computed.
+ */
+std::string sha256(std::string_view data);
+
+}
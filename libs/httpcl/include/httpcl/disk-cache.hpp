@@ -0,0 +1,121 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "http-settings.hpp"
+
+namespace httpcl
+{
+
+/**
+ * Persistent cache of HTTP responses in a directory, which may be
+ * shared by several processes on the same machine.
+ *
+ * Responses are appended to segment files (`segment-<n>.dat`), which are
+ * never modified afterwards, and read through memory mappings. Their
+ * locations and expiry times are appended to an index file (`index`).
+ * A lock file serializes writers across processes. Readers only take
+ * the lock to pick up new index entries. Once the segments exceed the
+ * size limit, the oldest segments are deleted. The index is compacted
+ * when most of its entries are outdated.
+ *
+ * Keys are only stored as their SHA-256 digests, and the directory and
+ * its files are only accessible by their owner.
+ *
+ * Not supported on Windows, where the constructor throws.
+ */
+class DiskCache
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+    /**
+     * Zero-copy view of a stored response. The content points into
+     * a memory-mapped segment, which stays mapped while the view
+     * (or a copy of it) exists.
+     */
+    struct View
+    {
+        std::shared_ptr<const void> mapping;
+        int status = 0;
+        std::string_view content;
+        Headers headers;
+        Clock::time_point expires;
+    };
+
+    /**
+     * Open (or create) the cache in the given directory.
+     * Throws if the directory is not usable.
+     */
+    DiskCache(std::filesystem::path dir, std::uint64_t maxBytes);
+    ~DiskCache();
+
+    /**
+     * Get the latest stored response for the key,
+     * also if it is stale. Returns nothing on a miss.
+     */
+    std::optional<View> lookup(std::string const& key);
+
+    /**
+     * Append a response. Responses which are larger
+     * than a segment are not stored.
+     */
+    void store(std::string const& key,
+               int status,
+               std::string_view content,
+               Headers const& headers,
+               Clock::time_point expires);
+
+    /**
+     * Update the expiry time of the stored response for the key,
+     * e.g. after it was revalidated. Returns false on a miss.
+     */
+    bool touch(std::string const& key, Clock::time_point expires);
+
+    /**
+     * Total size of the segment files.
+     */
+    std::uint64_t bytes() const;
+
+private:
+    struct Location
+    {
+        std::uint32_t segment = 0;
+        std::uint64_t offset = 0;
+        std::uint64_t size = 0;
+        std::int64_t expires = 0;
+    };
+
+    struct Segment;
+
+    void refresh(bool exclusive);
+    void appendIndex(std::uint64_t hash, Location const& location);
+    void evict();
+    void compact();
+    std::optional<View> read(std::string const& digest, Location const& location);
+    std::filesystem::path segmentPath(std::uint32_t segment) const;
+
+    const std::filesystem::path dir_;
+    const std::uint64_t maxBytes_;
+    const std::uint64_t segmentBytes_;
+
+    mutable std::mutex mutex_;
+    int lockFd_ = -1;
+    int indexFd_ = -1;
+    std::uint64_t indexInode_ = 0;
+    std::uint64_t indexOffset_ = 0;
+    std::uint64_t indexRecords_ = 0;
+    std::unordered_map<std::uint64_t, Location> index_;
+    std::map<std::uint32_t, std::shared_ptr<Segment>> segments_;
+};
+
+}
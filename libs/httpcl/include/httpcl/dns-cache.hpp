@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace httpcl
+{
+
+/**
+ * Cache of resolved host addresses, shared by all connections.
+ *
+ * A host is resolved on first use, which blocks the caller. Its addresses
+ * are then used for the TTL. Shortly before they expire, they are resolved
+ * again by a background thread, so callers are not blocked while the host
+ * is in use. Each call returns the next of the host's addresses, so new
+ * connections are spread over all of them. If resolving fails, the previous
+ * addresses are kept for a while.
+ */
+class DnsCache
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Get the IP addresses of a host. May throw or return
+     * nothing if the host cannot be resolved.
+     */
+    using Resolver = std::function<std::vector<std::string>(std::string const& host)>;
+
+    /**
+     * Resolve a host with getaddrinfo().
+     */
+    static std::vector<std::string> systemResolver(std::string const& host);
+
+    explicit DnsCache(Resolver resolver = systemResolver,
+                      Clock::duration ttl = std::chrono::seconds(60));
+    ~DnsCache();
+
+    /**
+     * Process-wide cache, with the TTL from HTTP_DNS_TTL (in seconds,
+     * default 60). Returns nothing if HTTP_DNS_TTL is 0.
+     */
+    static std::shared_ptr<DnsCache> shared();
+
+    /**
+     * Get the next address of a host, or nothing if it cannot be resolved.
+     */
+    std::optional<std::string> resolve(std::string const& host, Clock::time_point now = Clock::now());
+
+    /**
+     * Replace the resolver, e.g. by a static one for tests,
+     * and forget all cached addresses.
+     */
+    void setResolver(Resolver resolver);
+
+    Clock::duration ttl() const;
+
+private:
+    struct Entry
+    {
+        std::vector<std::string> addresses;
+        Clock::time_point expires;
+        std::size_t next = 0;
+        bool refreshing = false;
+    };
+
+    std::vector<std::string> lookup(std::string const& host);
+    void refreshLoop();
+
+    const Clock::duration ttl_;
+
+    mutable std::mutex mutex_;
+    Resolver resolver_;
+    std::map<std::string, Entry> entries_;
+
+    std::condition_variable refreshCondition_;
+    std::deque<std::string> refreshQueue_;
+    std::thread refreshThread_;
+    bool stopped_ = false;
+};
+
+}
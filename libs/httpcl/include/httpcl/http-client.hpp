@@ -9,6 +9,11 @@
 #include <stdexcept>
 
 #include "http-settings.hpp"
+#include "circuit-breaker.hpp"
+#include "concurrency-limiter.hpp"
+#include "dns-cache.hpp"
+#include "rate-limiter.hpp"
+#include "response-cache.hpp"
 #include "uri.hpp"
 #include "log.hpp"
 
@@ -27,8 +32,21 @@ class IHttpClient
 public:
 
     struct Result {
-        int status;
+        int status = 0;
         std::string content;
+        Headers headers;
+
+        Result(int status = 0, std::string content = {}, Headers headers = {})
+            : status(status)
+            , content(std::move(content))
+            , headers(std::move(headers))
+        {}
+
+        /**
+         * Get the first value of a response header, matching the
+         * name case-insensitively.
+         */
+        std::optional<std::string> header(std::string_view name) const;
     };
 
     struct Error : std::runtime_error {
@@ -42,8 +60,73 @@ public:
         }
     };
 
+    /**
+     * Thrown instead of sending a request while the
+     * circuit breaker of its origin is open.
+     */
+    struct CircuitOpenError : Error {
+        std::string origin;
+
+        explicit CircuitOpenError(std::string origin);
+    };
+
+    /**
+     * Thrown instead of sending a request which did not get a slot
+     * of its origin's concurrency limit in time.
+     */
+    struct ConcurrencyLimitError : Error {
+        std::string origin;
+
+        explicit ConcurrencyLimitError(std::string origin);
+    };
+
+    /**
+     * Thrown instead of sending a request whose turn in the rate
+     * limit of its origin (or operation) would come too late.
+     */
+    struct RateLimitError : Error {
+        std::string key;
+
+        explicit RateLimitError(std::string key);
+    };
+
     virtual ~IHttpClient() = default;
 
+    /**
+     * Current circuit breaker state of each origin, if the
+     * transport has circuit breakers. See CircuitBreakerPolicy.
+     */
+    virtual std::map<std::string, CircuitBreaker::State> circuitStates() const {
+        return {};
+    }
+
+    /**
+     * Current concurrency limit and load of each origin, if the transport
+     * limits concurrent requests. See ConcurrencyLimitPolicy.
+     */
+    virtual std::map<std::string, ConcurrencyLimiter::Stats> concurrencyLimits() const {
+        return {};
+    }
+
+    /**
+     * Statistics of the response cache, if the transport
+     * has one. See Config::responseCache.
+     */
+    virtual std::optional<ResponseCache::Stats> cacheStats() const {
+        return {};
+    }
+
+    /**
+     * Open connections to the origin of a URI in advance, e.g. at startup,
+     * and keep them for later requests. Returns the number of connections
+     * which were opened. Transports without connection reuse open none.
+     */
+    virtual std::size_t preconnect(const std::string& uri,
+                                   const Config& config,
+                                   std::size_t connections) {
+        return 0;
+    }
+
     virtual Result get(const std::string& path,
                        const Config& config) = 0;
     virtual Result post(const std::string& path,
@@ -60,10 +143,27 @@ public:
                          const Config& config) = 0;
 };
 
+/**
+ * IHttpClient implementation based on cpp-httplib.
+ * Connections are kept alive and pooled per host (and proxy), so a single
+ * instance may be shared by many clients and threads. Headers, timeouts,
+ * deadline and cancellation are taken from the Config of each request.
+ * If the Config has a circuit breaker policy, requests to an origin
+ * which keeps failing are rejected with a CircuitOpenError. With a
+ * concurrency limit policy, requests which do not get a slot in time
+ * are rejected with a ConcurrencyLimitError. With a rate limit policy,
+ * requests are paced, or rejected with a RateLimitError. With
+ * Config::responseCache, GET responses are cached in memory according
+ * to their caching headers, up to HTTP_CACHE_MAX_BYTES (default 64 MiB).
+ * New connections use the addresses of the shared DnsCache. Use
+ * preconnect() to open pooled connections (including the TLS handshake)
+ * before the first request.
+ */
 class HttpLibHttpClient : public IHttpClient
 {
 public:
     HttpLibHttpClient();
+    ~HttpLibHttpClient() override;
 
     Result get(const std::string& uri,
                const Config& config) override;
@@ -79,9 +179,57 @@ public:
     Result patch(const std::string& uri,
                  const OptionalBodyAndContentType& body,
                  const Config& config) override;
+
+    std::map<std::string, CircuitBreaker::State> circuitStates() const override;
+    std::map<std::string, ConcurrencyLimiter::Stats> concurrencyLimits() const override;
+    std::optional<ResponseCache::Stats> cacheStats() const override;
+
+    /**
+     * Open connections in parallel with a HEAD request to the URI, until
+     * the pool has the given number of idle connections to its origin.
+     * At most HTTP_MAX_IDLE_CONNECTIONS are kept.
+     */
+    std::size_t preconnect(const std::string& uri,
+                           const Config& config,
+                           std::size_t connections) override;
+
 private:
+    struct ConnectionPool;
+
+    /**
+     * Serve a GET request from the response cache, revalidating
+     * stale responses, and store the response if it is cacheable.
+     */
+    Result getCached(const std::string& uri,
+                     const Config& config);
+
+    /**
+     * Send a request, honoring the deadline, cancellation token, circuit
+     * breaker, rate limit and concurrency limit of the config.
+     */
+    Result send(const char* method,
+                const std::string& uri,
+                const OptionalBodyAndContentType& body,
+                const Config& config);
+
+    /**
+     * Send a request on a pooled connection, with
+     * timeouts which end at the deadline.
+     */
+    Result transmit(const char* method,
+                    const URIComponents& uri,
+                    const OptionalBodyAndContentType& body,
+                    const Config& config,
+                    const std::optional<std::chrono::steady_clock::time_point>& deadline);
+
     time_t timeoutSecs_ = 60.;
     bool sslCertStrict_ = false;
+    std::unique_ptr<ConnectionPool> pool_;
+    std::unique_ptr<CircuitBreakers> breakers_;
+    std::unique_ptr<ConcurrencyLimiters> limiters_;
+    std::unique_ptr<RateLimiters> rateLimiters_;
+    std::unique_ptr<ResponseCache> cache_;
+    std::shared_ptr<DnsCache> dns_;
 };
 
 class MockHttpClient : public IHttpClient
@@ -96,6 +244,13 @@ public:
             OptionalBodyAndContentType const& /* body */,
             Config const& config /* config */
     )> postFun;
+    std::function<
+        std::size_t(std::string_view /* uri */, std::size_t /* connections */)
+    > preconnectFun;
+
+    std::size_t preconnect(const std::string& uri,
+                           const Config& config,
+                           std::size_t connections) override;
 
     Result get(const std::string& uri,
                const Config& config) override;
@@ -1,17 +1,231 @@
 #pragma once
 
 #include <httplib.h>
+#include <chrono>
 #include <optional>
 #include <map>
+#include <memory>
 #include <vector>
 #include <string>
 
+#include "key-value-list.hpp"
+#include "cancellation.hpp"
 
 namespace httpcl
 {
 
-using Headers = std::multimap<std::string, std::string>;
-using Query = std::multimap<std::string, std::string>;
+using Headers = KeyValueList<CaseInsensitiveEqual>;
+using Query = KeyValueList<std::equal_to<std::string_view>>;
+using Cookies = KeyValueList<std::equal_to<std::string_view>>;
+
+/**
+ * Timeouts of an HTTP request. Unset values fall back to
+ * the HTTP_TIMEOUT environment variable.
+ */
+struct Timeouts
+{
+    /**
+     * Time to establish a connection.
+     */
+    std::optional<std::chrono::milliseconds> connect;
+
+    /**
+     * Time to wait for the first byte of the response after sending
+     * the request, and between reads of the response.
+     */
+    std::optional<std::chrono::milliseconds> firstByte;
+
+    /**
+     * Time for the whole request, from connecting
+     * until the response is read completely.
+     */
+    std::optional<std::chrono::milliseconds> total;
+
+    /**
+     * Take over all values which are set in other.
+     */
+    Timeouts& operator |= (Timeouts const& other);
+
+    bool empty() const {
+        return !connect && !firstByte && !total;
+    }
+};
+
+/**
+ * Retry policy for failed requests of idempotent operations,
+ * which is applied by zswagcl::OpenAPIClient.
+ */
+struct RetryPolicy
+{
+    /**
+     * Maximum number of attempts, including the first one.
+     */
+    unsigned maxAttempts = 3;
+
+    /**
+     * Upper bound of the (randomized) backoff before the first retry.
+     * Doubled for each further retry.
+     */
+    std::chrono::milliseconds initialBackoff{100};
+
+    /**
+     * Upper bound of any backoff. A longer Retry-After
+     * response header is not waited for.
+     */
+    std::chrono::milliseconds maxBackoff{5000};
+
+    /**
+     * Number of retries which each request earns, i.e. the maximum
+     * fraction of retries in the traffic of a client.
+     */
+    double budget = 0.1;
+};
+
+/**
+ * Hedging policy for GET requests, which is applied by
+ * zswagcl::OpenAPIClient: If a request takes longer than the
+ * given latency percentile of its operation, a second identical
+ * request is sent, and the first response is used.
+ */
+struct HedgingPolicy
+{
+    /**
+     * Latency percentile of the operation (0-100), after
+     * which a hedged request is sent.
+     */
+    double percentile = 95.;
+
+    /**
+     * Minimum delay before a hedged request is sent.
+     */
+    std::chrono::milliseconds minDelay{10};
+
+    /**
+     * Number of hedged requests which each request earns, i.e. the
+     * maximum fraction of hedged requests in the traffic of a client.
+     */
+    double budget = 0.05;
+};
+
+/**
+ * Thresholds of the circuit breaker for an origin, see httpcl::CircuitBreaker.
+ */
+struct CircuitBreakerPolicy
+{
+    /**
+     * Fraction of failed requests in the window which opens the circuit.
+     */
+    double failureRate = 0.5;
+
+    /**
+     * Number of recent requests which are considered.
+     */
+    unsigned window = 20;
+
+    /**
+     * Minimum number of requests in the window before the circuit may open.
+     */
+    unsigned minRequests = 10;
+
+    /**
+     * Successful requests which take longer count as failures. Time spent
+     * waiting for the rate and concurrency limits is not counted.
+     */
+    std::optional<std::chrono::milliseconds> slowRequest;
+
+    /**
+     * Time for which the circuit stays open before probe requests are sent.
+     */
+    std::chrono::milliseconds openDuration{30000};
+
+    /**
+     * Number of probe requests which must succeed to close the circuit.
+     * Only one probe request is sent at a time.
+     */
+    unsigned probes = 1;
+};
+
+/**
+ * Bounds of the adaptive concurrency limit for an origin,
+ * see httpcl::ConcurrencyLimiter.
+ */
+struct ConcurrencyLimitPolicy
+{
+    /**
+     * Number of concurrent requests which are allowed before
+     * any latencies were measured.
+     */
+    unsigned initialLimit = 20;
+
+    unsigned minLimit = 1;
+    unsigned maxLimit = 200;
+
+    /**
+     * Factor by which the recent latency may exceed the long-term
+     * latency before the limit is lowered.
+     */
+    double tolerance = 2.;
+
+    /**
+     * Time for which a request waits for a free slot before it is shed.
+     */
+    std::chrono::milliseconds maxWait{100};
+};
+
+/**
+ * Request rate for an origin or an operation, see httpcl::RateLimiter.
+ */
+struct RateLimitPolicy
+{
+    /**
+     * Sustained number of requests per second.
+     */
+    double rate = 10.;
+
+    /**
+     * Number of requests which may be sent at once.
+     */
+    unsigned burst = 1;
+
+    /**
+     * Time for which a request waits for its turn. If its turn
+     * would come later, the request fails instead.
+     */
+    std::chrono::milliseconds maxWait{1000};
+};
+
+/**
+ * Balancing of calls over the servers of an OpenAPI spec, which is
+ * applied by zswagcl::OpenAPIClient if the spec has several servers.
+ */
+struct LoadBalancingPolicy
+{
+    enum class Strategy {
+        /** Each call goes to the next server. */
+        RoundRobin,
+        /** Each call goes to the server with the fewest outstanding calls. */
+        LeastOutstanding,
+        /**
+         * Each call goes to the better of two random servers, judged by
+         * their moving average latency and outstanding calls.
+         */
+        PowerOfTwoChoices
+    };
+
+    Strategy strategy = Strategy::RoundRobin;
+
+    /**
+     * Number of consecutive failed requests (no response
+     * or a 5xx status) after which a server is ejected.
+     */
+    unsigned maxFailures = 3;
+
+    /**
+     * Time for which an ejected server gets no calls, unless all
+     * servers are ejected. A failure after it ends ejects it again.
+     */
+    std::chrono::milliseconds ejectionTime{30000};
+};
 
 /**
  * Set of configs for an HTTP connection, including:
@@ -21,6 +235,11 @@ using Query = std::multimap<std::string, std::string>;
  *   - Optional Proxy-Config
  *   - Optional Basic-Auth
  *   - API-Key
+ *   - Timeouts
+ *   - Retry, hedging, circuit breaker, concurrency and rate limit policies
+ *   - Load balancing over the servers of an OpenAPI spec
+ *   - Coalescing of identical calls
+ *   - Deadline and cancellation of a single request
  */
 struct Config
 {
@@ -41,21 +260,61 @@ struct Config
         std::string keychain;
     };
 
-    std::map<std::string, std::string> cookies;
+    Cookies cookies;
     std::optional<BasicAuthentication> auth;
     std::optional<Proxy> proxy;
     std::optional<std::string> apiKey;
     Headers headers;
     Query query;
+    Timeouts timeouts;
+    std::optional<RetryPolicy> retry;
+    std::optional<HedgingPolicy> hedging;
+    std::optional<CircuitBreakerPolicy> circuitBreaker;
+    std::optional<ConcurrencyLimitPolicy> concurrencyLimit;
+    std::optional<RateLimitPolicy> rateLimit;
+    std::optional<LoadBalancingPolicy> loadBalancing;
+
+    /**
+     * Rate limits of OpenAPI operations by operationId. These are
+     * applied by the zswag clients, in addition to the rateLimit
+     * of the origin, which is applied by the transport.
+     */
+    std::map<std::string, RateLimitPolicy> operationRateLimits;
+
+    /**
+     * Let concurrent identical GET calls of idempotent OpenAPI
+     * operations share one request. Applied by the zswag clients.
+     */
+    std::optional<bool> coalesce;
 
     /**
-     * Merge this configuration with another.
+     * Keep GET responses in the in-memory cache of the transport,
+     * following their HTTP caching headers. See ResponseCache.
+     */
+    std::optional<bool> responseCache;
+
+    /**
+     * Point in time by which a request must be completed.
+     * Not stored in settings files.
+     */
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+
+    /**
+     * Token to cancel a running request. Not stored in settings files.
+     */
+    std::shared_ptr<CancellationToken> cancellation;
+
+    /**
+     * Merge this configuration with another. The earlier of
+     * both deadlines is kept.
      */
     Config& operator |= (Config const& other);
 
     /**
      * Apply this configuration to an httplib client.
      * May read keychain passwords which can block and require user interaction.
+     * Uses PreparedConfig::get(), so this only happens once per distinct
+     * cookie/auth/proxy configuration.
      */
     void apply(httplib::Client& cl) const;
 
@@ -66,6 +325,65 @@ struct Config
     std::string toYaml() const;
 };
 
+/**
+ * Immutable, ready-to-send form of the parts of a Config which are
+ * expensive to apply: The Cookie header, the basic-auth Authorization
+ * header (which may require a keychain lookup), and the proxy credentials.
+ * Plain headers and query parameters usually differ between requests,
+ * and are therefore taken from the Config when applying.
+ */
+struct PreparedConfig
+{
+    explicit PreparedConfig(Config const& config);
+
+    /**
+     * Get the prepared form of a config. Instances are cached, so
+     * identical cookie/auth/proxy configurations are prepared only once.
+     * Instances with a password from the keychain are prepared again
+     * after five minutes, so that changed passwords are picked up.
+     * Thread-safe.
+     */
+    static std::shared_ptr<const PreparedConfig> get(Config const& config);
+
+    /**
+     * Drop the cached prepared form of a config, e.g. because the server
+     * rejected its credentials with `401` or `407`. Thread-safe.
+     */
+    static void invalidate(Config const& config);
+
+    /**
+     * Get the headers of the given config, followed by the prepared headers.
+     */
+    httplib::Headers requestHeaders(Config const& config) const;
+
+    /**
+     * Apply the proxy settings to an httplib client.
+     */
+    void applyProxy(httplib::Client& cl) const;
+
+    /**
+     * Apply the request headers and proxy settings to an httplib client.
+     */
+    void apply(Config const& config, httplib::Client& cl) const;
+
+    /**
+     * Cookie and Authorization headers.
+     */
+    std::vector<std::pair<std::string, std::string>> headers;
+
+    /**
+     * Proxy with the password read from the keychain, if needed.
+     */
+    std::optional<Config::Proxy> proxy;
+
+    /**
+     * SHA-256 digest of the basic-auth user and resolved password,
+     * which tells apart requests with different credentials, e.g. in
+     * cache keys. Empty without basic authentication.
+     */
+    std::string authDigest;
+};
+
 /**
  * Loads settings from HTTP_SETTINGS_FILE.
  * Allows returning config for a specific URL.
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace httpcl
+{
+
+/**
+ * Key comparison for HTTP header names, which are case-insensitive.
+ */
+struct CaseInsensitiveEqual
+{
+    bool operator() (std::string_view a, std::string_view b) const {
+        return a.size() == b.size() &&
+            std::equal(a.begin(), a.end(), b.begin(), [](char l, char r) {
+                return std::tolower(static_cast<unsigned char>(l)) ==
+                       std::tolower(static_cast<unsigned char>(r));
+            });
+    }
+};
+
+/**
+ * List of key-value pairs, e.g. HTTP headers or query parameters.
+ *
+ * Entries are stored contiguously in insertion order, and looked up
+ * with a linear scan using KeyEqual. Like a std::multimap, insert()
+ * appends a value even if its key is already present. Compared to the
+ * node-based std::multimap, copying and merging lists only needs a
+ * single allocation, which matters because the HTTP config of a request
+ * is assembled from several lists on every call.
+ */
+template <class KeyEqual>
+class KeyValueList
+{
+public:
+    using value_type = std::pair<std::string, std::string>;
+    using container_type = std::vector<value_type>;
+    using iterator = typename container_type::iterator;
+    using const_iterator = typename container_type::const_iterator;
+    using size_type = typename container_type::size_type;
+
+    KeyValueList() = default;
+
+    KeyValueList(std::initializer_list<value_type> values)
+        : entries_(values)
+    {}
+
+    template <class Iterator>
+    KeyValueList(Iterator first, Iterator last)
+        : entries_(first, last)
+    {}
+
+    iterator begin() { return entries_.begin(); }
+    iterator end() { return entries_.end(); }
+    const_iterator begin() const { return entries_.begin(); }
+    const_iterator end() const { return entries_.end(); }
+
+    size_type size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    void clear() { entries_.clear(); }
+    void reserve(size_type n) { entries_.reserve(n); }
+
+    /**
+     * Compare two keys like this list does.
+     */
+    static bool keyEquals(std::string_view a, std::string_view b) {
+        return KeyEqual{}(a, b);
+    }
+
+    /**
+     * Get the first entry with the given key, or end().
+     */
+    iterator find(std::string_view key) {
+        return std::find_if(begin(), end(), [&](auto const& entry) { return keyEquals(entry.first, key); });
+    }
+
+    const_iterator find(std::string_view key) const {
+        return std::find_if(begin(), end(), [&](auto const& entry) { return keyEquals(entry.first, key); });
+    }
+
+    size_type count(std::string_view key) const {
+        return std::count_if(begin(), end(), [&](auto const& entry) { return keyEquals(entry.first, key); });
+    }
+
+    /**
+     * Append an entry, also if the key is already present.
+     */
+    iterator insert(value_type value) {
+        entries_.emplace_back(std::move(value));
+        return std::prev(end());
+    }
+
+    template <class Iterator>
+    void insert(Iterator first, Iterator last) {
+        entries_.insert(end(), first, last);
+    }
+
+    iterator emplace(std::string key, std::string value) {
+        return insert({std::move(key), std::move(value)});
+    }
+
+    /**
+     * Append an entry, unless the key is already present.
+     * Returns the entry with the key, and whether it was inserted.
+     */
+    std::pair<iterator, bool> tryEmplace(std::string key, std::string value) {
+        if (auto it = find(key); it != end())
+            return {it, false};
+        return {insert({std::move(key), std::move(value)}), true};
+    }
+
+    /**
+     * Replace all entries with the given key by a single entry, which
+     * takes the position of the first one.
+     */
+    void set(std::string key, std::string value) {
+        auto it = find(key);
+        if (it == end()) {
+            insert({std::move(key), std::move(value)});
+            return;
+        }
+        auto newEnd = std::remove_if(std::next(it), end(), [&](auto const& entry) { return keyEquals(entry.first, key); });
+        entries_.erase(newEnd, end());
+        *it = {std::move(key), std::move(value)};
+    }
+
+    /**
+     * Remove all entries with the given key.
+     */
+    size_type erase(std::string_view key) {
+        auto newEnd = std::remove_if(begin(), end(), [&](auto const& entry) { return keyEquals(entry.first, key); });
+        auto removed = static_cast<size_type>(std::distance(newEnd, end()));
+        entries_.erase(newEnd, end());
+        return removed;
+    }
+
+    /**
+     * Append all entries of another list.
+     */
+    KeyValueList& operator |= (KeyValueList const& other) {
+        entries_.insert(end(), other.begin(), other.end());
+        return *this;
+    }
+
+    bool operator == (KeyValueList const& other) const {
+        return entries_ == other.entries_;
+    }
+
+    bool operator != (KeyValueList const& other) const {
+        return entries_ != other.entries_;
+    }
+
+private:
+    container_type entries_;
+};
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "cancellation.hpp"
+#include "http-settings.hpp"
+
+namespace httpcl
+{
+
+/**
+ * Token bucket which paces requests to the rate of a RateLimitPolicy.
+ *
+ * Up to `burst` requests may be sent at once. Further requests are
+ * spaced by 1/rate, and wait for their turn instead of being rejected,
+ * unless their turn would come later than they are willing to wait.
+ *
+ * The bucket also follows the quota which the server announces: After a
+ * `429` or `503` response with a `Retry-After` header, or once the
+ * `RateLimit-Remaining` header drops to zero, no requests are sent until
+ * the given time (or `RateLimit-Reset`) has passed. While the remaining
+ * quota is low, requests are spread evenly over the time until the reset.
+ */
+class RateLimiter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RateLimiter(RateLimitPolicy policy);
+
+    /**
+     * Reserve the next free turn, if it is now or not later than
+     * waitUntil. Returns the point in time at which the request may be sent.
+     */
+    std::optional<Clock::time_point> reserve(Clock::time_point waitUntil,
+                                             Clock::time_point now = Clock::now());
+
+    /**
+     * Reserve the next free turn, and wait for it. Returns false if
+     * the turn is later than waitUntil, or if the token was cancelled.
+     */
+    bool acquire(Clock::time_point waitUntil,
+                 std::shared_ptr<CancellationToken> const& cancellation = {});
+
+    /**
+     * Adapt to the rate limit headers of a response.
+     */
+    void update(int status, Headers const& headers, Clock::time_point now = Clock::now());
+
+    RateLimitPolicy const& policy() const {
+        return policy_;
+    }
+
+private:
+    const RateLimitPolicy policy_;
+    const Clock::duration interval_;
+
+    std::mutex mutex_;
+
+    // Theoretical arrival time of the next request, see GCRA.
+    Clock::time_point next_;
+
+    // Server-announced pause, and pacing until the quota resets.
+    Clock::time_point blockedUntil_;
+    Clock::time_point pacedUntil_;
+    Clock::duration pacedInterval_{};
+};
+
+/**
+ * Rate limiters by key, e.g. per origin or per operation.
+ */
+class RateLimiters
+{
+public:
+    /**
+     * Get the rate limiter for a key. It is created
+     * with the given policy on first use.
+     */
+    std::shared_ptr<RateLimiter> get(std::string const& key, RateLimitPolicy const& policy);
+
+private:
+    std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<RateLimiter>> limiters_;
+};
+
+/**
+ * Parse an HTTP date, e.g. "Wed, 21 Oct 2015 07:28:00 GMT".
+ * Returns nothing if the value is invalid.
+ */
+std::optional<std::chrono::system_clock::time_point> parseHttpDate(std::string const& value);
+
+/**
+ * Parse the value of a Retry-After header, which is either a number of
+ * seconds or an HTTP date. Returns nothing if the value is invalid.
+ */
+std::optional<std::chrono::milliseconds> parseRetryAfter(
+    std::string const& value,
+    std::chrono::system_clock::time_point now = std::chrono::system_clock::now());
+
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "disk-cache.hpp"
+#include "http-settings.hpp"
+
+namespace httpcl
+{
+
+/**
+ * In-memory cache of GET responses which follows the HTTP caching
+ * headers of the responses, bounded by the total size of its entries.
+ *
+ * A `200` response is stored if its `Cache-Control: max-age` or
+ * `Expires` header makes it fresh for some time, or if it has an `ETag`
+ * or `Last-Modified` validator. Responses with `Cache-Control: no-store`
+ * or `Vary: *` are not stored. Fresh responses are served without network
+ * access. Stale responses with a validator are revalidated with a
+ * conditional request, others are evicted. When the cache is full,
+ * the least recently used responses are evicted.
+ *
+ * With a DiskCache, stored responses are also written to disk, and
+ * responses which are not in memory are looked up there, so processes
+ * which share the cache directory benefit from each other's requests.
+ * Responses to requests with credentials are only written to disk if
+ * they are marked `Cache-Control: public`, and responses marked
+ * `Cache-Control: private` never are.
+ */
+class ResponseCache
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Response
+    {
+        int status = 0;
+        std::string content;
+        Headers headers;
+    };
+
+    struct Lookup
+    {
+        /**
+         * Stored response, or nothing on a miss.
+         */
+        std::shared_ptr<const Response> response;
+
+        /**
+         * Whether the response may be used without revalidation.
+         */
+        bool fresh = false;
+
+        /**
+         * For stale responses: Headers for a conditional request,
+         * i.e. If-None-Match and If-Modified-Since.
+         */
+        Headers conditions;
+    };
+
+    struct Stats
+    {
+        /**
+         * Lookups which found a fresh response.
+         */
+        std::uint64_t hits = 0;
+
+        /**
+         * Lookups which found no usable response.
+         */
+        std::uint64_t misses = 0;
+
+        /**
+         * Lookups which found a stale response which had to be revalidated,
+         * and how many of those were confirmed with `304 Not Modified`.
+         */
+        std::uint64_t revalidations = 0;
+        std::uint64_t notModified = 0;
+
+        /**
+         * Lookups which found the response in the disk cache,
+         * because it was not in memory.
+         */
+        std::uint64_t diskHits = 0;
+
+        std::size_t entries = 0;
+        std::size_t bytes = 0;
+    };
+
+    explicit ResponseCache(std::size_t maxBytes, std::shared_ptr<DiskCache> disk = {});
+
+    Lookup lookup(std::string const& key, Clock::time_point now = Clock::now());
+
+    /**
+     * Store a response, if it is cacheable. Replaces the
+     * stored response of the key in any case. Pass whether the
+     * request carried credentials, e.g. an Authorization header.
+     */
+    void store(std::string const& key,
+               Response response,
+               Clock::time_point now = Clock::now(),
+               bool credentials = false);
+
+    /**
+     * Handle a `304 Not Modified` response to a conditional request: Update
+     * the freshness of the stored response, and return it. Returns nothing
+     * if the response was evicted in the meantime.
+     */
+    std::shared_ptr<const Response> notModified(std::string const& key,
+                                                Headers const& headers,
+                                                Clock::time_point now = Clock::now());
+
+    Stats stats() const;
+
+    void clear();
+
+    /**
+     * Get the time for which a response with the given headers is fresh.
+     * Returns nothing if the response must not be stored.
+     */
+    static std::optional<Clock::duration> freshnessLifetime(Headers const& headers);
+
+private:
+    struct Entry
+    {
+        std::string key;
+        std::shared_ptr<const Response> response;
+        Clock::time_point expires;
+        std::size_t bytes = 0;
+    };
+
+    void insert(std::string const& key, Response response, Clock::time_point expires);
+    void evict(std::list<Entry>::iterator it);
+
+    const std::size_t maxBytes_;
+    const std::shared_ptr<DiskCache> disk_;
+
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    Stats stats_;
+};
+
+}
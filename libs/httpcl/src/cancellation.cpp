@@ -0,0 +1,85 @@
+#include "cancellation.hpp"
+
+#include <condition_variable>
+
+namespace httpcl
+{
+
+CancellationToken::Subscription::Subscription(std::shared_ptr<CancellationToken> token, std::uint64_t id)
+    : token_(std::move(token))
+    , id_(id)
+{}
+
+CancellationToken::Subscription::Subscription(Subscription&& other) noexcept
+    : token_(std::move(other.token_))
+    , id_(other.id_)
+{}
+
+CancellationToken::Subscription& CancellationToken::Subscription::operator= (Subscription&& other) noexcept
+{
+    if (this != &other) {
+        Subscription old(std::move(*this));
+        token_ = std::move(other.token_);
+        id_ = other.id_;
+    }
+    return *this;
+}
+
+CancellationToken::Subscription::~Subscription()
+{
+    if (!token_)
+        return;
+    std::lock_guard<std::mutex> lock(token_->mutex_);
+    token_->callbacks_.erase(id_);
+}
+
+void CancellationToken::cancel()
+{
+    // Callbacks run under the lock, so that a Subscription which is
+    // destroyed concurrently waits until its callback has returned.
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cancelled_.exchange(true, std::memory_order_acq_rel))
+        return;
+    for (auto const& [id, callback] : callbacks_)
+        callback();
+    callbacks_.clear();
+}
+
+CancellationToken::Subscription CancellationToken::subscribe(
+    std::shared_ptr<CancellationToken> const& token,
+    Callback callback)
+{
+    if (!token || !callback)
+        return {};
+
+    {
+        std::lock_guard<std::mutex> lock(token->mutex_);
+        if (!token->cancelled()) {
+            auto id = token->nextId_++;
+            token->callbacks_.emplace(id, std::move(callback));
+            return {token, id};
+        }
+    }
+
+    callback();
+    return {};
+}
+
+bool sleepUnlessCancelled(std::chrono::steady_clock::duration duration,
+                          std::shared_ptr<CancellationToken> const& cancellation)
+{
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    auto cancelled = false;
+
+    auto subscription = CancellationToken::subscribe(cancellation, [&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+        wakeUp.notify_all();
+    });
+
+    std::unique_lock<std::mutex> lock(mutex);
+    return !wakeUp.wait_for(lock, duration, [&] { return cancelled; });
+}
+
+}
@@ -0,0 +1,116 @@
+#include "circuit-breaker.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+
+namespace httpcl
+{
+
+CircuitBreaker::CircuitBreaker(CircuitBreakerPolicy policy)
+    : policy_(std::move(policy))
+    , failed_(std::max(policy_.window, 1u), false)
+{}
+
+std::optional<CircuitBreaker::Permit> CircuitBreaker::tryAcquire(Clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (state_ == State::Open) {
+        if (now - openedAt_ < policy_.openDuration)
+            return {};
+        transition(State::HalfOpen, now);
+    }
+
+    if (state_ == State::HalfOpen) {
+        if (probeRunning_)
+            return {};
+        probeRunning_ = true;
+        return Permit{generation_, true};
+    }
+
+    return Permit{generation_, false};
+}
+
+void CircuitBreaker::record(Permit const& permit, Outcome outcome, Clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (permit.generation != generation_)
+        return;
+
+    if (permit.probe) {
+        probeRunning_ = false;
+        if (outcome == Outcome::Failure)
+            transition(State::Open, now);
+        else if (outcome == Outcome::Success && ++probeSuccesses_ >= policy_.probes)
+            transition(State::Closed, now);
+        return;
+    }
+
+    if (outcome == Outcome::Ignored)
+        return;
+
+    // Replace the oldest outcome in the window.
+    if (count_ == failed_.size())
+        failures_ -= failed_[next_];
+    else
+        ++count_;
+    failed_[next_] = outcome == Outcome::Failure;
+    failures_ += failed_[next_];
+    next_ = (next_ + 1) % failed_.size();
+
+    if (count_ >= policy_.minRequests &&
+        static_cast<double>(failures_) >= policy_.failureRate * static_cast<double>(count_))
+        transition(State::Open, now);
+}
+
+CircuitBreaker::State CircuitBreaker::state() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return state_;
+}
+
+void CircuitBreaker::transition(State state, Clock::time_point now)
+{
+    state_ = state;
+    ++generation_;
+    if (state == State::Open)
+        openedAt_ = now;
+
+    std::fill(failed_.begin(), failed_.end(), false);
+    next_ = count_ = failures_ = 0;
+    probeRunning_ = false;
+    probeSuccesses_ = 0;
+}
+
+std::string to_string(CircuitBreaker::State state)
+{
+    switch (state) {
+    case CircuitBreaker::State::Closed:
+        return "closed";
+    case CircuitBreaker::State::Open:
+        return "open";
+    case CircuitBreaker::State::HalfOpen:
+        return "half-open";
+    }
+    return "unknown";
+}
+
+std::shared_ptr<CircuitBreaker> CircuitBreakers::get(std::string const& origin, CircuitBreakerPolicy const& policy)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& breaker = breakers_[origin];
+    if (!breaker)
+        breaker = std::make_shared<CircuitBreaker>(policy);
+    return breaker;
+}
+
+std::map<std::string, CircuitBreaker::State> CircuitBreakers::states() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, CircuitBreaker::State> result;
+    for (auto const& [origin, breaker] : breakers_)
+        result.emplace(origin, breaker->state());
+    return result;
+}
+
+}
@@ -0,0 +1,128 @@
+#include "concurrency-limiter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace httpcl
+{
+
+namespace
+{
+
+// Weights of a new sample in the recent (~10 requests)
+// and the long-term (~100 requests) round-trip time.
+constexpr auto SHORT_RTT_WEIGHT = 0.1;
+constexpr auto LONG_RTT_WEIGHT = 0.01;
+
+// Weight of a new limit estimate, and the decrease after a failure.
+constexpr auto LIMIT_SMOOTHING = 0.2;
+constexpr auto DROP_BACKOFF = 0.9;
+
+ConcurrencyLimitPolicy normalize(ConcurrencyLimitPolicy policy)
+{
+    policy.minLimit = std::max(policy.minLimit, 1u);
+    policy.maxLimit = std::max(policy.maxLimit, policy.minLimit);
+    policy.initialLimit = std::clamp(policy.initialLimit, policy.minLimit, policy.maxLimit);
+    return policy;
+}
+
+}
+
+ConcurrencyLimiter::ConcurrencyLimiter(ConcurrencyLimitPolicy policy)
+    : policy_(normalize(std::move(policy)))
+    , limit_(policy_.initialLimit)
+{}
+
+bool ConcurrencyLimiter::acquire(Clock::time_point waitUntil,
+                                 std::shared_ptr<CancellationToken> const& cancellation)
+{
+    // Wake up the waiting thread if the request is cancelled.
+    auto subscription = CancellationToken::subscribe(cancellation, [this] {
+        std::lock_guard<std::mutex> lock(mutex_);
+        freed_.notify_all();
+    });
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto const available = [this] {
+        return inFlight_ < static_cast<unsigned>(limit_);
+    };
+    auto const cancelled = [&cancellation] {
+        return cancellation && cancellation->cancelled();
+    };
+
+    if (!available()) {
+        ++queued_;
+        freed_.wait_until(lock, waitUntil, [&] { return available() || cancelled(); });
+        --queued_;
+    }
+
+    if (!available() || cancelled()) {
+        ++shed_;
+        return false;
+    }
+
+    ++inFlight_;
+    return true;
+}
+
+void ConcurrencyLimiter::release(Outcome outcome, Clock::duration rtt)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto const inFlight = inFlight_--;
+    freed_.notify_all();
+
+    if (outcome == Outcome::Ignored)
+        return;
+
+    // Don't adapt the limit to a load which did not reach it.
+    if (2 * inFlight < limit_)
+        return;
+
+    auto newLimit = limit_ * DROP_BACKOFF;
+    if (outcome == Outcome::Success) {
+        auto const sample = static_cast<double>(
+            std::max(std::chrono::duration_cast<std::chrono::microseconds>(rtt).count(), std::int64_t(1)));
+        if (longRtt_ == 0.)
+            shortRtt_ = longRtt_ = sample;
+        shortRtt_ += SHORT_RTT_WEIGHT * (sample - shortRtt_);
+        longRtt_ += LONG_RTT_WEIGHT * (sample - longRtt_);
+
+        // Let the long-term RTT recover quickly after an overload.
+        if (longRtt_ > 2. * shortRtt_)
+            longRtt_ *= 0.95;
+
+        auto const gradient = std::clamp(policy_.tolerance * longRtt_ / shortRtt_, 0.5, 1.);
+        newLimit = limit_ * gradient + std::sqrt(limit_);
+    }
+
+    limit_ = (1. - LIMIT_SMOOTHING) * limit_ + LIMIT_SMOOTHING * newLimit;
+    limit_ = std::clamp(limit_,
+                        static_cast<double>(policy_.minLimit),
+                        static_cast<double>(policy_.maxLimit));
+}
+
+ConcurrencyLimiter::Stats ConcurrencyLimiter::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {static_cast<unsigned>(limit_), inFlight_, queued_, shed_};
+}
+
+std::shared_ptr<ConcurrencyLimiter> ConcurrencyLimiters::get(std::string const& origin, ConcurrencyLimitPolicy const& policy)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& limiter = limiters_[origin];
+    if (!limiter)
+        limiter = std::make_shared<ConcurrencyLimiter>(policy);
+    return limiter;
+}
+
+std::map<std::string, ConcurrencyLimiter::Stats> ConcurrencyLimiters::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, ConcurrencyLimiter::Stats> result;
+    for (auto const& [origin, limiter] : limiters_)
+        result.emplace(origin, limiter->stats());
+    return result;
+}
+
+}
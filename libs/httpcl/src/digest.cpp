@@ -0,0 +1,18 @@
+#include "digest.hpp"
+#include "log.hpp"
+
+#include <openssl/evp.h>
+
+namespace httpcl
+{
+
+std::string sha256(std::string_view data)
+{
+    std::string result(32, '\0');
+    unsigned size = 0;
+    if (!EVP_Digest(data.data(), data.size(), reinterpret_cast<unsigned char*>(result.data()), &size, EVP_sha256(), nullptr))
+        throw logRuntimeError("Could not compute a SHA-256 digest.");
+    return result;
+}
+
+}
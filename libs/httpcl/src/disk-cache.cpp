@@ -0,0 +1,529 @@
+#include "disk-cache.hpp"
+#include "digest.hpp"
+#include "log.hpp"
+#include "stx/format.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace httpcl
+{
+
+#ifndef _WIN32
+
+namespace
+{
+
+constexpr std::string_view INDEX_MAGIC = "ZSWAGRCI";
+constexpr std::uint32_t INDEX_VERSION = 2;
+constexpr std::size_t INDEX_HEADER_SIZE = 16;
+constexpr std::size_t INDEX_RECORD_SIZE = 40;
+
+constexpr std::uint32_t RECORD_MAGIC = 0x5a524332; // "ZRC2"
+constexpr std::size_t RECORD_HEADER_SIZE = 24;
+
+constexpr auto DIR_MODE = 0700;
+constexpr auto FILE_MODE = 0600;
+
+/**
+ * SHA-256 digest of a cache key. Keys contain the credentials of
+ * the request, so only their digests are written to disk.
+ */
+std::string digestKey(std::string_view key)
+{
+    return sha256(key);
+}
+
+template <class Int>
+void put(std::string& out, Int value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <class Int>
+Int get(const char* data)
+{
+    Int result;
+    std::memcpy(&result, data, sizeof(result));
+    return result;
+}
+
+/**
+ * Index hash of a key digest.
+ */
+std::uint64_t hashDigest(std::string const& digest)
+{
+    return get<std::uint64_t>(digest.data());
+}
+
+std::int64_t toMillis(DiskCache::Clock::time_point time)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+/**
+ * Holds an flock() on a file while in scope. Locks are shared between
+ * the threads of a process, so the caller must also hold a mutex.
+ */
+class FileLock
+{
+public:
+    FileLock(int fd, bool exclusive) : fd_(fd) {
+        while (::flock(fd_, exclusive ? LOCK_EX : LOCK_SH) != 0)
+            if (errno != EINTR)
+                throw logRuntimeError("Could not lock the disk response cache.");
+    }
+
+    ~FileLock() {
+        ::flock(fd_, LOCK_UN);
+    }
+
+    FileLock(FileLock const&) = delete;
+    FileLock& operator= (FileLock const&) = delete;
+
+private:
+    int fd_;
+};
+
+bool writeAll(int fd, const char* data, std::size_t size)
+{
+    while (size > 0) {
+        auto written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+/**
+ * Sizes of the segment files in the cache directory, by segment number.
+ */
+std::map<std::uint32_t, std::uint64_t> listSegments(std::filesystem::path const& dir)
+{
+    std::map<std::uint32_t, std::uint64_t> result;
+    std::error_code ec;
+    for (auto const& entry : std::filesystem::directory_iterator(dir, ec)) {
+        auto name = entry.path().filename().string();
+        unsigned segment = 0;
+        char suffix[5] = {};
+        if (std::sscanf(name.c_str(), "segment-%u.%4s", &segment, suffix) != 2 || std::strcmp(suffix, "dat") != 0)
+            continue;
+        auto size = entry.file_size(ec);
+        if (!ec)
+            result[segment] = size;
+    }
+    return result;
+}
+
+}
+
+/**
+ * Read-only memory mapping of a segment file.
+ */
+struct DiskCache::Segment
+{
+    const char* data = nullptr;
+    std::size_t size = 0;
+
+    Segment(const char* data, std::size_t size) : data(data), size(size) {}
+
+    ~Segment() {
+        ::munmap(const_cast<char*>(data), size);
+    }
+};
+
+DiskCache::DiskCache(std::filesystem::path dir, std::uint64_t maxBytes)
+    : dir_(std::move(dir))
+    , maxBytes_(maxBytes)
+    , segmentBytes_(std::max<std::uint64_t>(maxBytes / 8, 1))
+{
+    // Only the owner may read the cached responses.
+    std::error_code ec;
+    std::filesystem::create_directories(dir_.parent_path(), ec);
+    ::mkdir(dir_.c_str(), DIR_MODE);
+    lockFd_ = ::open((dir_ / "lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, FILE_MODE);
+    if (lockFd_ < 0)
+        throw logRuntimeError(stx::format("Could not open the disk response cache in '{}'.", dir_.string()));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    FileLock fileLock(lockFd_, true);
+    refresh(true);
+}
+
+DiskCache::~DiskCache()
+{
+    if (indexFd_ >= 0)
+        ::close(indexFd_);
+    ::close(lockFd_);
+}
+
+std::optional<DiskCache::View> DiskCache::lookup(std::string const& key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Only take the file lock if another process changed the index.
+    struct stat indexStat{};
+    if (::stat((dir_ / "index").c_str(), &indexStat) != 0 ||
+        static_cast<std::uint64_t>(indexStat.st_ino) != indexInode_ ||
+        static_cast<std::uint64_t>(indexStat.st_size) != indexOffset_) {
+        FileLock fileLock(lockFd_, false);
+        refresh(false);
+    }
+
+    auto digest = digestKey(key);
+    auto it = index_.find(hashDigest(digest));
+    if (it == index_.end())
+        return {};
+    return read(digest, it->second);
+}
+
+void DiskCache::store(std::string const& key,
+                      int status,
+                      std::string_view content,
+                      Headers const& headers,
+                      Clock::time_point expires)
+{
+    std::string serializedHeaders;
+    for (auto const& [name, value] : headers) {
+        put<std::uint32_t>(serializedHeaders, name.size());
+        serializedHeaders += name;
+        put<std::uint32_t>(serializedHeaders, value.size());
+        serializedHeaders += value;
+    }
+
+    auto digest = digestKey(key);
+    std::string record;
+    record.reserve(RECORD_HEADER_SIZE + digest.size() + serializedHeaders.size() + content.size());
+    put<std::uint32_t>(record, RECORD_MAGIC);
+    put<std::int32_t>(record, status);
+    put<std::uint32_t>(record, digest.size());
+    put<std::uint32_t>(record, serializedHeaders.size());
+    put<std::uint64_t>(record, content.size());
+    record += digest;
+    record += serializedHeaders;
+    record += content;
+    if (record.size() > segmentBytes_)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    FileLock fileLock(lockFd_, true);
+    refresh(true);
+
+    // Append to the newest segment, or start a new one if it is full.
+    auto segments = listSegments(dir_);
+    std::uint32_t segment = 0;
+    if (!segments.empty()) {
+        auto const& [newest, size] = *segments.rbegin();
+        segment = size + record.size() > segmentBytes_ ? newest + 1 : newest;
+    }
+
+    auto fd = ::open(segmentPath(segment).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, FILE_MODE);
+    if (fd < 0) {
+        log().warn("Could not write to the disk response cache in '{}'.", dir_.string());
+        return;
+    }
+    struct stat segmentStat{};
+    auto ok = ::fstat(fd, &segmentStat) == 0 && writeAll(fd, record.data(), record.size());
+    ::close(fd);
+    if (!ok) {
+        log().warn("Could not write to the disk response cache in '{}'.", dir_.string());
+        return;
+    }
+
+    // Only make the record visible once it is completely written.
+    appendIndex(hashDigest(digest), {segment, static_cast<std::uint64_t>(segmentStat.st_size), record.size(), toMillis(expires)});
+    evict();
+    if (indexRecords_ > 2 * index_.size() + 1024)
+        compact();
+}
+
+bool DiskCache::touch(std::string const& key, Clock::time_point expires)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    FileLock fileLock(lockFd_, true);
+    refresh(true);
+
+    auto hash = hashDigest(digestKey(key));
+    auto it = index_.find(hash);
+    if (it == index_.end() || !std::filesystem::exists(segmentPath(it->second.segment)))
+        return false;
+
+    auto location = it->second;
+    location.expires = toMillis(expires);
+    appendIndex(hash, location);
+    return true;
+}
+
+std::uint64_t DiskCache::bytes() const
+{
+    std::uint64_t result = 0;
+    for (auto const& [segment, size] : listSegments(dir_))
+        result += size;
+    return result;
+}
+
+void DiskCache::refresh(bool exclusive)
+{
+    auto const path = dir_ / "index";
+
+    // The index is replaced by compaction. Start over if it was.
+    struct stat indexStat{};
+    auto exists = ::stat(path.c_str(), &indexStat) == 0;
+    if (indexFd_ < 0 || !exists || static_cast<std::uint64_t>(indexStat.st_ino) != indexInode_) {
+        if (!exists && !exclusive)
+            return;
+        if (indexFd_ >= 0)
+            ::close(indexFd_);
+        indexFd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, FILE_MODE);
+        if (indexFd_ < 0 || ::fstat(indexFd_, &indexStat) != 0)
+            throw logRuntimeError(stx::format("Could not open the disk response cache index in '{}'.", dir_.string()));
+        indexInode_ = indexStat.st_ino;
+        indexOffset_ = 0;
+        indexRecords_ = 0;
+        index_.clear();
+    }
+
+    auto size = static_cast<std::uint64_t>(indexStat.st_size);
+    if (indexOffset_ == 0) {
+        char header[INDEX_HEADER_SIZE] = {};
+        auto valid = size >= INDEX_HEADER_SIZE &&
+            ::pread(indexFd_, header, INDEX_HEADER_SIZE, 0) == static_cast<ssize_t>(INDEX_HEADER_SIZE) &&
+            std::string_view(header, INDEX_MAGIC.size()) == INDEX_MAGIC &&
+            get<std::uint32_t>(header + 8) == INDEX_VERSION;
+        if (!valid) {
+            // A new index, or one which was written by another version.
+            if (!exclusive)
+                return;
+            std::string newHeader(INDEX_MAGIC);
+            put<std::uint32_t>(newHeader, INDEX_VERSION);
+            put<std::uint32_t>(newHeader, 0);
+            if (::ftruncate(indexFd_, 0) != 0 || !writeAll(indexFd_, newHeader.data(), newHeader.size()))
+                throw logRuntimeError(stx::format("Could not write the disk response cache index in '{}'.", dir_.string()));
+            size = INDEX_HEADER_SIZE;
+        }
+        indexOffset_ = INDEX_HEADER_SIZE;
+    }
+
+    // Ignore a partially written record, and drop it before appending.
+    auto end = indexOffset_ + (size - std::min(size, indexOffset_)) / INDEX_RECORD_SIZE * INDEX_RECORD_SIZE;
+    if (exclusive && end != size && ::ftruncate(indexFd_, static_cast<off_t>(end)) != 0)
+        throw logRuntimeError(stx::format("Could not repair the disk response cache index in '{}'.", dir_.string()));
+    if (end <= indexOffset_)
+        return;
+
+    std::string records(end - indexOffset_, '\0');
+    if (::pread(indexFd_, records.data(), records.size(), static_cast<off_t>(indexOffset_)) != static_cast<ssize_t>(records.size()))
+        throw logRuntimeError(stx::format("Could not read the disk response cache index in '{}'.", dir_.string()));
+
+    for (std::size_t pos = 0; pos < records.size(); pos += INDEX_RECORD_SIZE) {
+        auto record = records.data() + pos;
+        index_[get<std::uint64_t>(record)] = {
+            get<std::uint32_t>(record + 8),
+            get<std::uint64_t>(record + 16),
+            get<std::uint64_t>(record + 24),
+            get<std::int64_t>(record + 32)};
+        ++indexRecords_;
+    }
+    indexOffset_ = end;
+}
+
+void DiskCache::appendIndex(std::uint64_t hash, Location const& location)
+{
+    std::string record;
+    put<std::uint64_t>(record, hash);
+    put<std::uint32_t>(record, location.segment);
+    put<std::uint32_t>(record, 0);
+    put<std::uint64_t>(record, location.offset);
+    put<std::uint64_t>(record, location.size);
+    put<std::int64_t>(record, location.expires);
+
+    if (!writeAll(indexFd_, record.data(), record.size())) {
+        log().warn("Could not write the disk response cache index in '{}'.", dir_.string());
+        return;
+    }
+    index_[hash] = location;
+    indexOffset_ += INDEX_RECORD_SIZE;
+    ++indexRecords_;
+}
+
+void DiskCache::evict()
+{
+    auto segments = listSegments(dir_);
+    std::uint64_t total = 0;
+    for (auto const& [segment, size] : segments)
+        total += size;
+
+    // Delete the oldest segments, but keep the one which is written to.
+    while (total > maxBytes_ && segments.size() > 1) {
+        auto const [segment, size] = *segments.begin();
+        std::error_code ec;
+        std::filesystem::remove(segmentPath(segment), ec);
+        segments_.erase(segment);
+        segments.erase(segments.begin());
+        total -= size;
+    }
+}
+
+void DiskCache::compact()
+{
+    auto segments = listSegments(dir_);
+    for (auto it = index_.begin(); it != index_.end();) {
+        if (segments.count(it->second.segment))
+            ++it;
+        else
+            it = index_.erase(it);
+    }
+
+    auto const path = dir_ / "index";
+    auto const tmpPath = dir_ / stx::format("index.{}.tmp", ::getpid());
+    auto fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, FILE_MODE);
+    if (fd < 0)
+        return;
+
+    std::string content(INDEX_MAGIC);
+    put<std::uint32_t>(content, INDEX_VERSION);
+    put<std::uint32_t>(content, 0);
+    for (auto const& [hash, location] : index_) {
+        put<std::uint64_t>(content, hash);
+        put<std::uint32_t>(content, location.segment);
+        put<std::uint32_t>(content, 0);
+        put<std::uint64_t>(content, location.offset);
+        put<std::uint64_t>(content, location.size);
+        put<std::int64_t>(content, location.expires);
+    }
+
+    struct stat indexStat{};
+    auto ok = writeAll(fd, content.data(), content.size()) && ::fstat(fd, &indexStat) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ::unlink(tmpPath.c_str());
+        log().warn("Could not compact the disk response cache index in '{}'.", dir_.string());
+        return;
+    }
+
+    ::close(indexFd_);
+    indexFd_ = ::open(path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+    indexInode_ = indexStat.st_ino;
+    indexOffset_ = content.size();
+    indexRecords_ = index_.size();
+}
+
+std::optional<DiskCache::View> DiskCache::read(std::string const& digest, Location const& location)
+{
+    auto const end = location.offset + location.size;
+
+    // Segments only grow, so a mapping is renewed if it is too short.
+    auto& segment = segments_[location.segment];
+    if (!segment || segment->size < end) {
+        segment.reset();
+        auto fd = ::open(segmentPath(location.segment).c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat segmentStat{};
+        if (fd >= 0 && ::fstat(fd, &segmentStat) == 0 && static_cast<std::uint64_t>(segmentStat.st_size) >= end) {
+            auto size = static_cast<std::size_t>(segmentStat.st_size);
+            auto data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (data != MAP_FAILED)
+                segment = std::make_shared<Segment>(static_cast<const char*>(data), size);
+        }
+        if (fd >= 0)
+            ::close(fd);
+        if (!segment) {
+            // The segment was evicted.
+            segments_.erase(location.segment);
+            index_.erase(hashDigest(digest));
+            return {};
+        }
+    }
+
+    auto data = segment->data + location.offset;
+    if (location.size < RECORD_HEADER_SIZE || get<std::uint32_t>(data) != RECORD_MAGIC)
+        return {};
+    auto digestSize = get<std::uint32_t>(data + 8);
+    auto headersSize = get<std::uint32_t>(data + 12);
+    auto contentSize = get<std::uint64_t>(data + 16);
+    if (RECORD_HEADER_SIZE + digestSize + headersSize + contentSize != location.size)
+        return {};
+
+    auto pos = data + RECORD_HEADER_SIZE;
+    if (std::string_view(pos, digestSize) != digest)
+        return {};
+    pos += digestSize;
+
+    View result;
+    result.mapping = std::shared_ptr<const void>(segment, segment->data);
+    result.status = get<std::int32_t>(data + 4);
+    result.expires = Clock::time_point(std::chrono::milliseconds(location.expires));
+
+    auto const headersEnd = pos + headersSize;
+    auto const field = [&]() -> std::optional<std::string> {
+        if (headersEnd - pos < 4 || headersEnd - pos - 4 < get<std::uint32_t>(pos))
+            return {};
+        std::string value(pos + 4, get<std::uint32_t>(pos));
+        pos += 4 + value.size();
+        return value;
+    };
+    while (pos < headersEnd) {
+        auto name = field();
+        auto value = field();
+        if (!name || !value)
+            return {};
+        result.headers.insert({std::move(*name), std::move(*value)});
+    }
+    result.content = std::string_view(headersEnd, contentSize);
+    return result;
+}
+
+std::filesystem::path DiskCache::segmentPath(std::uint32_t segment) const
+{
+    return dir_ / stx::format("segment-{}.dat", segment);
+}
+
+#else
+
+struct DiskCache::Segment {};
+
+DiskCache::DiskCache(std::filesystem::path dir, std::uint64_t maxBytes)
+    : dir_(std::move(dir))
+    , maxBytes_(maxBytes)
+    , segmentBytes_(maxBytes)
+{
+    throw logRuntimeError("The disk response cache is not supported on Windows.");
+}
+
+DiskCache::~DiskCache() = default;
+
+std::optional<DiskCache::View> DiskCache::lookup(std::string const&)
+{
+    return {};
+}
+
+void DiskCache::store(std::string const&, int, std::string_view, Headers const&, Clock::time_point)
+{}
+
+bool DiskCache::touch(std::string const&, Clock::time_point)
+{
+    return false;
+}
+
+std::uint64_t DiskCache::bytes() const
+{
+    return 0;
+}
+
+#endif
+
+}
@@ -0,0 +1,190 @@
+#include "dns-cache.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#endif
+
+namespace httpcl
+{
+
+namespace
+{
+
+/**
+ * Fraction of the TTL before expiry in which entries are refreshed
+ * in the background, and for which addresses are kept after a failure.
+ */
+constexpr int REFRESH_FRACTION = 5;
+
+}
+
+std::vector<std::string> DnsCache::systemResolver(std::string const& host)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* info = nullptr;
+    if (auto error = ::getaddrinfo(host.c_str(), nullptr, &hints, &info); error != 0 || !info)
+        return {};
+
+    std::vector<std::string> result;
+    for (auto current = info; current; current = current->ai_next) {
+        char address[INET6_ADDRSTRLEN] = {};
+        const void* raw = nullptr;
+        if (current->ai_family == AF_INET)
+            raw = &reinterpret_cast<sockaddr_in const*>(current->ai_addr)->sin_addr;
+        else if (current->ai_family == AF_INET6)
+            raw = &reinterpret_cast<sockaddr_in6 const*>(current->ai_addr)->sin6_addr;
+        if (raw && ::inet_ntop(current->ai_family, raw, address, sizeof(address)) &&
+            std::find(result.begin(), result.end(), address) == result.end())
+            result.emplace_back(address);
+    }
+    ::freeaddrinfo(info);
+    return result;
+}
+
+DnsCache::DnsCache(Resolver resolver, Clock::duration ttl)
+    : ttl_(ttl)
+    , resolver_(std::move(resolver))
+{}
+
+DnsCache::~DnsCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    refreshCondition_.notify_all();
+    if (refreshThread_.joinable())
+        refreshThread_.join();
+}
+
+std::shared_ptr<DnsCache> DnsCache::shared()
+{
+    static auto instance = []() -> std::shared_ptr<DnsCache> {
+        auto ttl = std::chrono::seconds(60);
+        if (auto ttlStr = std::getenv("HTTP_DNS_TTL")) {
+            try {
+                ttl = std::chrono::seconds(std::stoll(ttlStr));
+            }
+            catch (std::exception& e) {
+                std::cerr << "Could not parse value of HTTP_DNS_TTL." << std::endl;
+            }
+        }
+        if (ttl <= std::chrono::seconds(0))
+            return {};
+        return std::make_shared<DnsCache>(systemResolver, ttl);
+    }();
+    return instance;
+}
+
+std::optional<std::string> DnsCache::resolve(std::string const& host, Clock::time_point now)
+{
+    auto const next = [](Entry& entry) {
+        return entry.addresses[entry.next++ % entry.addresses.size()];
+    };
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (auto it = entries_.find(host); it != entries_.end() && !it->second.addresses.empty()) {
+        auto& entry = it->second;
+        if (now < entry.expires) {
+            // Refresh the addresses before they expire.
+            if (now >= entry.expires - ttl_ / REFRESH_FRACTION && !entry.refreshing) {
+                entry.refreshing = true;
+                refreshQueue_.push_back(host);
+                if (!refreshThread_.joinable())
+                    refreshThread_ = std::thread([this] { refreshLoop(); });
+                refreshCondition_.notify_one();
+            }
+            return next(entry);
+        }
+    }
+
+    lock.unlock();
+    auto addresses = lookup(host);
+    lock.lock();
+
+    auto& entry = entries_[host];
+    if (!addresses.empty()) {
+        entry.addresses = std::move(addresses);
+        entry.expires = now + ttl_;
+    }
+    else if (!entry.addresses.empty()) {
+        log().warn("Could not resolve {}, using the previous addresses.", host);
+        entry.expires = now + ttl_ / REFRESH_FRACTION;
+    }
+    else {
+        entries_.erase(host);
+        return {};
+    }
+    return next(entry);
+}
+
+void DnsCache::setResolver(Resolver resolver)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    resolver_ = std::move(resolver);
+    entries_.clear();
+}
+
+DnsCache::Clock::duration DnsCache::ttl() const
+{
+    return ttl_;
+}
+
+std::vector<std::string> DnsCache::lookup(std::string const& host)
+{
+    Resolver resolver;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        resolver = resolver_;
+    }
+
+    try {
+        return resolver(host);
+    }
+    catch (std::exception const& e) {
+        log().warn("Could not resolve {}: {}", host, e.what());
+    }
+    return {};
+}
+
+void DnsCache::refreshLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        refreshCondition_.wait(lock, [this] { return stopped_ || !refreshQueue_.empty(); });
+        if (stopped_)
+            return;
+
+        auto host = std::move(refreshQueue_.front());
+        refreshQueue_.pop_front();
+
+        lock.unlock();
+        auto addresses = lookup(host);
+        lock.lock();
+
+        // The entry may have been dropped by setResolver() in the meantime.
+        auto it = entries_.find(host);
+        if (it == entries_.end())
+            continue;
+        it->second.refreshing = false;
+        if (!addresses.empty()) {
+            it->second.addresses = std::move(addresses);
+            it->second.expires = Clock::now() + ttl_;
+        }
+    }
+}
+
+}
@@ -1,15 +1,23 @@
 #include "http-client.hpp"
+#include "digest.hpp"
 #include "uri.hpp"
+#include "stx/format.h"
 
 #include <httplib.h>
 
+#include <future>
+#include <mutex>
+#include <vector>
+
 namespace
 {
 
 httpcl::IHttpClient::Result makeResult(httplib::Result&& result)
 {
     if (result)
-        return {result->status, std::move(result->body)};
+        return {result->status,
+                std::move(result->body),
+                httpcl::Headers(result->headers.begin(), result->headers.end())};
     return {0, {}};
 }
 
@@ -18,24 +26,11 @@ void applyQuery(httpcl::URIComponents& uri, httpcl::Config const& config) {
         uri.addQuery(key, value);
 }
 
-auto makeClientAndApplyQuery(
-    httpcl::URIComponents& uri,
-    httpcl::Config const& config,
-    time_t const& timeoutSecs,
-    bool const& sslCertStrict)
-{
-    auto client = std::make_unique<httplib::Client>(uri.buildHost().c_str());
-    client->enable_server_certificate_verification(sslCertStrict);
-    client->set_connection_timeout(timeoutSecs);
-    client->set_read_timeout(timeoutSecs);
-    client->set_follow_location(true);
-    config.apply(*client);
+using Deadline = std::optional<std::chrono::steady_clock::time_point>;
 
-    applyQuery(uri, config);
-    if (httpcl::log().should_log(spdlog::level::debug)) {
-        httpcl::log().debug("  ... full URI: {}", uri.build());
-    }
-    return client;
+bool isCancelled(httpcl::Config const& config, Deadline const& deadline) {
+    return (config.cancellation && config.cancellation->cancelled()) ||
+        (deadline && std::chrono::steady_clock::now() >= *deadline);
 }
 
 }
@@ -45,7 +40,143 @@ namespace httpcl
 
 using Result = HttpLibHttpClient::Result;
 
-HttpLibHttpClient::HttpLibHttpClient() {
+/**
+ * Idle keep-alive connections, keyed by host and proxy settings. A connection
+ * is leased exclusively for one request, and returned to the pool afterwards.
+ * Connections are retired after the DNS TTL, so that they do not stick to
+ * the address which was resolved when they were created.
+ */
+struct HttpLibHttpClient::ConnectionPool
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Lease
+    {
+        ConnectionPool& pool;
+        std::string key;
+        std::unique_ptr<httplib::Client> client;
+        Clock::time_point created;
+
+        ~Lease() {
+            pool.release(std::move(key), std::move(client), created);
+        }
+
+        httplib::Client* operator-> () const {
+            return client.get();
+        }
+    };
+
+    struct Idle
+    {
+        std::unique_ptr<httplib::Client> client;
+        Clock::time_point created;
+    };
+
+    std::mutex mutex;
+    std::map<std::string, std::vector<Idle>> idle;
+    std::size_t maxIdlePerKey = 8;
+
+    /**
+     * Uses the prepared proxy, so that clients with an outdated
+     * proxy password from the keychain are not reused. The password
+     * is only included as a digest.
+     */
+    static std::string key(URIComponents const& uri, PreparedConfig const& prepared)
+    {
+        auto result = uri.buildHost();
+        if (auto const& proxy = prepared.proxy)
+            result += stx::format("|{}:{}|{}|", proxy->host, proxy->port, proxy->user) + sha256(proxy->password);
+        return result;
+    }
+
+    Lease acquire(URIComponents const& uri, Config const& config, PreparedConfig const& prepared, bool sslCertStrict, DnsCache* dns)
+    {
+        auto key = ConnectionPool::key(uri, prepared);
+        auto const now = Clock::now();
+
+        Idle connection;
+        std::vector<Idle> retired;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = idle.find(key);
+            while (it != idle.end() && !it->second.empty() && !connection.client) {
+                connection = std::move(it->second.back());
+                it->second.pop_back();
+                if (dns && !config.proxy && now - connection.created >= dns->ttl())
+                    retired.emplace_back(std::move(connection));
+            }
+        }
+
+        if (!connection.client)
+            connection = {create(uri, config, prepared, sslCertStrict, dns), now};
+
+        return {*this, std::move(key), std::move(connection.client), connection.created};
+    }
+
+    /**
+     * Create a new, not yet connected client.
+     */
+    static std::unique_ptr<httplib::Client> create(URIComponents const& uri, Config const& config, PreparedConfig const& prepared, bool sslCertStrict, DnsCache* dns)
+    {
+        auto client = std::make_unique<httplib::Client>(uri.buildHost().c_str());
+        client->enable_server_certificate_verification(sslCertStrict);
+        client->set_follow_location(true);
+        client->set_keep_alive(true);
+        prepared.applyProxy(*client);
+
+        // Connect to a cached address. Proxies are resolved by httplib.
+        if (dns && !config.proxy)
+            if (auto address = dns->resolve(uri.host))
+                client->set_hostname_addr_map({{uri.host, *address}});
+        return client;
+    }
+
+    std::size_t idleCount(std::string const& key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = idle.find(key);
+        return it != idle.end() ? it->second.size() : 0;
+    }
+
+    void release(std::string key, std::unique_ptr<httplib::Client> client, Clock::time_point created)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& connections = idle[std::move(key)];
+        if (connections.size() < maxIdlePerKey)
+            connections.push_back({std::move(client), created});
+    }
+};
+
+std::optional<std::string> IHttpClient::Result::header(std::string_view name) const
+{
+    if (auto it = headers.find(name); it != headers.end())
+        return it->second;
+    return {};
+}
+
+IHttpClient::CircuitOpenError::CircuitOpenError(std::string origin)
+    : Error({0, {}}, stx::format("Circuit breaker for {} is open.", origin))
+    , origin(std::move(origin))
+{}
+
+IHttpClient::ConcurrencyLimitError::ConcurrencyLimitError(std::string origin)
+    : Error({0, {}}, stx::format("Concurrency limit for {} is exhausted.", origin))
+    , origin(std::move(origin))
+{}
+
+IHttpClient::RateLimitError::RateLimitError(std::string key)
+    : Error({0, {}}, stx::format("Rate limit for {} is exhausted.", key))
+    , key(std::move(key))
+{}
+
+HttpLibHttpClient::HttpLibHttpClient()
+    : pool_(std::make_unique<ConnectionPool>())
+    , breakers_(std::make_unique<CircuitBreakers>())
+    , limiters_(std::make_unique<ConcurrencyLimiters>())
+    , rateLimiters_(std::make_unique<RateLimiters>())
+    , dns_(DnsCache::shared())
+{
+    std::size_t cacheMaxBytes = 64 << 20;
     if (auto timeoutStr = std::getenv("HTTP_TIMEOUT")) {
         try {
             timeoutSecs_ = std::stoll(timeoutStr);
@@ -56,67 +187,341 @@ HttpLibHttpClient::HttpLibHttpClient() {
     }
     if (auto sslStrictFlagStr = std::getenv("HTTP_SSL_STRICT"))
         sslCertStrict_ = !std::string(sslStrictFlagStr).empty();
+    if (auto maxIdleStr = std::getenv("HTTP_MAX_IDLE_CONNECTIONS")) {
+        try {
+            pool_->maxIdlePerKey = std::stoull(maxIdleStr);
+        }
+        catch (std::exception& e) {
+            std::cerr << "Could not parse value of HTTP_MAX_IDLE_CONNECTIONS." << std::endl;
+        }
+    }
+    if (auto cacheMaxBytesStr = std::getenv("HTTP_CACHE_MAX_BYTES")) {
+        try {
+            cacheMaxBytes = std::stoull(cacheMaxBytesStr);
+        }
+        catch (std::exception& e) {
+            std::cerr << "Could not parse value of HTTP_CACHE_MAX_BYTES." << std::endl;
+        }
+    }
+
+    std::shared_ptr<DiskCache> diskCache;
+    if (auto cacheDir = std::getenv("HTTP_CACHE_DIR"); cacheDir && *cacheDir) {
+        std::uint64_t diskCacheMaxBytes = 1ull << 30;
+        if (auto diskCacheMaxBytesStr = std::getenv("HTTP_CACHE_DIR_MAX_BYTES")) {
+            try {
+                diskCacheMaxBytes = std::stoull(diskCacheMaxBytesStr);
+            }
+            catch (std::exception& e) {
+                std::cerr << "Could not parse value of HTTP_CACHE_DIR_MAX_BYTES." << std::endl;
+            }
+        }
+        try {
+            diskCache = std::make_shared<DiskCache>(cacheDir, diskCacheMaxBytes);
+        }
+        catch (std::exception const& e) {
+            log().warn("Not using the disk response cache: {}", e.what());
+        }
+    }
+    cache_ = std::make_unique<ResponseCache>(cacheMaxBytes, std::move(diskCache));
 }
 
+HttpLibHttpClient::~HttpLibHttpClient() = default;
+
 Result HttpLibHttpClient::get(const std::string& uriStr,
                               const Config& config)
 {
-    auto uri = URIComponents::fromStrRfc3986(uriStr);
-    return makeResult(
-        makeClientAndApplyQuery(uri, config, timeoutSecs_, sslCertStrict_)
-            ->Get(uri.buildPath().c_str()));
+    if (config.responseCache.value_or(false))
+        return getCached(uriStr, config);
+    return send("GET", uriStr, {}, config);
 }
 
 Result HttpLibHttpClient::post(const std::string& uriStr,
                                const std::optional<BodyAndContentType>& body,
                                const Config& config)
 {
-    auto uri = URIComponents::fromStrRfc3986(uriStr);
-    return makeResult(
-        makeClientAndApplyQuery(uri, config, timeoutSecs_, sslCertStrict_)
-            ->Post(
-                uri.buildPath().c_str(),
-                body ? body->body : std::string(),
-                body ? body->contentType.c_str() : nullptr));
+    return send("POST", uriStr, body, config);
 }
 
 Result HttpLibHttpClient::put(const std::string& uriStr,
                               const std::optional<BodyAndContentType>& body,
                               const Config& config)
 {
-    auto uri = URIComponents::fromStrRfc3986(uriStr);
-    return makeResult(
-        makeClientAndApplyQuery(uri, config, timeoutSecs_, sslCertStrict_)
-            ->Put(
-                uri.buildPath().c_str(),
-                body ? body->body : std::string(),
-                body ? body->contentType.c_str() : nullptr));
+    return send("PUT", uriStr, body, config);
 }
 
 Result HttpLibHttpClient::del(const std::string& uriStr,
                               const std::optional<BodyAndContentType>& body,
                               const Config& config)
 {
-    auto uri = URIComponents::fromStrRfc3986(uriStr);
-    return makeResult(
-        makeClientAndApplyQuery(uri, config, timeoutSecs_, sslCertStrict_)
-            ->Delete(
-                uri.buildPath().c_str(),
-                body ? body->body : std::string(),
-                body ? body->contentType.c_str() : nullptr));
+    return send("DELETE", uriStr, body, config);
 }
 
 Result HttpLibHttpClient::patch(const std::string& uriStr,
                                 const std::optional<BodyAndContentType>& body,
                                 const Config& config)
 {
+    return send("PATCH", uriStr, body, config);
+}
+
+Result HttpLibHttpClient::send(const char* method,
+                               const std::string& uriStr,
+                               const std::optional<BodyAndContentType>& body,
+                               const Config& config)
+{
+    using namespace std::chrono;
+
+    // The total timeout and the deadline limit all other timeouts.
+    auto const start = steady_clock::now();
+    auto deadline = config.deadline;
+    if (config.timeouts.total && (!deadline || start + *config.timeouts.total < *deadline))
+        deadline = start + *config.timeouts.total;
+
+    if (isCancelled(config, deadline)) {
+        log().debug("  ... request to {} was cancelled or exceeded its deadline.", uriStr);
+        return {0, {}};
+    }
+
     auto uri = URIComponents::fromStrRfc3986(uriStr);
-    return makeResult(
-        makeClientAndApplyQuery(uri, config, timeoutSecs_, sslCertStrict_)
-            ->Patch(
-                uri.buildPath().c_str(),
-                body ? body->body : std::string(),
-                body ? body->contentType.c_str() : nullptr));
+    applyQuery(uri, config);
+    if (log().should_log(spdlog::level::debug)) {
+        log().debug("  ... full URI: {}", uri.build());
+    }
+
+    // Fail fast while the origin is known to be down.
+    std::shared_ptr<CircuitBreaker> breaker;
+    std::optional<CircuitBreaker::Permit> permit;
+    if (config.circuitBreaker) {
+        auto origin = uri.buildHost();
+        breaker = breakers_->get(origin, *config.circuitBreaker);
+        permit = breaker->tryAcquire(start);
+        if (!permit)
+            throw CircuitOpenError(origin);
+    }
+
+    // Give up the circuit breaker permit if the request is not sent.
+    auto const abandon = [&](auto error) -> Result {
+        if (breaker)
+            breaker->record(*permit, CircuitBreaker::Outcome::Ignored);
+        if (isCancelled(config, deadline)) {
+            log().debug("  ... request to {} was cancelled or exceeded its deadline.", uriStr);
+            return {0, {}};
+        }
+        throw error;
+    };
+
+    // Wait for the next turn of the origin's rate limit.
+    std::shared_ptr<RateLimiter> rateLimiter;
+    if (config.rateLimit) {
+        auto origin = uri.buildHost();
+        rateLimiter = rateLimiters_->get(origin, *config.rateLimit);
+        auto waitUntil = steady_clock::now() + rateLimiter->policy().maxWait;
+        if (deadline)
+            waitUntil = std::min(waitUntil, *deadline);
+        if (!rateLimiter->acquire(waitUntil, config.cancellation))
+            return abandon(RateLimitError(origin));
+    }
+
+    // Wait for a free slot of the origin's concurrency limit.
+    std::shared_ptr<ConcurrencyLimiter> limiter;
+    if (config.concurrencyLimit) {
+        auto origin = uri.buildHost();
+        limiter = limiters_->get(origin, *config.concurrencyLimit);
+        auto waitUntil = steady_clock::now() + limiter->policy().maxWait;
+        if (deadline)
+            waitUntil = std::min(waitUntil, *deadline);
+        if (!limiter->acquire(waitUntil, config.cancellation))
+            return abandon(ConcurrencyLimitError(origin));
+    }
+
+    // Record the outcome, also if sending throws.
+    auto const sendTime = steady_clock::now();
+    auto const finish = [&](Result const* result) {
+        auto const end = steady_clock::now();
+        auto const ignored = !result || (result->status == 0 && isCancelled(config, deadline));
+        auto const failed = !ignored && (result->status == 0 || result->status >= 500);
+
+        if (breaker) {
+            auto const& slowRequest = breaker->policy().slowRequest;
+            auto outcome = CircuitBreaker::Outcome::Success;
+            if (ignored)
+                outcome = CircuitBreaker::Outcome::Ignored;
+            else if (failed || (slowRequest && end - sendTime > *slowRequest))
+                outcome = CircuitBreaker::Outcome::Failure;
+            breaker->record(*permit, outcome, end);
+        }
+
+        if (limiter) {
+            auto outcome = ConcurrencyLimiter::Outcome::Success;
+            if (ignored)
+                outcome = ConcurrencyLimiter::Outcome::Ignored;
+            else if (failed)
+                outcome = ConcurrencyLimiter::Outcome::Dropped;
+            limiter->release(outcome, end - sendTime);
+        }
+
+        if (rateLimiter && result)
+            rateLimiter->update(result->status, result->headers, end);
+    };
+
+    try {
+        auto result = transmit(method, uri, body, config, deadline);
+        finish(&result);
+        return result;
+    }
+    catch (...) {
+        finish(nullptr);
+        throw;
+    }
+}
+
+Result HttpLibHttpClient::getCached(const std::string& uriStr,
+                                    const Config& config)
+{
+    // Responses may depend on anything the request sends.
+    auto uri = URIComponents::fromStrRfc3986(uriStr);
+    applyQuery(uri, config);
+    auto key = uri.build();
+    for (auto const& [name, value] : config.headers)
+        key.append("\nH:").append(name).append(": ").append(value);
+    for (auto const& [name, value] : config.cookies)
+        key.append("\nC:").append(name).append("=").append(value);
+    if (config.auth)
+        key.append("\nA:").append(PreparedConfig::get(config)->authDigest);
+    auto credentials = config.auth || config.apiKey || !config.cookies.empty() ||
+        config.headers.count("Authorization") || config.headers.count("Proxy-Authorization") ||
+        config.headers.count("Cookie");
+
+    auto cached = cache_->lookup(key);
+    if (cached.fresh) {
+        log().debug("  ... serving {} from the response cache.", uriStr);
+        return {cached.response->status, cached.response->content, cached.response->headers};
+    }
+
+    auto conditional = config;
+    for (auto const& [name, value] : cached.conditions)
+        conditional.headers.set(name, value);
+
+    auto result = send("GET", uriStr, {}, conditional);
+    if (result.status == 304 && cached.response) {
+        if (auto response = cache_->notModified(key, result.headers))
+            return {response->status, response->content, response->headers};
+        return {cached.response->status, cached.response->content, cached.response->headers};
+    }
+    if (result.status != 0)
+        cache_->store(key, {result.status, result.content, result.headers}, ResponseCache::Clock::now(), credentials);
+    return result;
+}
+
+Result HttpLibHttpClient::transmit(const char* method,
+                                   const URIComponents& uri,
+                                   const std::optional<BodyAndContentType>& body,
+                                   const Config& config,
+                                   const Deadline& deadline)
+{
+    using namespace std::chrono;
+
+    // Queueing may have used up a part of the time until the deadline.
+    auto const start = steady_clock::now();
+    auto const defaultTimeout = duration_cast<milliseconds>(seconds(timeoutSecs_));
+    auto const limit = [&](std::optional<milliseconds> const& timeout) {
+        auto result = timeout.value_or(defaultTimeout);
+        if (deadline)
+            result = std::min(result, duration_cast<milliseconds>(*deadline - start));
+        return std::max(result, milliseconds(1));
+    };
+
+    auto prepared = PreparedConfig::get(config);
+    auto client = pool_->acquire(uri, config, *prepared, sslCertStrict_, dns_.get());
+    client->set_connection_timeout(limit(config.timeouts.connect));
+    client->set_read_timeout(limit(config.timeouts.firstByte));
+    client->set_write_timeout(limit({}));
+
+    httplib::Request request;
+    request.method = method;
+    request.path = uri.buildPath();
+    request.headers = prepared->requestHeaders(config);
+    if (body) {
+        request.body = body->body;
+        if (!body->contentType.empty())
+            request.headers.emplace("Content-Type", body->contentType);
+    }
+    if (deadline || config.cancellation)
+        request.progress = [&](uint64_t, uint64_t) { return !isCancelled(config, deadline); };
+
+    // Abort blocking socket operations if the request is cancelled.
+    auto cancelSubscription = CancellationToken::subscribe(
+        config.cancellation, [&client] { client->stop(); });
+
+    auto result = makeResult(client->send(request));
+
+    // Credentials may have changed in the keychain, so read them again.
+    if (result.status == 401 || result.status == 407)
+        PreparedConfig::invalidate(config);
+    return result;
+}
+
+std::size_t HttpLibHttpClient::preconnect(const std::string& uriStr,
+                                          const Config& config,
+                                          std::size_t connections)
+{
+    using namespace std::chrono;
+
+    auto uri = URIComponents::fromStrRfc3986(uriStr);
+    applyQuery(uri, config);
+    auto prepared = PreparedConfig::get(config);
+    auto key = ConnectionPool::key(uri, *prepared);
+
+    // Only top up the idle connections, as the pool keeps no more.
+    connections = std::min(connections, pool_->maxIdlePerKey);
+    auto idle = pool_->idleCount(key);
+    if (idle >= connections)
+        return 0;
+
+    auto const timeout = config.timeouts.connect.value_or(duration_cast<milliseconds>(seconds(timeoutSecs_)));
+    std::vector<std::future<std::unique_ptr<httplib::Client>>> pending;
+    for (auto i = idle; i < connections; ++i)
+        pending.emplace_back(std::async(std::launch::async, [&]() -> std::unique_ptr<httplib::Client> {
+            auto client = ConnectionPool::create(uri, config, *prepared, sslCertStrict_, dns_.get());
+            client->set_connection_timeout(timeout);
+            client->set_read_timeout(timeout);
+
+            httplib::Request request;
+            request.method = "HEAD";
+            request.path = uri.path.empty() ? "/" : uri.buildPath();
+            request.headers = prepared->requestHeaders(config);
+
+            // Any response means that the connection is established.
+            if (auto result = client->send(request)) {
+                log().debug("  ... opened a connection to {} (status {}).", uri.buildHost(), result->status);
+                return client;
+            }
+            log().warn("Could not open a connection to {}.", uri.buildHost());
+            return {};
+        }));
+
+    std::size_t result = 0;
+    for (auto& connection : pending) {
+        if (auto client = connection.get()) {
+            pool_->release(key, std::move(client), ConnectionPool::Clock::now());
+            ++result;
+        }
+    }
+    return result;
+}
+
+std::map<std::string, CircuitBreaker::State> HttpLibHttpClient::circuitStates() const
+{
+    return breakers_->states();
+}
+
+std::map<std::string, ConcurrencyLimiter::Stats> HttpLibHttpClient::concurrencyLimits() const
+{
+    return limiters_->stats();
+}
+
+std::optional<ResponseCache::Stats> HttpLibHttpClient::cacheStats() const
+{
+    return cache_->stats();
 }
 
 Result MockHttpClient::get(const std::string& uri,
@@ -140,6 +545,15 @@ Result MockHttpClient::post(const std::string& uri,
     return {0, ""};
 }
 
+std::size_t MockHttpClient::preconnect(const std::string& uri,
+                                       const Config& config,
+                                       std::size_t connections)
+{
+    if (preconnectFun)
+        return preconnectFun(uri, connections);
+    return 0;
+}
+
 Result MockHttpClient::put(const std::string& uri,
                            const std::optional<BodyAndContentType>& body,
                            const Config& config)
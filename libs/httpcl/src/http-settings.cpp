@@ -1,4 +1,5 @@
 #include "http-settings.hpp"
+#include "digest.hpp"
 #include "log.hpp"
 
 #ifdef ZSWAG_KEYCHAIN_SUPPORT
@@ -6,9 +7,13 @@
 #endif
 #include <yaml-cpp/yaml.h>
 
+#include <algorithm>
 #include <cstdlib>
 #include <regex>
 #include <future>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
 #include <spdlog/spdlog.h>
 
 using namespace httpcl;
@@ -60,6 +65,239 @@ struct convert<Config::BasicAuthentication>
     }
 };
 
+template <>
+struct convert<Timeouts>
+{
+    static Node encode(const Timeouts& t)
+    {
+        Node node;
+        if (t.connect)
+            node["connect"] = t.connect->count();
+        if (t.firstByte)
+            node["first-byte"] = t.firstByte->count();
+        if (t.total)
+            node["total"] = t.total->count();
+        return node;
+    }
+
+    static bool decode(const Node& node, Timeouts& t)
+    {
+        if (!node.IsMap())
+            return false;
+
+        if (auto connect = node["connect"])
+            t.connect = std::chrono::milliseconds(connect.as<std::int64_t>());
+        if (auto firstByte = node["first-byte"])
+            t.firstByte = std::chrono::milliseconds(firstByte.as<std::int64_t>());
+        if (auto total = node["total"])
+            t.total = std::chrono::milliseconds(total.as<std::int64_t>());
+
+        return true;
+    }
+};
+
+template <>
+struct convert<RetryPolicy>
+{
+    static Node encode(const RetryPolicy& r)
+    {
+        Node node;
+        node["max-attempts"] = r.maxAttempts;
+        node["initial-backoff"] = r.initialBackoff.count();
+        node["max-backoff"] = r.maxBackoff.count();
+        node["budget"] = r.budget;
+        return node;
+    }
+
+    static bool decode(const Node& node, RetryPolicy& r)
+    {
+        if (!node.IsMap())
+            return false;
+
+        if (auto maxAttempts = node["max-attempts"])
+            r.maxAttempts = maxAttempts.as<unsigned>();
+        if (auto initialBackoff = node["initial-backoff"])
+            r.initialBackoff = std::chrono::milliseconds(initialBackoff.as<std::int64_t>());
+        if (auto maxBackoff = node["max-backoff"])
+            r.maxBackoff = std::chrono::milliseconds(maxBackoff.as<std::int64_t>());
+        if (auto budget = node["budget"])
+            r.budget = budget.as<double>();
+
+        return true;
+    }
+};
+
+template <>
+struct convert<HedgingPolicy>
+{
+    static Node encode(const HedgingPolicy& h)
+    {
+        Node node;
+        node["percentile"] = h.percentile;
+        node["min-delay"] = h.minDelay.count();
+        node["budget"] = h.budget;
+        return node;
+    }
+
+    static bool decode(const Node& node, HedgingPolicy& h)
+    {
+        if (!node.IsMap())
+            return false;
+
+        if (auto percentile = node["percentile"])
+            h.percentile = percentile.as<double>();
+        if (auto minDelay = node["min-delay"])
+            h.minDelay = std::chrono::milliseconds(minDelay.as<std::int64_t>());
+        if (auto budget = node["budget"])
+            h.budget = budget.as<double>();
+
+        return true;
+    }
+};
+
+template <>
+struct convert<CircuitBreakerPolicy>
+{
+    static Node encode(const CircuitBreakerPolicy& c)
+    {
+        Node node;
+        node["failure-rate"] = c.failureRate;
+        node["window"] = c.window;
+        node["min-requests"] = c.minRequests;
+        if (c.slowRequest)
+            node["slow-request"] = c.slowRequest->count();
+        node["open-duration"] = c.openDuration.count();
+        node["probes"] = c.probes;
+        return node;
+    }
+
+    static bool decode(const Node& node, CircuitBreakerPolicy& c)
+    {
+        if (!node.IsMap())
+            return false;
+
+        if (auto failureRate = node["failure-rate"])
+            c.failureRate = failureRate.as<double>();
+        if (auto window = node["window"])
+            c.window = std::max(window.as<unsigned>(), 1u);
+        if (auto minRequests = node["min-requests"])
+            c.minRequests = minRequests.as<unsigned>();
+        if (auto slowRequest = node["slow-request"])
+            c.slowRequest = std::chrono::milliseconds(slowRequest.as<std::int64_t>());
+        if (auto openDuration = node["open-duration"])
+            c.openDuration = std::chrono::milliseconds(openDuration.as<std::int64_t>());
+        if (auto probes = node["probes"])
+            c.probes = std::max(probes.as<unsigned>(), 1u);
+
+        return true;
+    }
+};
+
+template <>
+struct convert<ConcurrencyLimitPolicy>
+{
+    static Node encode(const ConcurrencyLimitPolicy& c)
+    {
+        Node node;
+        node["initial-limit"] = c.initialLimit;
+        node["min-limit"] = c.minLimit;
+        node["max-limit"] = c.maxLimit;
+        node["tolerance"] = c.tolerance;
+        node["max-wait"] = c.maxWait.count();
+        return node;
+    }
+
+    static bool decode(const Node& node, ConcurrencyLimitPolicy& c)
+    {
+        if (!node.IsMap())
+            return false;
+
+        if (auto minLimit = node["min-limit"])
+            c.minLimit = std::max(minLimit.as<unsigned>(), 1u);
+        if (auto maxLimit = node["max-limit"])
+            c.maxLimit = maxLimit.as<unsigned>();
+        if (auto initialLimit = node["initial-limit"])
+            c.initialLimit = initialLimit.as<unsigned>();
+        if (auto tolerance = node["tolerance"])
+            c.tolerance = std::max(tolerance.as<double>(), 1.);
+        if (auto maxWait = node["max-wait"])
+            c.maxWait = std::chrono::milliseconds(maxWait.as<std::int64_t>());
+
+        c.maxLimit = std::max(c.maxLimit, c.minLimit);
+        c.initialLimit = std::clamp(c.initialLimit, c.minLimit, c.maxLimit);
+        return true;
+    }
+};
+
+template <>
+struct convert<RateLimitPolicy>
+{
+    static Node encode(const RateLimitPolicy& r)
+    {
+        Node node;
+        node["rate"] = r.rate;
+        node["burst"] = r.burst;
+        node["max-wait"] = r.maxWait.count();
+        return node;
+    }
+
+    static bool decode(const Node& node, RateLimitPolicy& r)
+    {
+        if (!node.IsMap())
+            return false;
+
+        if (auto rate = node["rate"])
+            r.rate = rate.as<double>();
+        if (auto burst = node["burst"])
+            r.burst = std::max(burst.as<unsigned>(), 1u);
+        if (auto maxWait = node["max-wait"])
+            r.maxWait = std::chrono::milliseconds(maxWait.as<std::int64_t>());
+
+        return r.rate > 0.;
+    }
+};
+
+template <>
+struct convert<LoadBalancingPolicy>
+{
+    static Node encode(const LoadBalancingPolicy& l)
+    {
+        Node node;
+        switch (l.strategy) {
+        case LoadBalancingPolicy::Strategy::RoundRobin: node["strategy"] = "round-robin"; break;
+        case LoadBalancingPolicy::Strategy::LeastOutstanding: node["strategy"] = "least-outstanding"; break;
+        case LoadBalancingPolicy::Strategy::PowerOfTwoChoices: node["strategy"] = "ewma"; break;
+        }
+        node["max-failures"] = l.maxFailures;
+        node["ejection-time"] = l.ejectionTime.count();
+        return node;
+    }
+
+    static bool decode(const Node& node, LoadBalancingPolicy& l)
+    {
+        if (!node.IsMap())
+            return false;
+
+        if (auto strategy = node["strategy"]) {
+            auto name = strategy.as<std::string>();
+            if (name == "round-robin")
+                l.strategy = LoadBalancingPolicy::Strategy::RoundRobin;
+            else if (name == "least-outstanding")
+                l.strategy = LoadBalancingPolicy::Strategy::LeastOutstanding;
+            else if (name == "ewma")
+                l.strategy = LoadBalancingPolicy::Strategy::PowerOfTwoChoices;
+            else
+                return false;
+        }
+        if (auto maxFailures = node["max-failures"])
+            l.maxFailures = std::max(maxFailures.as<unsigned>(), 1u);
+        if (auto ejectionTime = node["ejection-time"])
+            l.ejectionTime = std::chrono::milliseconds(ejectionTime.as<std::int64_t>());
+
+        return true;
+    }
+};
+
 template <>
 struct convert<Config::Proxy>
 {
@@ -117,7 +355,8 @@ YAML::Node configToNode(Config const& config, std::string const& url=".*") {
     result["url"] = url;
 
     if (!config.cookies.empty())
-        result["cookies"] = config.cookies;
+        result["cookies"] =
+            std::map<std::string, std::string>{config.cookies.begin(), config.cookies.end()};
 
     if (!config.headers.empty())
         result["headers"] =
@@ -136,6 +375,36 @@ YAML::Node configToNode(Config const& config, std::string const& url=".*") {
     if (config.apiKey)
         result["api-key"] = *config.apiKey;
 
+    if (!config.timeouts.empty())
+        result["timeouts"] = config.timeouts;
+
+    if (config.retry)
+        result["retry"] = *config.retry;
+
+    if (config.hedging)
+        result["hedging"] = *config.hedging;
+
+    if (config.circuitBreaker)
+        result["circuit-breaker"] = *config.circuitBreaker;
+
+    if (config.concurrencyLimit)
+        result["concurrency-limit"] = *config.concurrencyLimit;
+
+    if (config.rateLimit)
+        result["rate-limit"] = *config.rateLimit;
+
+    if (config.loadBalancing)
+        result["load-balancing"] = *config.loadBalancing;
+
+    for (auto const& [operationId, rateLimit] : config.operationRateLimits)
+        result["operation-rate-limits"][operationId] = rateLimit;
+
+    if (config.coalesce)
+        result["coalesce"] = *config.coalesce;
+
+    if (config.responseCache)
+        result["response-cache"] = *config.responseCache;
+
     return result;
 }
 
@@ -150,8 +419,10 @@ std::pair<Config, std::string> configFromNode(YAML::Node const& node)
         throw std::runtime_error(
             "HTTP Settings: Missing 'url' field in: " + YAML::Dump(node));
 
-    if (auto cookies = node["cookies"])
-        conf.cookies = cookies.as<std::map<std::string, std::string>>();
+    if (auto cookies = node["cookies"]) {
+        auto cookiesMap = cookies.as<std::map<std::string, std::string>>();
+        conf.cookies.insert(cookiesMap.begin(), cookiesMap.end());
+    }
 
     if (auto headers = node["headers"]) {
         auto headersMap = headers.as<std::map<std::string, std::string>>();
@@ -169,6 +440,36 @@ std::pair<Config, std::string> configFromNode(YAML::Node const& node)
     if (auto proxy = node["proxy"])
         conf.proxy = proxy.as<Config::Proxy>();
 
+    if (auto timeouts = node["timeouts"])
+        conf.timeouts = timeouts.as<Timeouts>();
+
+    if (auto retry = node["retry"])
+        conf.retry = retry.as<RetryPolicy>();
+
+    if (auto hedging = node["hedging"])
+        conf.hedging = hedging.as<HedgingPolicy>();
+
+    if (auto circuitBreaker = node["circuit-breaker"])
+        conf.circuitBreaker = circuitBreaker.as<CircuitBreakerPolicy>();
+
+    if (auto concurrencyLimit = node["concurrency-limit"])
+        conf.concurrencyLimit = concurrencyLimit.as<ConcurrencyLimitPolicy>();
+
+    if (auto rateLimit = node["rate-limit"])
+        conf.rateLimit = rateLimit.as<RateLimitPolicy>();
+
+    if (auto loadBalancing = node["load-balancing"])
+        conf.loadBalancing = loadBalancing.as<LoadBalancingPolicy>();
+
+    if (auto operationRateLimits = node["operation-rate-limits"])
+        conf.operationRateLimits = operationRateLimits.as<std::map<std::string, RateLimitPolicy>>();
+
+    if (auto coalesce = node["coalesce"])
+        conf.coalesce = coalesce.as<bool>();
+
+    if (auto responseCache = node["response-cache"])
+        conf.responseCache = responseCache.as<bool>();
+
     if (auto apiKey = node["api-key"])
         conf.apiKey = apiKey.as<std::string>();
 
@@ -364,43 +665,194 @@ Config Settings::operator[] (const std::string &url) const
 
 void Config::apply(httplib::Client &cl) const
 {
-    // Headers
-    httplib::Headers httpLibHeaders{headers.begin(), headers.end()};
+    PreparedConfig::get(*this)->apply(*this, cl);
+}
 
+PreparedConfig::PreparedConfig(Config const& config)
+{
     // Cookies
     std::string cookieHeaderValue;
-    for (const auto& cookie : cookies) {
+    for (const auto& cookie : config.cookies) {
         if (!cookieHeaderValue.empty())
             cookieHeaderValue += "; ";
         cookieHeaderValue += cookie.first + "=" + cookie.second;
     }
     if (!cookieHeaderValue.empty())
-        httpLibHeaders.insert({"Cookie", cookieHeaderValue});
+        headers.emplace_back("Cookie", std::move(cookieHeaderValue));
 
     // Basic Authentication
-    if (auth) {
+    if (auto const& auth = config.auth) {
         auto password = auth->password;
         if (!auth->keychain.empty()) {
             password = secret::load(auth->keychain, auth->user);
         }
-        httpLibHeaders.insert(
+        authDigest = sha256(auth->user + '\0' + password);
+        headers.emplace_back(
             httplib::make_basic_authentication_header(auth->user, password));
     }
 
     // Proxy Settings
-    if (proxy) {
-        cl.set_proxy(proxy->host.c_str(), proxy->port);
+    if (config.proxy) {
+        proxy = config.proxy;
+        if (!proxy->keychain.empty()) {
+            proxy->password = secret::load(proxy->keychain, proxy->user);
+            proxy->keychain.clear();
+        }
+    }
+}
+
+namespace
+{
 
-        auto password = proxy->password;
-        if (!proxy->keychain.empty())
-            password = secret::load(proxy->keychain, proxy->user);
+/**
+ * Cache of prepared configs, keyed by the cookie/auth/proxy
+ * values from which they were prepared.
+ */
+struct PreparedConfigCache
+{
+    using Clock = std::chrono::steady_clock;
 
+    struct Entry {
+        Config key;
+        std::shared_ptr<const PreparedConfig> prepared;
+        std::optional<Clock::time_point> expires;
+    };
+
+    static constexpr std::size_t maxSize = 256;
+
+    /**
+     * Passwords from the keychain are not kept for longer than this.
+     */
+    static constexpr auto keychainTtl = std::chrono::minutes(5);
+
+    std::mutex mutex;
+    std::unordered_multimap<std::size_t, Entry> entries;
+
+    static PreparedConfigCache& instance() {
+        static PreparedConfigCache cache;
+        return cache;
+    }
+
+    static bool usesKeychain(Config const& config) {
+        return (config.auth && !config.auth->keychain.empty()) ||
+            (config.proxy && !config.proxy->keychain.empty());
+    }
+
+    static void combine(std::size_t& hash, std::string_view value) {
+        hash ^= std::hash<std::string_view>{}(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+
+    static std::size_t hash(Config const& config) {
+        std::size_t result = 0;
+        for (auto const& [name, value] : config.cookies) {
+            combine(result, name);
+            combine(result, value);
+        }
+        if (auto const& auth = config.auth) {
+            combine(result, auth->user);
+            combine(result, auth->password);
+            combine(result, auth->keychain);
+        }
+        if (auto const& proxy = config.proxy) {
+            combine(result, proxy->host);
+            combine(result, std::to_string(proxy->port));
+            combine(result, proxy->user);
+            combine(result, proxy->password);
+            combine(result, proxy->keychain);
+        }
+        return result;
+    }
+
+    static bool equal(Config const& a, Config const& b) {
+        auto authTie = [](auto const& auth) {
+            return std::tie(auth.user, auth.password, auth.keychain);
+        };
+        auto proxyTie = [](auto const& proxy) {
+            return std::tie(proxy.host, proxy.port, proxy.user, proxy.password, proxy.keychain);
+        };
+        return a.cookies == b.cookies &&
+            a.auth.has_value() == b.auth.has_value() &&
+            (!a.auth || authTie(*a.auth) == authTie(*b.auth)) &&
+            a.proxy.has_value() == b.proxy.has_value() &&
+            (!a.proxy || proxyTie(*a.proxy) == proxyTie(*b.proxy));
+    }
+};
+
+}
+
+std::shared_ptr<const PreparedConfig> PreparedConfig::get(Config const& config)
+{
+    auto& cache = PreparedConfigCache::instance();
+
+    auto hash = PreparedConfigCache::hash(config);
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto [begin, end] = cache.entries.equal_range(hash);
+        for (auto it = begin; it != end; ++it) {
+            if (!PreparedConfigCache::equal(it->second.key, config))
+                continue;
+            if (!it->second.expires || PreparedConfigCache::Clock::now() < *it->second.expires)
+                return it->second.prepared;
+            cache.entries.erase(it);
+            break;
+        }
+    }
+
+    // Prepare outside of the lock, as reading from the keychain may block.
+    auto prepared = std::make_shared<const PreparedConfig>(config);
+
+    Config key;
+    key.cookies = config.cookies;
+    key.auth = config.auth;
+    key.proxy = config.proxy;
+
+    std::optional<PreparedConfigCache::Clock::time_point> expires;
+    if (PreparedConfigCache::usesKeychain(config))
+        expires = PreparedConfigCache::Clock::now() + PreparedConfigCache::keychainTtl;
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.entries.size() >= PreparedConfigCache::maxSize)
+        cache.entries.clear();
+    cache.entries.emplace(hash, PreparedConfigCache::Entry{std::move(key), prepared, expires});
+    return prepared;
+}
+
+void PreparedConfig::invalidate(Config const& config)
+{
+    auto& cache = PreparedConfigCache::instance();
+
+    auto hash = PreparedConfigCache::hash(config);
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto [begin, end] = cache.entries.equal_range(hash);
+    for (auto it = begin; it != end; ++it) {
+        if (PreparedConfigCache::equal(it->second.key, config)) {
+            cache.entries.erase(it);
+            return;
+        }
+    }
+}
+
+httplib::Headers PreparedConfig::requestHeaders(Config const& config) const
+{
+    httplib::Headers result{config.headers.begin(), config.headers.end()};
+    result.insert(headers.begin(), headers.end());
+    return result;
+}
+
+void PreparedConfig::applyProxy(httplib::Client& cl) const
+{
+    if (proxy) {
+        cl.set_proxy(proxy->host.c_str(), proxy->port);
         if (!proxy->user.empty())
             cl.set_proxy_basic_auth(
-                proxy->user.c_str(), password.c_str());
+                proxy->user.c_str(), proxy->password.c_str());
     }
+}
 
-    cl.set_default_headers(httpLibHeaders);
+void PreparedConfig::apply(Config const& config, httplib::Client& cl) const
+{
+    applyProxy(cl);
+    cl.set_default_headers(requestHeaders(config));
 }
 
 std::string Config::toYaml() const {
@@ -408,14 +860,48 @@ std::string Config::toYaml() const {
 }
 
 Config& Config::operator |= (Config const& other) {
-    cookies.insert(other.cookies.begin(), other.cookies.end());
-    headers.insert(other.headers.begin(), other.headers.end());
-    query.insert(other.query.begin(), other.query.end());
+    for (auto const& [name, value] : other.cookies)
+        cookies.tryEmplace(name, value);
+    headers |= other.headers;
+    query |= other.query;
     if (other.auth)
         auth = other.auth;
     if (other.proxy)
         proxy = other.proxy;
     if (other.apiKey)
         apiKey = other.apiKey;
+    timeouts |= other.timeouts;
+    if (other.retry)
+        retry = other.retry;
+    if (other.hedging)
+        hedging = other.hedging;
+    if (other.circuitBreaker)
+        circuitBreaker = other.circuitBreaker;
+    if (other.concurrencyLimit)
+        concurrencyLimit = other.concurrencyLimit;
+    if (other.rateLimit)
+        rateLimit = other.rateLimit;
+    if (other.loadBalancing)
+        loadBalancing = other.loadBalancing;
+    for (auto const& [operationId, rateLimit] : other.operationRateLimits)
+        operationRateLimits.insert_or_assign(operationId, rateLimit);
+    if (other.coalesce)
+        coalesce = other.coalesce;
+    if (other.responseCache)
+        responseCache = other.responseCache;
+    if (other.deadline && (!deadline || *other.deadline < *deadline))
+        deadline = other.deadline;
+    if (other.cancellation)
+        cancellation = other.cancellation;
+    return *this;
+}
+
+Timeouts& Timeouts::operator |= (Timeouts const& other) {
+    if (other.connect)
+        connect = other.connect;
+    if (other.firstByte)
+        firstByte = other.firstByte;
+    if (other.total)
+        total = other.total;
     return *this;
 }
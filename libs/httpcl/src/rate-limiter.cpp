@@ -0,0 +1,141 @@
+#include "rate-limiter.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <ctime>
+#include <iomanip>
+#include <locale>
+#include <sstream>
+
+namespace httpcl
+{
+
+namespace
+{
+
+std::optional<std::int64_t> parseInteger(std::string const& value)
+{
+    std::int64_t result = 0;
+    auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (ec != std::errc() || end != value.data() + value.size())
+        return {};
+    return result;
+}
+
+}
+
+RateLimiter::RateLimiter(RateLimitPolicy policy)
+    : policy_(std::move(policy))
+    , interval_(std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(1. / std::max(policy_.rate, 1e-6))))
+{}
+
+std::optional<RateLimiter::Clock::time_point> RateLimiter::reserve(Clock::time_point waitUntil,
+                                                                   Clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto interval = interval_;
+    if (now < pacedUntil_)
+        interval = std::max(interval, pacedInterval_);
+
+    // A request may be sent once the bucket has room for it: Up to
+    // `burst` intervals before the theoretical arrival time.
+    auto const burst = static_cast<int>(std::max(policy_.burst, 1u));
+    auto const next = std::max(next_, now);
+    auto const sendAt = std::max({now, next - (burst - 1) * interval, blockedUntil_});
+    if (sendAt > now && sendAt > waitUntil)
+        return {};
+
+    next_ = std::max(next, sendAt) + interval;
+    return sendAt;
+}
+
+bool RateLimiter::acquire(Clock::time_point waitUntil,
+                          std::shared_ptr<CancellationToken> const& cancellation)
+{
+    auto now = Clock::now();
+    auto sendAt = reserve(waitUntil, now);
+    if (!sendAt)
+        return false;
+    if (*sendAt > now)
+        return sleepUnlessCancelled(*sendAt - now, cancellation);
+    return true;
+}
+
+void RateLimiter::update(int status, Headers const& headers, Clock::time_point now)
+{
+    std::optional<std::chrono::milliseconds> retryAfter;
+    if (status == 429 || status == 503) {
+        if (auto it = headers.find("Retry-After"); it != headers.end())
+            retryAfter = parseRetryAfter(it->second);
+        // Without a hint, back off for one interval.
+        if (status == 429 && !retryAfter)
+            retryAfter = std::chrono::duration_cast<std::chrono::milliseconds>(interval_);
+    }
+
+    std::optional<std::int64_t> remaining;
+    std::optional<std::int64_t> reset;
+    if (auto it = headers.find("RateLimit-Remaining"); it != headers.end())
+        remaining = parseInteger(it->second);
+    if (auto it = headers.find("RateLimit-Reset"); it != headers.end())
+        reset = parseInteger(it->second);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (retryAfter)
+        blockedUntil_ = std::max(blockedUntil_, now + *retryAfter);
+
+    if (remaining && reset && *reset > 0) {
+        auto const resetAt = now + std::chrono::seconds(*reset);
+        if (*remaining <= 0) {
+            blockedUntil_ = std::max(blockedUntil_, resetAt);
+        }
+        else {
+            pacedUntil_ = resetAt;
+            pacedInterval_ = (resetAt - now) / *remaining;
+        }
+    }
+}
+
+std::shared_ptr<RateLimiter> RateLimiters::get(std::string const& key, RateLimitPolicy const& policy)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& limiter = limiters_[key];
+    if (!limiter)
+        limiter = std::make_shared<RateLimiter>(policy);
+    return limiter;
+}
+
+std::optional<std::chrono::system_clock::time_point> parseHttpDate(std::string const& value)
+{
+    std::tm tm{};
+    std::istringstream ss(value);
+    ss.imbue(std::locale::classic());
+    ss >> std::get_time(&tm, "%a, %d %b %Y %H:%M:%S GMT");
+    if (ss.fail())
+        return {};
+#ifdef _WIN32
+    auto time = _mkgmtime(&tm);
+#else
+    auto time = timegm(&tm);
+#endif
+    if (time == -1)
+        return {};
+    return std::chrono::system_clock::from_time_t(time);
+}
+
+std::optional<std::chrono::milliseconds> parseRetryAfter(
+    std::string const& value,
+    std::chrono::system_clock::time_point now)
+{
+    if (auto seconds = parseInteger(value))
+        return std::chrono::seconds(std::max<std::int64_t>(*seconds, 0));
+
+    auto date = parseHttpDate(value);
+    if (!date)
+        return {};
+    return std::max(std::chrono::duration_cast<std::chrono::milliseconds>(*date - now),
+                    std::chrono::milliseconds(0));
+}
+
+}
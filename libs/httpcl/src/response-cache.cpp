@@ -0,0 +1,252 @@
+#include "response-cache.hpp"
+#include "rate-limiter.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <string_view>
+
+namespace httpcl
+{
+
+namespace
+{
+
+std::string_view trim(std::string_view value)
+{
+    while (!value.empty() && std::isspace(static_cast<unsigned char>(value.front())))
+        value.remove_prefix(1);
+    while (!value.empty() && std::isspace(static_cast<unsigned char>(value.back())))
+        value.remove_suffix(1);
+    return value;
+}
+
+std::optional<std::int64_t> parseSeconds(std::string_view value)
+{
+    std::int64_t result = 0;
+    auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (ec != std::errc() || end != value.data() + value.size())
+        return {};
+    return std::max<std::int64_t>(result, 0);
+}
+
+/**
+ * Whether a Cache-Control header of the response has the directive.
+ */
+bool hasCacheDirective(Headers const& headers, std::string_view name)
+{
+    for (auto const& [header, value] : headers) {
+        if (!Headers::keyEquals(header, "Cache-Control"))
+            continue;
+
+        std::string_view directives(value);
+        while (!directives.empty()) {
+            auto end = std::min(directives.find(','), directives.size());
+            auto directive = trim(directives.substr(0, end));
+            directives.remove_prefix(std::min(end + 1, directives.size()));
+            if (directive.size() == name.size() &&
+                std::equal(directive.begin(), directive.end(), name.begin(), [](unsigned char a, unsigned char b) {
+                    return std::tolower(a) == b;
+                }))
+                return true;
+        }
+    }
+    return false;
+}
+
+std::size_t entrySize(std::string const& key, ResponseCache::Response const& response)
+{
+    auto result = key.size() + response.content.size();
+    for (auto const& [name, value] : response.headers)
+        result += name.size() + value.size();
+    return result;
+}
+
+}
+
+ResponseCache::ResponseCache(std::size_t maxBytes, std::shared_ptr<DiskCache> disk)
+    : maxBytes_(maxBytes)
+    , disk_(std::move(disk))
+{}
+
+ResponseCache::Lookup ResponseCache::lookup(std::string const& key, Clock::time_point now)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end() && disk_) {
+        // The response may have been stored by another process.
+        lock.unlock();
+        auto view = disk_->lookup(key);
+        lock.lock();
+        if (view) {
+            ++stats_.diskHits;
+            auto remaining = std::chrono::duration_cast<Clock::duration>(view->expires - DiskCache::Clock::now());
+            insert(key, {view->status, std::string(view->content), view->headers},
+                   now + std::max(remaining, Clock::duration::zero()));
+            it = index_.find(key);
+        }
+    }
+    if (it == index_.end()) {
+        ++stats_.misses;
+        return {};
+    }
+
+    auto entry = it->second;
+    lru_.splice(lru_.begin(), lru_, entry);
+    if (now < entry->expires) {
+        ++stats_.hits;
+        return {entry->response, true, {}};
+    }
+
+    Lookup result{entry->response, false, {}};
+    auto const& headers = entry->response->headers;
+    if (auto etag = headers.find("ETag"); etag != headers.end())
+        result.conditions.insert({"If-None-Match", etag->second});
+    if (auto lastModified = headers.find("Last-Modified"); lastModified != headers.end())
+        result.conditions.insert({"If-Modified-Since", lastModified->second});
+
+    if (result.conditions.empty()) {
+        evict(entry);
+        ++stats_.misses;
+        return {};
+    }
+
+    ++stats_.revalidations;
+    return result;
+}
+
+void ResponseCache::store(std::string const& key, Response response, Clock::time_point now, bool credentials)
+{
+    auto lifetime = response.status == 200 ? freshnessLifetime(response.headers) : std::nullopt;
+    if (lifetime && *lifetime == Clock::duration::zero() &&
+        !response.headers.count("ETag") && !response.headers.count("Last-Modified"))
+        lifetime.reset();
+
+    // Other users of the disk cache must not see personalized responses.
+    auto const shareable = !hasCacheDirective(response.headers, "private") &&
+        (!credentials || hasCacheDirective(response.headers, "public"));
+    if (lifetime && disk_ && shareable)
+        disk_->store(key, response.status, response.content, response.headers,
+                     DiskCache::Clock::now() + std::chrono::duration_cast<DiskCache::Clock::duration>(*lifetime));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto it = index_.find(key); it != index_.end())
+        evict(it->second);
+    if (lifetime)
+        insert(key, std::move(response), now + *lifetime);
+}
+
+std::shared_ptr<const ResponseCache::Response> ResponseCache::notModified(
+    std::string const& key,
+    Headers const& headers,
+    Clock::time_point now)
+{
+    std::shared_ptr<const Response> result;
+    std::optional<Clock::duration> lifetime;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end())
+            return {};
+
+        ++stats_.notModified;
+        auto entry = it->second;
+        lifetime = freshnessLifetime(headers);
+        if (!lifetime)
+            lifetime = freshnessLifetime(entry->response->headers);
+        entry->expires = now + lifetime.value_or(Clock::duration::zero());
+        result = entry->response;
+    }
+
+    if (disk_)
+        disk_->touch(key, DiskCache::Clock::now() +
+            std::chrono::duration_cast<DiskCache::Clock::duration>(lifetime.value_or(Clock::duration::zero())));
+    return result;
+}
+
+ResponseCache::Stats ResponseCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void ResponseCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    index_.clear();
+    stats_.entries = 0;
+    stats_.bytes = 0;
+}
+
+std::optional<ResponseCache::Clock::duration> ResponseCache::freshnessLifetime(Headers const& headers)
+{
+    if (auto vary = headers.find("Vary"); vary != headers.end() && trim(vary->second) == "*")
+        return {};
+
+    std::optional<std::int64_t> maxAge;
+    for (auto const& [name, value] : headers) {
+        if (!Headers::keyEquals(name, "Cache-Control"))
+            continue;
+
+        std::string_view directives(value);
+        while (!directives.empty()) {
+            auto end = std::min(directives.find(','), directives.size());
+            auto directive = std::string(trim(directives.substr(0, end)));
+            directives.remove_prefix(std::min(end + 1, directives.size()));
+            std::transform(directive.begin(), directive.end(), directive.begin(),
+                           [](unsigned char c) { return std::tolower(c); });
+
+            if (directive == "no-store")
+                return {};
+            if (directive == "no-cache")
+                maxAge = 0;
+            else if (directive.rfind("max-age=", 0) == 0 && !maxAge)
+                maxAge = parseSeconds(std::string_view(directive).substr(8));
+        }
+    }
+
+    Clock::duration lifetime = Clock::duration::zero();
+    if (maxAge) {
+        lifetime = std::chrono::seconds(*maxAge);
+    }
+    else if (auto expires = headers.find("Expires"); expires != headers.end()) {
+        // Invalid dates, like "0", mean that the response has already expired.
+        if (auto date = parseHttpDate(expires->second)) {
+            auto const now = std::chrono::system_clock::now();
+            lifetime = std::max(std::chrono::duration_cast<Clock::duration>(*date - now), Clock::duration::zero());
+        }
+    }
+
+    if (auto age = headers.find("Age"); age != headers.end())
+        if (auto seconds = parseSeconds(trim(age->second)))
+            lifetime = std::max(lifetime - std::chrono::seconds(*seconds), Clock::duration::zero());
+
+    return lifetime;
+}
+
+void ResponseCache::insert(std::string const& key, Response response, Clock::time_point expires)
+{
+    auto const bytes = entrySize(key, response);
+    if (bytes > maxBytes_)
+        return;
+    if (auto it = index_.find(key); it != index_.end())
+        evict(it->second);
+    while (stats_.bytes + bytes > maxBytes_)
+        evict(std::prev(lru_.end()));
+
+    lru_.push_front({key, std::make_shared<const Response>(std::move(response)), expires, bytes});
+    index_.emplace(key, lru_.begin());
+    stats_.bytes += bytes;
+    ++stats_.entries;
+}
+
+void ResponseCache::evict(std::list<Entry>::iterator it)
+{
+    stats_.bytes -= it->bytes;
+    --stats_.entries;
+    index_.erase(it->key);
+    lru_.erase(it);
+}
+
+}
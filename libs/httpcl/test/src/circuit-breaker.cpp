@@ -0,0 +1,110 @@
+#include <catch2/catch_all.hpp>
+
+#include "httpcl/circuit-breaker.hpp"
+#include "httpcl/http-client.hpp"
+
+using namespace httpcl;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+using State = CircuitBreaker::State;
+using Outcome = CircuitBreaker::Outcome;
+
+/**
+ * Send n requests with the given outcome.
+ */
+void send(CircuitBreaker& breaker, unsigned n, Outcome outcome, CircuitBreaker::Clock::time_point now)
+{
+    for (auto i = 0u; i < n; ++i) {
+        auto permit = breaker.tryAcquire(now);
+        REQUIRE(permit);
+        breaker.record(*permit, outcome, now);
+    }
+}
+
+}
+
+TEST_CASE("Circuit breaker", "[httpcl::circuit-breaker]") {
+    CircuitBreakerPolicy policy;
+    policy.failureRate = 0.5;
+    policy.window = 10;
+    policy.minRequests = 4;
+    policy.openDuration = 1s;
+    policy.probes = 2;
+
+    CircuitBreaker breaker(policy);
+    auto now = CircuitBreaker::Clock::now();
+
+    SECTION("Opens once the failure rate is exceeded") {
+        send(breaker, 6, Outcome::Success, now);
+        send(breaker, 4, Outcome::Failure, now);
+        REQUIRE(breaker.state() == State::Closed);
+
+        // The oldest success drops out of the window: 5 of 10 failed.
+        send(breaker, 1, Outcome::Failure, now);
+        REQUIRE(breaker.state() == State::Open);
+        REQUIRE_FALSE(breaker.tryAcquire(now + 999ms));
+    }
+
+    SECTION("Cancelled requests are ignored") {
+        send(breaker, 10, Outcome::Ignored, now);
+        send(breaker, 1, Outcome::Failure, now);
+        REQUIRE(breaker.state() == State::Closed);
+    }
+
+    SECTION("Probes close the circuit again") {
+        send(breaker, 4, Outcome::Failure, now);
+        REQUIRE(breaker.state() == State::Open);
+
+        auto probe = breaker.tryAcquire(now + 1s);
+        REQUIRE(probe);
+        REQUIRE(probe->probe);
+        REQUIRE(breaker.state() == State::HalfOpen);
+
+        // Only one probe at a time.
+        REQUIRE_FALSE(breaker.tryAcquire(now + 1s));
+        breaker.record(*probe, Outcome::Success, now + 1s);
+        REQUIRE(breaker.state() == State::HalfOpen);
+
+        send(breaker, 1, Outcome::Success, now + 1s);
+        REQUIRE(breaker.state() == State::Closed);
+    }
+
+    SECTION("A failed probe opens the circuit again") {
+        send(breaker, 4, Outcome::Failure, now);
+        send(breaker, 1, Outcome::Failure, now + 1s);
+        REQUIRE(breaker.state() == State::Open);
+        REQUIRE_FALSE(breaker.tryAcquire(now + 1500ms));
+        REQUIRE(breaker.tryAcquire(now + 2s));
+    }
+
+    SECTION("Stale outcomes are ignored") {
+        // Sent before the circuit opened, finished after it closed again.
+        auto permit = breaker.tryAcquire(now);
+        send(breaker, 4, Outcome::Failure, now);
+        send(breaker, 2, Outcome::Success, now + 1s);
+        REQUIRE(breaker.state() == State::Closed);
+
+        breaker.record(*permit, Outcome::Failure, now + 1s);
+        send(breaker, 3, Outcome::Failure, now + 1s);
+        REQUIRE(breaker.state() == State::Closed);
+    }
+}
+
+TEST_CASE("Circuit breakers of a transport", "[httpcl::circuit-breaker]") {
+    HttpLibHttpClient client;
+    Config config;
+    config.circuitBreaker = CircuitBreakerPolicy{1., 2, 2};
+
+    // Nothing listens on the discard port, so requests fail fast.
+    auto const uri = std::string("http://127.0.0.1:9/api");
+    REQUIRE(client.get(uri, config).status == 0);
+    REQUIRE(client.get(uri, config).status == 0);
+    REQUIRE(client.circuitStates() == std::map<std::string, State>{{"http://127.0.0.1:9", State::Open}});
+    REQUIRE_THROWS_AS(client.get(uri, config), IHttpClient::CircuitOpenError);
+
+    // Requests without a policy are not affected.
+    REQUIRE(client.get(uri, {}).status == 0);
+}
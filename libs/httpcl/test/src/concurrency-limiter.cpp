@@ -0,0 +1,105 @@
+#include <catch2/catch_all.hpp>
+
+#include <thread>
+
+#include "httpcl/concurrency-limiter.hpp"
+
+using namespace httpcl;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+using Outcome = ConcurrencyLimiter::Outcome;
+
+/**
+ * Acquire slots until the limit is reached.
+ */
+void saturate(ConcurrencyLimiter& limiter)
+{
+    while (limiter.acquire(ConcurrencyLimiter::Clock::now()));
+}
+
+/**
+ * Complete n requests with the given outcome and round-trip
+ * time, sending a new request after each of them.
+ */
+void run(ConcurrencyLimiter& limiter, unsigned n, Outcome outcome, std::chrono::milliseconds rtt)
+{
+    for (auto i = 0u; i < n; ++i) {
+        saturate(limiter);
+        limiter.release(outcome, rtt);
+    }
+}
+
+}
+
+TEST_CASE("Concurrency limiter", "[httpcl::concurrency-limiter]") {
+    ConcurrencyLimitPolicy policy;
+    policy.initialLimit = 4;
+    policy.minLimit = 2;
+    policy.maxLimit = 16;
+
+    ConcurrencyLimiter limiter(policy);
+    REQUIRE(limiter.stats().limit == 4);
+
+    SECTION("Requests beyond the limit are shed") {
+        saturate(limiter);
+        auto stats = limiter.stats();
+        REQUIRE(stats.inFlight == 4);
+        REQUIRE(stats.shed == 1);
+
+        REQUIRE_FALSE(limiter.acquire(ConcurrencyLimiter::Clock::now() + 10ms));
+        REQUIRE(limiter.stats().shed == 2);
+
+        limiter.release(Outcome::Ignored, {});
+        REQUIRE(limiter.acquire(ConcurrencyLimiter::Clock::now()));
+    }
+
+    SECTION("Queued requests get freed slots") {
+        saturate(limiter);
+        std::thread releaser([&] {
+            while (limiter.stats().queued == 0)
+                std::this_thread::yield();
+            limiter.release(Outcome::Ignored, {});
+        });
+        REQUIRE(limiter.acquire(ConcurrencyLimiter::Clock::now() + 10s));
+        releaser.join();
+        REQUIRE(limiter.stats().inFlight == 4);
+    }
+
+    SECTION("Cancellation wakes up queued requests") {
+        saturate(limiter);
+        auto token = std::make_shared<CancellationToken>();
+        std::thread canceller([&] {
+            while (limiter.stats().queued == 0)
+                std::this_thread::yield();
+            token->cancel();
+        });
+        REQUIRE_FALSE(limiter.acquire(ConcurrencyLimiter::Clock::now() + 10s, token));
+        canceller.join();
+    }
+
+    SECTION("The limit grows while latency is stable") {
+        run(limiter, 50, Outcome::Success, 10ms);
+        REQUIRE(limiter.stats().limit == 16);
+
+        SECTION("and shrinks when latency increases") {
+            run(limiter, 20, Outcome::Success, 100ms);
+            REQUIRE(limiter.stats().limit < 12);
+        }
+    }
+
+    SECTION("Dropped requests shrink the limit") {
+        run(limiter, 20, Outcome::Dropped, 10ms);
+        REQUIRE(limiter.stats().limit == 2);
+    }
+
+    SECTION("The limit is kept while it is not used") {
+        for (auto i = 0; i < 20; ++i) {
+            REQUIRE(limiter.acquire(ConcurrencyLimiter::Clock::now()));
+            limiter.release(Outcome::Dropped, 10ms);
+        }
+        REQUIRE(limiter.stats().limit == 4);
+    }
+}
@@ -0,0 +1,122 @@
+#include <catch2/catch_all.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "httpcl/response-cache.hpp"
+
+using namespace httpcl;
+using namespace std::chrono_literals;
+
+#ifndef _WIN32
+
+TEST_CASE("Disk response cache", "[httpcl::disk-cache]") {
+    auto dir = std::filesystem::temp_directory_path() / "httpcl-test-disk-cache";
+    std::filesystem::remove_all(dir);
+    auto const expires = DiskCache::Clock::now() + 60s;
+
+    // Separate instances lock the directory like separate processes.
+    DiskCache writer(dir, 64 << 10);
+    DiskCache reader(dir, 64 << 10);
+
+    SECTION("Responses are shared between instances") {
+        REQUIRE_FALSE(reader.lookup("a"));
+        writer.store("a", 200, "content", {{"ETag", "\"v1\""}, {"X-Empty", ""}}, expires);
+
+        auto view = reader.lookup("a");
+        REQUIRE(view);
+        REQUIRE(view->status == 200);
+        REQUIRE(view->content == "content");
+        REQUIRE(view->headers == Headers{{"ETag", "\"v1\""}, {"X-Empty", ""}});
+        REQUIRE(view->expires - expires < 1ms);
+        REQUIRE_FALSE(reader.lookup("b"));
+
+        REQUIRE(reader.touch("a", expires + 60s));
+        REQUIRE(writer.lookup("a")->expires > expires + 59s);
+        REQUIRE_FALSE(writer.touch("b", expires));
+    }
+
+    SECTION("Keys are not written, and files are private") {
+        writer.store("Authorization: secret", 200, "content", {}, expires);
+        REQUIRE(reader.lookup("Authorization: secret")->content == "content");
+        REQUIRE_FALSE(reader.lookup("Authorization: other"));
+
+        using std::filesystem::perms;
+        REQUIRE((std::filesystem::status(dir).permissions() & perms::all) == perms::owner_all);
+        for (auto const& entry : std::filesystem::directory_iterator(dir)) {
+            REQUIRE((entry.status().permissions() & perms::all) == (perms::owner_read | perms::owner_write));
+            std::ifstream file(entry.path(), std::ios::binary);
+            std::string data{std::istreambuf_iterator<char>(file), {}};
+            REQUIRE(data.find("secret") == std::string::npos);
+        }
+    }
+
+    SECTION("Later responses replace earlier ones") {
+        writer.store("a", 200, "v1", {}, expires);
+        REQUIRE(reader.lookup("a")->content == "v1");
+        reader.store("a", 200, "v2", {}, expires);
+        REQUIRE(writer.lookup("a")->content == "v2");
+    }
+
+    SECTION("Oldest segments are evicted") {
+        std::string content(1000, 'x');
+        for (auto i = 0; i < 200; ++i)
+            writer.store(std::to_string(i), 200, content, {}, expires);
+        REQUIRE(writer.bytes() <= 64 << 10);
+        REQUIRE_FALSE(reader.lookup("0"));
+        REQUIRE(reader.lookup("199")->content == content);
+
+        // Responses larger than a segment are not stored.
+        writer.store("large", 200, std::string(64 << 10, 'x'), {}, expires);
+        REQUIRE_FALSE(reader.lookup("large"));
+    }
+
+    SECTION("Views stay valid after eviction") {
+        writer.store("a", 200, "content", {}, expires);
+        auto view = reader.lookup("a");
+        for (auto i = 0; i < 200; ++i)
+            writer.store(std::to_string(i), 200, std::string(1000, 'x'), {}, expires);
+        REQUIRE_FALSE(writer.lookup("a"));
+        REQUIRE(view->content == "content");
+    }
+
+    SECTION("The index is compacted") {
+        for (auto i = 0; i < 3000; ++i)
+            writer.store("a", 200, std::to_string(i), {}, expires);
+        REQUIRE(std::filesystem::file_size(dir / "index") < 40 * 1100);
+        REQUIRE(reader.lookup("a")->content == "2999");
+        writer.store("a", 200, "new", {}, expires);
+        REQUIRE(reader.lookup("a")->content == "new");
+    }
+
+    SECTION("Memory caches share responses through the disk") {
+        auto disk = std::make_shared<DiskCache>(dir, 64 << 10);
+        ResponseCache first(1000, disk);
+        ResponseCache second(1000, std::make_shared<DiskCache>(dir, 64 << 10));
+
+        auto const now = ResponseCache::Clock::now();
+        first.store("a", {200, "content", {{"Cache-Control", "max-age=60"}}}, now);
+        auto lookup = second.lookup("a", now);
+        REQUIRE(lookup.fresh);
+        REQUIRE(lookup.response->content == "content");
+        REQUIRE(second.lookup("a", now).fresh);
+        REQUIRE(second.stats().diskHits == 1);
+        REQUIRE(second.stats().hits == 2);
+        REQUIRE_FALSE(second.lookup("a", now + 60s).response);
+
+        // Responses for credentials need to be public, private ones are never shared.
+        first.store("b", {200, "content", {{"Cache-Control", "max-age=60"}}}, now, true);
+        first.store("c", {200, "content", {{"Cache-Control", "Public, max-age=60"}}}, now, true);
+        first.store("d", {200, "content", {{"Cache-Control", "private, max-age=60"}}}, now);
+        REQUIRE(first.lookup("b", now).fresh);
+        REQUIRE(first.lookup("d", now).fresh);
+        REQUIRE_FALSE(second.lookup("b", now).response);
+        REQUIRE(second.lookup("c", now).fresh);
+        REQUIRE_FALSE(second.lookup("d", now).response);
+    }
+
+    std::filesystem::remove_all(dir);
+}
+
+#endif
@@ -0,0 +1,74 @@
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+#include "httpcl/dns-cache.hpp"
+
+using namespace httpcl;
+using namespace std::chrono_literals;
+
+TEST_CASE("DNS cache", "[httpcl::dns-cache]") {
+    std::atomic<int> lookups{0};
+    std::atomic<bool> failing{false};
+    std::vector<std::string> addresses{"10.0.0.1", "10.0.0.2"};
+
+    DnsCache dns([&](std::string const& host) -> std::vector<std::string> {
+        ++lookups;
+        if (failing)
+            throw std::runtime_error("resolver down");
+        if (host != "example.com")
+            return {};
+        return addresses;
+    }, 10s);
+    auto const start = DnsCache::Clock::now();
+
+    SECTION("Addresses are cached and rotated") {
+        REQUIRE(dns.resolve("example.com", start) == "10.0.0.1");
+        REQUIRE(dns.resolve("example.com", start + 1s) == "10.0.0.2");
+        REQUIRE(dns.resolve("example.com", start + 2s) == "10.0.0.1");
+        REQUIRE(lookups == 1);
+    }
+
+    SECTION("Expired addresses are resolved again") {
+        dns.resolve("example.com", start);
+        addresses = {"10.0.0.3"};
+        REQUIRE(dns.resolve("example.com", start + 11s) == "10.0.0.3");
+        REQUIRE(lookups == 2);
+    }
+
+    SECTION("Addresses are refreshed in the background before they expire") {
+        dns.resolve("example.com", start);
+        addresses = {"10.0.0.3"};
+
+        // Still served from the cache, while the refresh is pending.
+        REQUIRE(dns.resolve("example.com", start + 9s));
+        for (auto i = 0; i < 100 && lookups < 2; ++i)
+            std::this_thread::sleep_for(10ms);
+        REQUIRE(lookups == 2);
+        REQUIRE(dns.resolve("example.com", DnsCache::Clock::now()) == "10.0.0.3");
+    }
+
+    SECTION("Previous addresses are kept if resolving fails") {
+        dns.resolve("example.com", start);
+        failing = true;
+        REQUIRE(dns.resolve("example.com", start + 11s));
+        REQUIRE(lookups == 2);
+        // ... but only for a fifth of the TTL.
+        REQUIRE(dns.resolve("example.com", start + 14s));
+        REQUIRE(lookups == 3);
+    }
+
+    SECTION("Unknown hosts are not cached") {
+        REQUIRE_FALSE(dns.resolve("unknown", start));
+        REQUIRE_FALSE(dns.resolve("unknown", start));
+        REQUIRE(lookups == 2);
+    }
+
+    SECTION("Replacing the resolver drops all addresses") {
+        dns.resolve("example.com", start);
+        dns.setResolver([](auto&&) { return std::vector<std::string>{"127.0.0.1"}; });
+        REQUIRE(dns.resolve("example.com", start) == "127.0.0.1");
+    }
+}
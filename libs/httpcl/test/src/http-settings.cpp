@@ -0,0 +1,223 @@
+#include <catch2/catch_all.hpp>
+
+#include <thread>
+
+#include "httpcl/http-settings.hpp"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Prepared configs", "[httpcl::http-settings]") {
+    httpcl::Config config;
+    config.cookies.insert({"session", "s"});
+    config.cookies.insert({"tenant", "t"});
+    config.auth = httpcl::Config::BasicAuthentication{"user", "pw", ""};
+    config.proxy = httpcl::Config::Proxy{"proxy.local", 3128, "proxyuser", "proxypw", ""};
+    config.headers.insert({"X-Request", "1"});
+
+    auto prepared = httpcl::PreparedConfig::get(config);
+
+    SECTION("Cookie and auth headers are prepared") {
+        REQUIRE(prepared->headers.size() == 2);
+        REQUIRE(prepared->headers[0] == std::pair<std::string, std::string>{"Cookie", "session=s; tenant=t"});
+        REQUIRE(prepared->headers[1] == httplib::make_basic_authentication_header("user", "pw"));
+        REQUIRE(prepared->proxy->host == "proxy.local");
+        REQUIRE(prepared->proxy->password == "proxypw");
+    }
+
+    SECTION("Identical configs are prepared once") {
+        auto other = config;
+        other.headers.insert({"X-Request", "2"});
+        other.query.insert({"q", "1"});
+        REQUIRE(httpcl::PreparedConfig::get(other) == prepared);
+    }
+
+    SECTION("Changed configs are prepared again") {
+        auto other = config;
+        other.cookies.set("session", "s2");
+        REQUIRE(httpcl::PreparedConfig::get(other) != prepared);
+        REQUIRE(httpcl::PreparedConfig::get(other)->headers[0].second == "session=s2; tenant=t");
+
+        other = config;
+        other.proxy->port = 8080;
+        REQUIRE(httpcl::PreparedConfig::get(other) != prepared);
+
+        other = config;
+        other.auth.reset();
+        REQUIRE(httpcl::PreparedConfig::get(other)->headers.size() == 1);
+        REQUIRE(httpcl::PreparedConfig::get(other)->authDigest.empty());
+    }
+
+    SECTION("Passwords are told apart by their digest") {
+        REQUIRE(prepared->authDigest.size() == 32);
+        REQUIRE(prepared->authDigest.find("pw") == std::string::npos);
+
+        auto other = config;
+        other.auth->password = "wrong";
+        REQUIRE(httpcl::PreparedConfig::get(other)->authDigest != prepared->authDigest);
+    }
+
+    SECTION("Invalidated configs are prepared again") {
+        httpcl::PreparedConfig::invalidate(config);
+        auto again = httpcl::PreparedConfig::get(config);
+        REQUIRE(again != prepared);
+        REQUIRE(httpcl::PreparedConfig::get(config) == again);
+        REQUIRE(again->headers == prepared->headers);
+    }
+}
+
+TEST_CASE("Request timeouts", "[httpcl::http-settings]") {
+    httpcl::Config config;
+    config.timeouts.connect = std::chrono::milliseconds(500);
+    config.timeouts.total = std::chrono::milliseconds(3000);
+
+    SECTION("Timeouts are stored in YAML") {
+        auto yaml = config.toYaml();
+        REQUIRE(yaml.find("first-byte") == std::string::npos);
+        auto parsed = httpcl::Config(yaml);
+        REQUIRE(parsed.timeouts.connect == std::chrono::milliseconds(500));
+        REQUIRE_FALSE(parsed.timeouts.firstByte);
+        REQUIRE(parsed.timeouts.total == std::chrono::milliseconds(3000));
+    }
+
+    SECTION("Retry policies are stored in YAML") {
+        config.retry = httpcl::RetryPolicy{5, std::chrono::milliseconds(50), std::chrono::milliseconds(1000), 0.2};
+        auto parsed = httpcl::Config(config.toYaml());
+        REQUIRE(parsed.retry);
+        REQUIRE(parsed.retry->maxAttempts == 5);
+        REQUIRE(parsed.retry->initialBackoff == std::chrono::milliseconds(50));
+        REQUIRE(parsed.retry->maxBackoff == std::chrono::milliseconds(1000));
+        REQUIRE(parsed.retry->budget == 0.2);
+        REQUIRE_FALSE(httpcl::Config(httpcl::Config().toYaml()).retry);
+    }
+
+    SECTION("Hedging policies are stored in YAML") {
+        config.hedging = httpcl::HedgingPolicy{99., std::chrono::milliseconds(20), 0.02};
+        auto parsed = httpcl::Config(config.toYaml());
+        REQUIRE(parsed.hedging);
+        REQUIRE(parsed.hedging->percentile == 99.);
+        REQUIRE(parsed.hedging->minDelay == std::chrono::milliseconds(20));
+        REQUIRE(parsed.hedging->budget == 0.02);
+    }
+
+    SECTION("Circuit breaker policies are stored in YAML") {
+        config.circuitBreaker = httpcl::CircuitBreakerPolicy{0.25, 40, 5, std::chrono::milliseconds(800)};
+        auto parsed = httpcl::Config(config.toYaml());
+        REQUIRE(parsed.circuitBreaker);
+        REQUIRE(parsed.circuitBreaker->failureRate == 0.25);
+        REQUIRE(parsed.circuitBreaker->window == 40);
+        REQUIRE(parsed.circuitBreaker->minRequests == 5);
+        REQUIRE(parsed.circuitBreaker->slowRequest == std::chrono::milliseconds(800));
+        REQUIRE(parsed.circuitBreaker->openDuration == std::chrono::milliseconds(30000));
+        REQUIRE(parsed.circuitBreaker->probes == 1);
+    }
+
+    SECTION("Concurrency limit policies are stored in YAML") {
+        config.concurrencyLimit = httpcl::ConcurrencyLimitPolicy{8, 2, 64, 1.5, std::chrono::milliseconds(250)};
+        auto parsed = httpcl::Config(config.toYaml());
+        REQUIRE(parsed.concurrencyLimit);
+        REQUIRE(parsed.concurrencyLimit->initialLimit == 8);
+        REQUIRE(parsed.concurrencyLimit->minLimit == 2);
+        REQUIRE(parsed.concurrencyLimit->maxLimit == 64);
+        REQUIRE(parsed.concurrencyLimit->tolerance == 1.5);
+        REQUIRE(parsed.concurrencyLimit->maxWait == std::chrono::milliseconds(250));
+    }
+
+    SECTION("Rate limit policies are stored in YAML") {
+        config.rateLimit = httpcl::RateLimitPolicy{50., 10, std::chrono::milliseconds(200)};
+        config.operationRateLimits["getTile"] = httpcl::RateLimitPolicy{2.5};
+        auto parsed = httpcl::Config(config.toYaml());
+        REQUIRE(parsed.rateLimit);
+        REQUIRE(parsed.rateLimit->rate == 50.);
+        REQUIRE(parsed.rateLimit->burst == 10);
+        REQUIRE(parsed.rateLimit->maxWait == std::chrono::milliseconds(200));
+        REQUIRE(parsed.operationRateLimits.size() == 1);
+        REQUIRE(parsed.operationRateLimits["getTile"].rate == 2.5);
+        REQUIRE(parsed.operationRateLimits["getTile"].burst == 1);
+
+        httpcl::Config other;
+        other.operationRateLimits["getTile"] = httpcl::RateLimitPolicy{1.};
+        other.operationRateLimits["getInfo"] = httpcl::RateLimitPolicy{5.};
+        parsed |= other;
+        REQUIRE(parsed.operationRateLimits.size() == 2);
+        REQUIRE(parsed.operationRateLimits["getTile"].rate == 1.);
+    }
+
+    SECTION("Load balancing policies are stored in YAML") {
+        config.loadBalancing = httpcl::LoadBalancingPolicy{
+            httpcl::LoadBalancingPolicy::Strategy::PowerOfTwoChoices, 5, std::chrono::milliseconds(1000)};
+        auto parsed = httpcl::Config(config.toYaml());
+        REQUIRE(parsed.loadBalancing);
+        REQUIRE(parsed.loadBalancing->strategy == httpcl::LoadBalancingPolicy::Strategy::PowerOfTwoChoices);
+        REQUIRE(parsed.loadBalancing->maxFailures == 5);
+        REQUIRE(parsed.loadBalancing->ejectionTime == std::chrono::milliseconds(1000));
+    }
+
+    SECTION("Coalescing is stored in YAML") {
+        REQUIRE_FALSE(httpcl::Config(config.toYaml()).coalesce);
+        config.coalesce = true;
+        REQUIRE(httpcl::Config(config.toYaml()).coalesce == true);
+    }
+
+    SECTION("Response caching is stored in YAML") {
+        REQUIRE_FALSE(httpcl::Config(config.toYaml()).responseCache);
+        config.responseCache = true;
+        REQUIRE(httpcl::Config(config.toYaml()).responseCache == true);
+    }
+
+    SECTION("Merging keeps the earlier deadline") {
+        auto now = std::chrono::steady_clock::now();
+        config.deadline = now + std::chrono::seconds(1);
+
+        httpcl::Config other;
+        other.timeouts.connect = std::chrono::milliseconds(100);
+        other.deadline = now + std::chrono::seconds(2);
+        other.cancellation = std::make_shared<httpcl::CancellationToken>();
+
+        config |= other;
+        REQUIRE(config.timeouts.connect == std::chrono::milliseconds(100));
+        REQUIRE(config.timeouts.total == std::chrono::milliseconds(3000));
+        REQUIRE(config.deadline == now + std::chrono::seconds(1));
+        REQUIRE(config.cancellation == other.cancellation);
+    }
+}
+
+TEST_CASE("Cancellation tokens", "[httpcl::cancellation]") {
+    auto token = std::make_shared<httpcl::CancellationToken>();
+    auto calls = 0;
+
+    SECTION("Subscribed callbacks are called once") {
+        auto subscription = httpcl::CancellationToken::subscribe(token, [&] { ++calls; });
+        REQUIRE_FALSE(token->cancelled());
+        token->cancel();
+        token->cancel();
+        REQUIRE(token->cancelled());
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("Expired subscriptions are not called") {
+        {
+            auto subscription = httpcl::CancellationToken::subscribe(token, [&] { ++calls; });
+        }
+        token->cancel();
+        REQUIRE(calls == 0);
+    }
+
+    SECTION("Subscribing to a cancelled token calls back immediately") {
+        token->cancel();
+        auto subscription = httpcl::CancellationToken::subscribe(token, [&] { ++calls; });
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("Sleeping is interrupted by cancellation") {
+        REQUIRE(httpcl::sleepUnlessCancelled(1ms, token));
+
+        std::thread canceller([&] {
+            std::this_thread::sleep_for(10ms);
+            token->cancel();
+        });
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE_FALSE(httpcl::sleepUnlessCancelled(10s, token));
+        REQUIRE(std::chrono::steady_clock::now() - start < 5s);
+        canceller.join();
+    }
+}
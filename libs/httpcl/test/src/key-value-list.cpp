@@ -0,0 +1,159 @@
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <new>
+
+#include "httpcl/http-settings.hpp"
+
+namespace
+{
+
+std::atomic<std::size_t> allocations{0};
+
+/**
+ * Count the heap allocations made by fun.
+ */
+template <class Fun>
+std::size_t countAllocations(Fun&& fun)
+{
+    auto before = allocations.load();
+    fun();
+    return allocations.load() - before;
+}
+
+httpcl::Config makeConfig(std::string const& prefix)
+{
+    httpcl::Config config;
+    for (auto i = 0; i < 4; ++i)
+        config.headers.insert({prefix + "-H" + std::to_string(i), "value"});
+    for (auto i = 0; i < 2; ++i)
+        config.query.insert({prefix + "-q" + std::to_string(i), "value"});
+    config.cookies.insert({prefix + "-c", "value"});
+    return config;
+}
+
+/**
+ * Node-based layout of httpcl::Config before the flat lists,
+ * for comparison.
+ */
+struct MultimapConfig
+{
+    std::map<std::string, std::string> cookies;
+    std::multimap<std::string, std::string> headers;
+    std::multimap<std::string, std::string> query;
+
+    explicit MultimapConfig(httpcl::Config const& config)
+        : cookies(config.cookies.begin(), config.cookies.end())
+        , headers(config.headers.begin(), config.headers.end())
+        , query(config.query.begin(), config.query.end())
+    {}
+
+    MultimapConfig& operator |= (MultimapConfig const& other) {
+        cookies.insert(other.cookies.begin(), other.cookies.end());
+        headers.insert(other.headers.begin(), other.headers.end());
+        query.insert(other.query.begin(), other.query.end());
+        return *this;
+    }
+};
+
+}
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    if (auto result = std::malloc(size ? size : 1))
+        return result;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+TEST_CASE("Key-value lists", "[httpcl::key-value-list]") {
+    httpcl::Headers headers{{"Accept", "a"}, {"X-Value", "1"}};
+
+    SECTION("Header names are case-insensitive") {
+        REQUIRE(headers.find("accept")->second == "a");
+        REQUIRE(headers.count("ACCEPT") == 1);
+        REQUIRE(headers.find("Accept-Encoding") == headers.end());
+    }
+
+    SECTION("Insertion order is kept") {
+        headers.insert({"accept", "b"});
+        headers.insert({"A", "c"});
+        REQUIRE(headers.count("Accept") == 2);
+        REQUIRE(headers == httpcl::Headers{{"Accept", "a"}, {"X-Value", "1"}, {"accept", "b"}, {"A", "c"}});
+    }
+
+    SECTION("Set and erase") {
+        headers.insert({"accept", "b"});
+        headers.set("ACCEPT", "c");
+        REQUIRE(headers == httpcl::Headers{{"ACCEPT", "c"}, {"X-Value", "1"}});
+        REQUIRE(headers.erase("x-value") == 1);
+        REQUIRE(headers.size() == 1);
+    }
+
+    SECTION("Query parameter names are case-sensitive") {
+        httpcl::Query query{{"key", "a"}};
+        REQUIRE(query.find("KEY") == query.end());
+        REQUIRE_FALSE(query.tryEmplace("key", "b").second);
+        REQUIRE(query.tryEmplace("KEY", "b").second);
+        REQUIRE(query.size() == 2);
+    }
+}
+
+TEST_CASE("Config merging", "[httpcl::key-value-list]") {
+    auto settings = makeConfig("settings");
+    auto adHoc = makeConfig("adhoc");
+    adHoc.cookies.insert({"settings-c", "other"});
+
+    auto merged = settings;
+    merged |= adHoc;
+    REQUIRE(merged.headers.size() == 8);
+    REQUIRE(merged.query.size() == 4);
+    REQUIRE(merged.cookies.size() == 2);
+    REQUIRE(merged.cookies.find("settings-c")->second == "value");
+    REQUIRE(merged.headers.begin()->first == "settings-H0");
+
+    SECTION("Fewer allocations than node-based containers") {
+        auto flat = countAllocations([&] {
+            auto config = settings;
+            config |= adHoc;
+        });
+        auto nodeBased = countAllocations([&, settings = MultimapConfig(settings), adHoc = MultimapConfig(adHoc)] {
+            auto config = settings;
+            config |= adHoc;
+        });
+        // One node per entry vs. (at most) one buffer per list and merge.
+        REQUIRE(nodeBased == 14);
+        REQUIRE(flat <= 6);
+    }
+}
+
+TEST_CASE("Config merging benchmark", "[.][benchmark]") {
+    auto settings = makeConfig("settings");
+    auto adHoc = makeConfig("adhoc");
+    auto nodeSettings = MultimapConfig(settings);
+    auto nodeAdHoc = MultimapConfig(adHoc);
+
+    BENCHMARK("Flat lists") {
+        auto config = settings;
+        config |= adHoc;
+        return config;
+    };
+
+    BENCHMARK("Node-based containers") {
+        auto config = nodeSettings;
+        config |= nodeAdHoc;
+        return config;
+    };
+}
@@ -0,0 +1,74 @@
+#include <catch2/catch_all.hpp>
+
+#include "httpcl/rate-limiter.hpp"
+
+using namespace httpcl;
+using namespace std::chrono_literals;
+
+TEST_CASE("Rate limiter", "[httpcl::rate-limiter]") {
+    RateLimitPolicy policy;
+    policy.rate = 10.;
+    policy.burst = 3;
+
+    RateLimiter limiter(policy);
+    auto const now = RateLimiter::Clock::now();
+
+    SECTION("Bursts are sent at once, then requests are paced") {
+        for (auto i = 0; i < 3; ++i)
+            REQUIRE(limiter.reserve(now, now) == now);
+        REQUIRE_FALSE(limiter.reserve(now + 99ms, now));
+        REQUIRE(limiter.reserve(now + 1s, now) == now + 100ms);
+        REQUIRE(limiter.reserve(now + 1s, now) == now + 200ms);
+
+        // The bucket refills while it is not used.
+        auto const later = now + 10s;
+        for (auto i = 0; i < 3; ++i)
+            REQUIRE(limiter.reserve(later, later) == later);
+        REQUIRE_FALSE(limiter.reserve(later, later));
+    }
+
+    SECTION("Retry-After pauses all requests") {
+        limiter.update(429, {{"Retry-After", "2"}}, now);
+        REQUIRE_FALSE(limiter.reserve(now + 1s, now));
+        REQUIRE(limiter.reserve(now + 2s, now) == now + 2s);
+
+        // Without a Retry-After header, a 429 pauses for one interval.
+        limiter.update(429, {}, now + 3s);
+        REQUIRE(limiter.reserve(now + 4s, now + 3s) == now + 3s + 100ms);
+    }
+
+    SECTION("An exhausted quota pauses requests until it is reset") {
+        limiter.update(200, {{"RateLimit-Remaining", "0"}, {"RateLimit-Reset", "5"}}, now);
+        REQUIRE(limiter.reserve(now + 10s, now) == now + 5s);
+    }
+
+    SECTION("A low quota spreads requests until it is reset") {
+        limiter.update(200, {{"ratelimit-remaining", "2"}, {"ratelimit-reset", "4"}}, now);
+        REQUIRE(limiter.reserve(now + 10s, now) == now);
+        REQUIRE(limiter.reserve(now + 10s, now) == now);
+        REQUIRE(limiter.reserve(now + 10s, now) == now);
+        REQUIRE(limiter.reserve(now + 10s, now) == now + 2s);
+    }
+
+    SECTION("Waiting for a turn") {
+        policy.rate = 100.;
+        policy.burst = 1;
+        RateLimiter fast(policy);
+        auto start = RateLimiter::Clock::now();
+        REQUIRE(fast.acquire(start + 1s));
+        REQUIRE(fast.acquire(start + 1s));
+        REQUIRE(RateLimiter::Clock::now() - start >= 10ms);
+
+        auto token = std::make_shared<CancellationToken>();
+        token->cancel();
+        REQUIRE_FALSE(fast.acquire(start + 1s, token));
+    }
+}
+
+TEST_CASE("Retry-After parsing", "[httpcl::rate-limiter]") {
+    auto now = std::chrono::system_clock::from_time_t(1445412480); // Wed, 21 Oct 2015 07:28:00 GMT
+    REQUIRE(parseRetryAfter("2", now) == 2000ms);
+    REQUIRE(parseRetryAfter("Wed, 21 Oct 2015 07:28:03 GMT", now) == 3000ms);
+    REQUIRE(parseRetryAfter("Wed, 21 Oct 2015 07:27:00 GMT", now) == 0ms);
+    REQUIRE_FALSE(parseRetryAfter("soon", now));
+}
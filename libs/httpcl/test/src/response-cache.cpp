@@ -0,0 +1,89 @@
+#include <catch2/catch_all.hpp>
+
+#include "httpcl/response-cache.hpp"
+
+using namespace httpcl;
+using namespace std::chrono_literals;
+
+TEST_CASE("Response cache", "[httpcl::response-cache]") {
+    ResponseCache cache(1000);
+    auto const now = ResponseCache::Clock::now();
+
+    SECTION("Fresh responses are served") {
+        cache.store("a", {200, "content", {{"Cache-Control", "public, max-age=10"}}}, now);
+        auto lookup = cache.lookup("a", now + 9s);
+        REQUIRE(lookup.fresh);
+        REQUIRE(lookup.response->content == "content");
+        REQUIRE_FALSE(cache.lookup("b", now).response);
+
+        // Without a validator, a stale response is evicted.
+        REQUIRE_FALSE(cache.lookup("a", now + 10s).response);
+        auto stats = cache.stats();
+        REQUIRE(stats.hits == 1);
+        REQUIRE(stats.misses == 2);
+        REQUIRE(stats.entries == 0);
+        REQUIRE(stats.bytes == 0);
+    }
+
+    SECTION("Stale responses are revalidated") {
+        cache.store("a", {200, "content", {{"ETag", "\"v1\""}, {"Last-Modified", "Sun, 06 Nov 1994 08:49:37 GMT"}}}, now);
+        auto lookup = cache.lookup("a", now);
+        REQUIRE_FALSE(lookup.fresh);
+        REQUIRE(lookup.response->content == "content");
+        REQUIRE(lookup.conditions == Headers{{"If-None-Match", "\"v1\""},
+                                             {"If-Modified-Since", "Sun, 06 Nov 1994 08:49:37 GMT"}});
+
+        auto response = cache.notModified("a", {{"Cache-Control", "max-age=5"}}, now);
+        REQUIRE(response->content == "content");
+        REQUIRE(cache.lookup("a", now + 4s).fresh);
+        REQUIRE_FALSE(cache.lookup("a", now + 5s).fresh);
+
+        auto stats = cache.stats();
+        REQUIRE(stats.revalidations == 2);
+        REQUIRE(stats.notModified == 1);
+        REQUIRE(stats.hits == 1);
+    }
+
+    SECTION("Uncacheable responses are not stored") {
+        cache.store("a", {200, "content", {{"Cache-Control", "max-age=10"}}}, now);
+        cache.store("a", {200, "content", {{"Cache-Control", "no-store, max-age=10"}}}, now);
+        REQUIRE_FALSE(cache.lookup("a", now).response);
+
+        cache.store("a", {404, "", {{"Cache-Control", "max-age=10"}}}, now);
+        cache.store("b", {200, "", {{"Cache-Control", "max-age=10"}, {"Vary", "*"}}}, now);
+        cache.store("c", {200, "", {}}, now);
+        cache.store("d", {200, std::string(1000, 'x'), {{"Cache-Control", "max-age=10"}}}, now);
+        REQUIRE(cache.stats().entries == 0);
+    }
+
+    SECTION("Least recently used responses are evicted") {
+        ResponseCache::Response response{200, std::string(300, 'x'), {{"Cache-Control", "max-age=10"}}};
+        cache.store("a", response, now);
+        cache.store("b", response, now);
+        cache.store("c", response, now);
+        REQUIRE(cache.lookup("a", now).fresh);
+
+        cache.store("d", response, now);
+        REQUIRE(cache.stats().entries == 3);
+        REQUIRE(cache.stats().bytes <= 1000);
+        REQUIRE_FALSE(cache.lookup("b", now).response);
+        REQUIRE(cache.lookup("a", now).fresh);
+        REQUIRE(cache.lookup("c", now).fresh);
+        REQUIRE(cache.lookup("d", now).fresh);
+
+        cache.clear();
+        REQUIRE(cache.stats().bytes == 0);
+    }
+
+    SECTION("Freshness lifetime") {
+        auto lifetime = [](Headers const& headers) { return ResponseCache::freshnessLifetime(headers); };
+        REQUIRE(lifetime({}) == 0s);
+        REQUIRE(lifetime({{"cache-control", "MAX-AGE=60"}}) == 60s);
+        REQUIRE(lifetime({{"Cache-Control", "max-age=60"}, {"Age", "20"}}) == 40s);
+        REQUIRE(lifetime({{"Cache-Control", "no-cache, max-age=60"}}) == 0s);
+        REQUIRE(lifetime({{"Expires", "0"}}) == 0s);
+        REQUIRE(lifetime({{"Expires", "Sun, 06 Nov 1994 08:49:37 GMT"}}) == 0s);
+        REQUIRE(*lifetime({{"Expires", "Thu, 31 Dec 2099 23:59:59 GMT"}}) > 24h);
+        REQUIRE_FALSE(lifetime({{"Cache-Control", "no-store"}}));
+    }
+}
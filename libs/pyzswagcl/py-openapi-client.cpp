@@ -65,15 +65,68 @@ namespace
 
 void PyOpenApiClient::bind(py::module_& m) {
     auto serviceClient = py::class_<PyOpenApiClient>(m, "OAClient")
-        .def(py::init<std::string, bool, httpcl::Config, std::optional<std::string>, std::optional<std::string>>(),
+        .def(py::init<std::string, bool, httpcl::Config, std::optional<std::string>, std::optional<std::string>, bool>(),
             "url"_a, "is_local_file"_a = false, "config"_a = httpcl::Config(),
-            "api_key"_a = std::optional<std::string>(), "bearer"_a = std::optional<std::string>())
+            "api_key"_a = std::optional<std::string>(), "bearer"_a = std::optional<std::string>(),
+            "shared"_a = false)
         // zserio >= 2.3.0
         .def("call_method", &PyOpenApiClient::callMethod,
-            "method_name"_a, "request"_a, "unused"_a)
+            "method_name"_a, "request"_a, "context"_a = py::none())
         .def("config", [](PyOpenApiClient const& self)->OpenAPIConfig const&{
-            return self.client_->config_;
-        }, py::return_value_policy::reference_internal);
+            return *self.client_->config_;
+        }, py::return_value_policy::reference_internal)
+        .def("metrics", [](PyOpenApiClient const& self) {
+            auto metrics = self.client_->metrics();
+            py::dict circuits;
+            for (auto const& [origin, state] : metrics.circuits)
+                circuits[py::str(origin)] = httpcl::to_string(state);
+            py::dict concurrency;
+            for (auto const& [origin, stats] : metrics.concurrency)
+                concurrency[py::str(origin)] = py::dict(
+                    "limit"_a = stats.limit,
+                    "in_flight"_a = stats.inFlight,
+                    "queued"_a = stats.queued,
+                    "shed"_a = stats.shed);
+            py::dict servers;
+            for (auto const& [url, stats] : metrics.servers)
+                servers[py::str(url)] = py::dict(
+                    "outstanding"_a = stats.outstanding,
+                    "latency"_a = stats.latency ? py::cast(stats.latency->count() / 1e6) : py::object(py::none()),
+                    "consecutive_failures"_a = stats.consecutiveFailures,
+                    "ejected"_a = stats.ejected);
+            py::object cache = py::none();
+            if (metrics.cache)
+                cache = py::dict(
+                    "hits"_a = metrics.cache->hits,
+                    "misses"_a = metrics.cache->misses,
+                    "revalidations"_a = metrics.cache->revalidations,
+                    "not_modified"_a = metrics.cache->notModified,
+                    "disk_hits"_a = metrics.cache->diskHits,
+                    "entries"_a = metrics.cache->entries,
+                    "bytes"_a = metrics.cache->bytes);
+            return py::dict(
+                "hedges_issued"_a = metrics.hedgesIssued,
+                "hedges_won"_a = metrics.hedgesWon,
+                "coalesced"_a = metrics.coalesced,
+                "coalescing"_a = metrics.coalescing,
+                "memoized"_a = metrics.memoized,
+                "circuits"_a = circuits,
+                "concurrency"_a = concurrency,
+                "cache"_a = cache,
+                "servers"_a = servers);
+        })
+        .def("warmup", [](PyOpenApiClient& self, std::size_t connections) {
+            auto report = self.client_->warmup(connections);
+            auto const secs = [](std::chrono::microseconds d) { return d.count() / 1e6; };
+            return py::dict(
+                "resolve"_a = secs(report.resolve),
+                "settings"_a = secs(report.settings),
+                "plans"_a = secs(report.plans),
+                "connect"_a = secs(report.connect),
+                "total"_a = secs(report.total),
+                "methods"_a = report.methods,
+                "connections"_a = report.connections);
+        }, "connections"_a = 1);
 
     py::object serviceClientBase = py::module::import("zserio").attr("ServiceInterface");
     serviceClient.attr("__bases__") = py::make_tuple(serviceClientBase) + serviceClient.attr("__bases__");
@@ -83,13 +136,25 @@ PyOpenApiClient::PyOpenApiClient(std::string const& openApiUrl,
                                  bool isLocalFile,
                                  httpcl::Config const& config,
                                  std::optional<std::string> apiKey,
-                                 std::optional<std::string> bearer)
+                                 std::optional<std::string> bearer,
+                                 bool shared)
 {
     auto httpConfig = config; // writable copy
     if (apiKey)
         httpConfig.apiKey = std::move(apiKey);
     if (bearer)
         httpConfig.headers.insert({"Authorization", stx::format("Bearer {}", *bearer)});
+
+    if (shared) {
+        auto& registry = OpenAPIRegistry::instance();
+        auto openApiConfig = isLocalFile ?
+            registry.load(openApiUrl) :
+            registry.fetch(openApiUrl, httpConfig);
+        client_ = std::make_unique<OpenAPIClient>(
+            openApiConfig, httpConfig, registry.httpClient(), registry.settings());
+        return;
+    }
+
     auto httpClient = std::make_unique<HttpLibHttpClient>();
     OpenAPIConfig openApiConfig = [&](){
         if (isLocalFile) {
@@ -100,18 +165,23 @@ PyOpenApiClient::PyOpenApiClient(std::string const& openApiUrl,
             return fetchOpenAPIConfig(openApiUrl, *httpClient, httpConfig);
     }();
 
-    client_ = std::make_unique<OpenAPIClient>(openApiConfig, httpConfig, std::move(httpClient));
+    client_ = std::make_unique<OpenAPIClient>(std::move(openApiConfig), httpConfig, std::move(httpClient));
 }
 
 std::vector<uint8_t> PyOpenApiClient::callMethod(
         const std::string& methodName,
         py::object request,
-        py::object unused)
+        py::object context)
 {
     if (!request) {
         throw std::runtime_error("The request argument is None!");
     }
 
+    // Other context objects are ignored, as before.
+    CallContext const* callContext = nullptr;
+    if (py::isinstance<CallContext>(context))
+        callContext = context.cast<CallContext const*>();
+
     auto response = client_->call(methodName, [&](const std::string& parameter, const std::string& field, ParameterValueHelper& helper)
     {
         if (field == ZSERIO_REQUEST_PART_WHOLE) {
@@ -143,7 +213,7 @@ std::vector<uint8_t> PyOpenApiClient::callMethod(
         }
 
         return helper.value(valueFromPyObject(value.ptr()));
-    });
+    }, callContext);
 
     std::vector<uint8_t> responseData;
     responseData.assign(response.begin(), response.end());
@@ -1,4 +1,5 @@
 #include "zswagcl/private/openapi-client.hpp"
+#include "zswagcl/private/openapi-registry.hpp"
 #include <pybind11/pybind11.h>
 #include <pybind11/stl_bind.h>
 #include <pybind11/stl.h>
@@ -18,12 +19,13 @@ public:
                     bool isLocalFile,
                     httpcl::Config const& config,
                     std::optional<std::string> apiKey,
-                    std::optional<std::string> bearer);
+                    std::optional<std::string> bearer,
+                    bool shared);
 
     std::vector<uint8_t> callMethod(
         const std::string& methodName,
         py::object request,
-        py::object unused);
+        py::object context);
 
 private:
     std::unique_ptr<zswagcl::OpenAPIClient> client_;
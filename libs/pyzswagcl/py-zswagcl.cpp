@@ -4,7 +4,9 @@
 #include <pybind11/functional.h>
 #include <fstream>
 
+#include "zswagcl/private/openapi-client.hpp"
 #include "zswagcl/private/openapi-parser.hpp"
+#include "zswagcl/private/openapi-snapshot.hpp"
 #include "httpcl/http-settings.hpp"
 #include "py-openapi-client.h"
 #include "stx/format.h"
@@ -24,7 +26,10 @@ PYBIND11_MODULE(pyzswagcl, m)
     py::bind_map<PyOpenApiClient::Headers>(m, "HeaderMap");
     py::implicitly_convertible<py::dict, PyOpenApiClient::Headers>();
 
-    py::register_exception<httpcl::IHttpClient::Error>(m, "HTTPError");
+    auto httpError = py::register_exception<httpcl::IHttpClient::Error>(m, "HTTPError");
+    py::register_exception<httpcl::IHttpClient::CircuitOpenError>(m, "CircuitOpenError", httpError.ptr());
+    py::register_exception<httpcl::IHttpClient::ConcurrencyLimitError>(m, "ConcurrencyLimitError", httpError.ptr());
+    py::register_exception<httpcl::IHttpClient::RateLimitError>(m, "RateLimitError", httpError.ptr());
 
     ///////////////////////////////////////////////////////////////////////////
     // ParameterLocation
@@ -43,6 +48,7 @@ PYBIND11_MODULE(pyzswagcl, m)
             .value("HEX", OpenAPIConfig::Parameter::Format::Hex)
             .value("BASE64", OpenAPIConfig::Parameter::Format::Base64)
             .value("BASE64URL", OpenAPIConfig::Parameter::Format::Base64url)
+            .value("ZSTD_BASE64URL", OpenAPIConfig::Parameter::Format::ZstdBase64url)
             .value("BINARY", OpenAPIConfig::Parameter::Format::Binary)
             ;
 
@@ -64,6 +70,13 @@ PYBIND11_MODULE(pyzswagcl, m)
             .def_readonly("http_method", &OpenAPIConfig::Path::httpMethod)
             .def_readonly("parameters", &OpenAPIConfig::Path::parameters)
             .def_readonly("body_request_object", &OpenAPIConfig::Path::bodyRequestObject)
+            .def_readonly("body_fallback", &OpenAPIConfig::Path::bodyFallback)
+            .def_property_readonly("idempotent", &OpenAPIConfig::Path::isIdempotent)
+            .def_property_readonly("cache_ttl", [](OpenAPIConfig::Path const& self) -> std::optional<double> {
+                if (self.cacheTtl)
+                    return static_cast<double>(self.cacheTtl->count()) / 1000.;
+                return {};
+            })
             ;
 
     ///////////////////////////////////////////////////////////////////////////
@@ -80,7 +93,7 @@ PYBIND11_MODULE(pyzswagcl, m)
             return &self;
         }, "key"_a, "val"_a)
         .def("cookie", [](httpcl::Config& self, std::string const& key, std::string const& value) {
-            self.cookies.insert({key, value});
+            self.cookies.tryEmplace(key, value);
             return &self;
         }, "key"_a, "val"_a)
         .def("bearer", [](httpcl::Config& self, std::string const& key) {
@@ -103,6 +116,80 @@ PYBIND11_MODULE(pyzswagcl, m)
             };
             return &self;
         }, "host"_a, "port"_a, "user"_a, "pw"_a)
+        .def("retry", [](httpcl::Config& self, unsigned maxAttempts, double initialBackoff, double maxBackoff, double budget) {
+            self.retry = httpcl::RetryPolicy{
+                maxAttempts,
+                std::chrono::milliseconds(static_cast<std::int64_t>(initialBackoff * 1000.)),
+                std::chrono::milliseconds(static_cast<std::int64_t>(maxBackoff * 1000.)),
+                budget
+            };
+            return &self;
+        }, "max_attempts"_a = 3, "initial_backoff"_a = .1, "max_backoff"_a = 5., "budget"_a = .1)
+        .def("hedging", [](httpcl::Config& self, double percentile, double minDelay, double budget) {
+            self.hedging = httpcl::HedgingPolicy{
+                percentile,
+                std::chrono::milliseconds(static_cast<std::int64_t>(minDelay * 1000.)),
+                budget
+            };
+            return &self;
+        }, "percentile"_a = 95., "min_delay"_a = .01, "budget"_a = .05)
+        .def("circuit_breaker", [](httpcl::Config& self, double failureRate, unsigned window, unsigned minRequests,
+                                   std::optional<double> slowRequest, double openDuration, unsigned probes) {
+            httpcl::CircuitBreakerPolicy policy{failureRate, window, minRequests};
+            if (slowRequest)
+                policy.slowRequest = std::chrono::milliseconds(static_cast<std::int64_t>(*slowRequest * 1000.));
+            policy.openDuration = std::chrono::milliseconds(static_cast<std::int64_t>(openDuration * 1000.));
+            policy.probes = probes;
+            self.circuitBreaker = policy;
+            return &self;
+        }, "failure_rate"_a = .5, "window"_a = 20, "min_requests"_a = 10,
+           "slow_request"_a = std::optional<double>(), "open_duration"_a = 30., "probes"_a = 1)
+        .def("concurrency_limit", [](httpcl::Config& self, unsigned initialLimit, unsigned minLimit, unsigned maxLimit,
+                                     double tolerance, double maxWait) {
+            self.concurrencyLimit = httpcl::ConcurrencyLimitPolicy{
+                initialLimit,
+                minLimit,
+                maxLimit,
+                tolerance,
+                std::chrono::milliseconds(static_cast<std::int64_t>(maxWait * 1000.))
+            };
+            return &self;
+        }, "initial_limit"_a = 20, "min_limit"_a = 1, "max_limit"_a = 200, "tolerance"_a = 2., "max_wait"_a = .1)
+        .def("rate_limit", [](httpcl::Config& self, double rate, unsigned burst, double maxWait, std::optional<std::string> const& operation) {
+            httpcl::RateLimitPolicy policy{
+                rate,
+                burst,
+                std::chrono::milliseconds(static_cast<std::int64_t>(maxWait * 1000.))
+            };
+            if (operation)
+                self.operationRateLimits.insert_or_assign(*operation, policy);
+            else
+                self.rateLimit = policy;
+            return &self;
+        }, "rate"_a, "burst"_a = 1, "max_wait"_a = 1., "operation"_a = std::optional<std::string>())
+        .def("load_balancing", [](httpcl::Config& self, std::string const& strategy, unsigned maxFailures, double ejectionTime) {
+            httpcl::LoadBalancingPolicy policy;
+            if (strategy == "round-robin")
+                policy.strategy = httpcl::LoadBalancingPolicy::Strategy::RoundRobin;
+            else if (strategy == "least-outstanding")
+                policy.strategy = httpcl::LoadBalancingPolicy::Strategy::LeastOutstanding;
+            else if (strategy == "ewma")
+                policy.strategy = httpcl::LoadBalancingPolicy::Strategy::PowerOfTwoChoices;
+            else
+                throw std::invalid_argument("Unknown load balancing strategy '" + strategy + "'.");
+            policy.maxFailures = std::max(maxFailures, 1u);
+            policy.ejectionTime = std::chrono::milliseconds(static_cast<std::int64_t>(ejectionTime * 1000.));
+            self.loadBalancing = policy;
+            return &self;
+        }, "strategy"_a = "round-robin", "max_failures"_a = 3, "ejection_time"_a = 30.)
+        .def("coalesce", [](httpcl::Config& self, bool enabled) {
+            self.coalesce = enabled;
+            return &self;
+        }, "enabled"_a = true)
+        .def("response_cache", [](httpcl::Config& self, bool enabled) {
+            self.responseCache = enabled;
+            return &self;
+        }, "enabled"_a = true)
         .def(py::pickle(
             [](httpcl::Config const& self) {
                 return py::make_tuple(self.toYaml());
@@ -112,28 +199,69 @@ PYBIND11_MODULE(pyzswagcl, m)
                 return Config(t[0].cast<std::string>());
             }));
 
+    ///////////////////////////////////////////////////////////////////////////
+    // Per-call deadlines and cancellation
+
+    py::class_<CancellationToken, std::shared_ptr<CancellationToken>>(m, "CancellationToken")
+        .def(py::init<>())
+        .def("cancel", &CancellationToken::cancel)
+        .def_property_readonly("cancelled", &CancellationToken::cancelled);
+
+    py::class_<CallContext>(m, "CallContext")
+        .def(py::init([](std::optional<double> timeout,
+                         std::optional<double> connectTimeout,
+                         std::optional<double> firstByteTimeout,
+                         std::shared_ptr<CancellationToken> cancellation) {
+            auto toMs = [](std::optional<double> const& seconds) -> std::optional<std::chrono::milliseconds> {
+                if (!seconds)
+                    return {};
+                return std::chrono::milliseconds(static_cast<std::int64_t>(*seconds * 1000.));
+            };
+            CallContext result;
+            result.timeouts.total = toMs(timeout);
+            result.timeouts.connect = toMs(connectTimeout);
+            result.timeouts.firstByte = toMs(firstByteTimeout);
+            result.cancellation = std::move(cancellation);
+            return result;
+        }), "timeout"_a = std::nullopt, "connect_timeout"_a = std::nullopt,
+            "first_byte_timeout"_a = std::nullopt, "cancellation"_a = nullptr)
+        .def("header", [](CallContext& self, std::string const& key, std::string const& value) {
+            self.headers.set(key, value);
+            return &self;
+        }, "key"_a, "val"_a);
+
     ///////////////////////////////////////////////////////////////////////////
     // OpenAPIConfig
     py::class_<OpenAPIConfig>(m, "OAConfig")
         .def("__contains__", [](const OpenAPIConfig& self, std::string const& methodName) {
-            return self.methodPath.find(methodName) != self.methodPath.end();
+            return self.findPath(methodName) != nullptr;
         }, py::is_operator(), "method_name"_a)
         .def("__getitem__", [](const OpenAPIConfig& self, std::string const& methodName) {
-            auto it = self.methodPath.find(methodName);
-            if (it != self.methodPath.end())
-                return it->second;
+            if (auto path = self.findPath(methodName))
+                return *path;
             else
                 throw std::runtime_error(
                     "Could not find OpenAPI config for method name "s+methodName);
         }, py::is_operator(), py::return_value_policy::reference_internal, "method_name"_a)
-        .def_readonly("content", &OpenAPIConfig::content)
+        .def_property_readonly("content", [](OpenAPIConfig const& self) {
+            return self.content ? *self.content : std::string();
+        })
+        .def_readonly("content_hash", &OpenAPIConfig::contentHash)
         ;
 
-    m.def("parse_openapi_config", [](std::string const& path){
+    m.def("parse_openapi_config", [](std::string const& path, bool retainContent, bool lazyOperations){
         std::ifstream ifs;
         ifs.open(path);
-        return parseOpenAPIConfig(ifs);
-    }, py::return_value_policy::move, "path"_a);
+        return parseOpenAPIConfig(ifs, {retainContent, lazyOperations});
+    }, py::return_value_policy::move, "path"_a, "retain_content"_a = true, "lazy_operations"_a = false);
+
+    m.def("write_openapi_config_snapshot", [](OpenAPIConfig const& config, std::string const& path){
+        std::ofstream ofs(path, std::ios::binary);
+        writeOpenAPIConfigSnapshot(config, ofs);
+    }, "config"_a, "path"_a);
+
+    m.def("load_openapi_config_snapshot", &loadOpenAPIConfigSnapshot,
+          py::return_value_policy::move, "path"_a, "content_hash"_a = std::nullopt, "retain_content"_a = true);
 
     m.def("fetch_openapi_config", [](std::string const& url){
         HttpLibHttpClient httpClient;
@@ -145,6 +273,10 @@ PYBIND11_MODULE(pyzswagcl, m)
     m.attr("ZSERIO_OBJECT_CONTENT_TYPE") = py::str(ZSERIO_OBJECT_CONTENT_TYPE);
     m.attr("ZSERIO_REQUEST_PART") = py::str(ZSERIO_REQUEST_PART);
     m.attr("ZSERIO_REQUEST_PART_WHOLE") = py::str(ZSERIO_REQUEST_PART_WHOLE);
+    m.attr("ZSWAG_BODY_FALLBACK") = py::str(ZSWAG_BODY_FALLBACK);
+    m.attr("ZSWAG_TIMEOUTS") = py::str(ZSWAG_TIMEOUTS);
+    m.attr("ZSWAG_IDEMPOTENT") = py::str(ZSWAG_IDEMPOTENT);
+    m.attr("ZSWAG_CACHE") = py::str(ZSWAG_CACHE);
 
     ///////////////////////////////////////////////////////////////////////////
     // PyOpenApiClient
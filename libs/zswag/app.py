@@ -9,7 +9,8 @@ from flask import request as flask_request
 
 from pyzswagcl import \
     parse_openapi_config, \
-    OAMethod
+    OAMethod, \
+    ZSERIO_OBJECT_CONTENT_TYPE
 
 from .reflect import request_object_blob, service_method_request_type, to_snake
 
@@ -168,6 +169,16 @@ class OAServer(connexion.App):
                 return bytes(fun(request_blob, None).byte_array)
             setattr(self.service_instance, method_name, wsgi_method)
 
+            # Clients switch to the body fallback operation for oversized URLs.
+            # It is served by the same method, with the request blob as body.
+            if method_spec.body_fallback:
+                fallback_spec: OAMethod = self.spec[method_spec.body_fallback]
+                if not fallback_spec.body_request_object:
+                    print(f"ERROR: {method_spec.body_fallback} must accept a {ZSERIO_OBJECT_CONTENT_TYPE} body!")
+                else:
+                    setattr(self.service_instance, method_spec.body_fallback,
+                            lambda fun=wsgi_method, spec=fallback_spec, **kwargs: fun(spec=spec, **kwargs))
+
             def method_impl(request, ctx=None, fun=user_function):
                 return fun(request)
             setattr(self.service_instance, f"_{method_snake_name}_impl", method_impl)
@@ -22,6 +22,9 @@ from pyzswagcl import \
     ZSERIO_OBJECT_CONTENT_TYPE, \
     ZSERIO_REQUEST_PART_WHOLE, \
     ZSERIO_REQUEST_PART, \
+    ZSWAG_BODY_FALLBACK, \
+    ZSWAG_IDEMPOTENT, \
+    ZSWAG_CACHE, \
     parse_openapi_config
 
 from .reflect import \
@@ -48,12 +51,20 @@ class HttpParamFormat(Enum):
     BYTE = "byte"
     BASE64 = "base64"
     BASE64URL = "base64url"
+    ZSTD_BASE64URL = "x-zstd-base64url"
     HEX = "hex"
 
 
 HTTP_METHOD_TAGS = ("get", "put", "post", "delete")
 FLATTEN_TAG = "flat"
 BLOB_TAG = "blob"
+BODY_FALLBACK_TAG = "body-fallback"
+BODY_FALLBACK_OPERATION_SUFFIX = "ViaBody"
+BODY_FALLBACK_PATH_SUFFIX = "/body"
+IDEMPOTENT_TAG = "idempotent"
+CACHE_TAG = "cache"
+CACHE_ASSIGNMENT_TAG = "cache="
+DEFAULT_CACHE_TTL_MS = 60000
 SECURITY_ASSIGNMENT_TAG = "security="
 PATH_ASSIGNMENT_TAG = "path="
 WILDCARD_CONFIG = "*"
@@ -90,6 +101,9 @@ class MethodConfig:
     param_specifiers: Optional[List[ParamSpecifier]] = dc.field(default_factory=list)
     security: Optional[str] = None
     path: Optional[str] = None
+    body_fallback: bool = False
+    idempotent: bool = False
+    cache_ttl: Optional[int] = None  # Milliseconds
     openapi_docstring: str = ""
     openapi_return_type: str = ""
     openapi_arg_type: str = "Unknown"
@@ -198,6 +212,17 @@ class OpenApiSchemaGenerator:
                 new_config.flatten = True
             elif tag == BLOB_TAG:
                 new_config.flatten = False
+            elif tag == BODY_FALLBACK_TAG:
+                new_config.body_fallback = True
+            elif tag == IDEMPOTENT_TAG:
+                new_config.idempotent = True
+            elif tag == CACHE_TAG:
+                new_config.cache_ttl = DEFAULT_CACHE_TTL_MS
+            elif tag.startswith(CACHE_ASSIGNMENT_TAG):
+                try:
+                    new_config.cache_ttl = int(tag[len(CACHE_ASSIGNMENT_TAG):])
+                except ValueError:
+                    raise OpenApiGenError(f"Expected a TTL in milliseconds for '{tag}'.")
             elif tag.startswith(SECURITY_ASSIGNMENT_TAG):
                 new_config.security = tag[len(SECURITY_ASSIGNMENT_TAG):]
             elif tag.startswith(PATH_ASSIGNMENT_TAG):
@@ -267,31 +292,7 @@ class OpenApiSchemaGenerator:
                 "version": "TODO",
             }),
             "servers": self.base_config.get("servers", []),
-            "paths": {
-                method_info.path: {
-                    method_info.http_method: {
-                        "summary": method_info.openapi_docstring,
-                        "description": method_info.openapi_docstring,
-                        "operationId": method_info.name,
-                        **method_info.openapi_parameters,
-                        "responses": {
-                            "200": {
-                                "description": method_info.openapi_result_doc,
-                                "content": {
-                                    ZSERIO_OBJECT_CONTENT_TYPE: {
-                                        "schema": {
-                                            "type": "string",
-                                            "format": "binary"
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    },
-                } for method_info in (
-                    self.process_method_config(method_name)
-                    for method_name in self.service_instance.method_names)
-            }
+            "paths": self.generate_paths()
         }
         if security_schemes := self.base_config.get("securitySchemes", None):
             schema["components"] = {
@@ -322,6 +323,62 @@ class OpenApiSchemaGenerator:
             print(f"[INFO] Skipping zswag parser validation.")
         print(f"[INFO] Done.")
 
+    def generate_paths(self) -> dict:
+        paths = dict()
+        for method_info in (self.process_method_config(name) for name in self.service_instance.method_names):
+            paths.setdefault(method_info.path, dict())[method_info.http_method] = \
+                self.generate_operation(method_info, method_info.name, method_info.openapi_parameters)
+            # Add a POST operation which accepts the request object as body,
+            # for clients to use if the URL parameters get too long.
+            if fallback_id := method_info.openapi_parameters.get(ZSWAG_BODY_FALLBACK, None):
+                fallback_parameters = {
+                    "requestBody": self.generate_request_body(method_info),
+                    **({"security": method_info.openapi_parameters["security"]}
+                       if "security" in method_info.openapi_parameters else {})
+                }
+                fallback_path = method_info.path.split("{")[0].rstrip("/") + BODY_FALLBACK_PATH_SUFFIX
+                if "post" in paths.get(fallback_path, {}):
+                    raise OpenApiGenError(f"Cannot add body fallback for {method_info.name}: "
+                                          f"The path `{fallback_path}` already has a POST operation.")
+                paths.setdefault(fallback_path, dict())["post"] = \
+                    self.generate_operation(method_info, fallback_id, fallback_parameters)
+        return paths
+
+    @staticmethod
+    def generate_operation(method_info: MethodConfig, operation_id: str, parameters: dict) -> dict:
+        return {
+            "summary": method_info.openapi_docstring,
+            "description": method_info.openapi_docstring,
+            "operationId": operation_id,
+            **parameters,
+            "responses": {
+                "200": {
+                    "description": method_info.openapi_result_doc,
+                    "content": {
+                        ZSERIO_OBJECT_CONTENT_TYPE: {
+                            "schema": {
+                                "type": "string",
+                                "format": "binary"
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+    @staticmethod
+    def generate_request_body(method_info: MethodConfig) -> dict:
+        return {
+            "description": method_info.openapi_arg_doc,
+            "content": {
+                ZSERIO_OBJECT_CONTENT_TYPE: {
+                    "schema": {
+                        "type": "string"
+                    }
+                }
+            }
+        }
+
     def process_method_config(self, method_name: str) -> MethodConfig:
         result = self.config_for_method(method_name)
         req_t = service_method_request_type(self.service_instance, result.name)
@@ -383,22 +440,13 @@ class OpenApiSchemaGenerator:
             # Easy - parameter only indicates binary transfer of the
             # request object in the body
             if param_specifier.location == HttpParamLocation.BODY:
-                config.openapi_parameters["requestBody"] = {
-                    "description": config.openapi_arg_doc,
-                    "content": {
-                        ZSERIO_OBJECT_CONTENT_TYPE: {
-                            "schema": {
-                                "type": "string"
-                            }
-                        }
-                    }
-                }
+                config.openapi_parameters["requestBody"] = self.generate_request_body(config)
                 continue
             # Fallthrough - the parameter has a name, a format and a request part
             # Process type-info first and determine if the field even exists.
             openapi_schema_info = {
                 "type": "string",
-                "format": param_specifier.format.name.lower(),
+                "format": param_specifier.format.value,
             }
             if param_specifier.request_part != ZSERIO_REQUEST_PART_WHOLE:
                 _, member_info = find_field(req_t_info, param_specifier.request_part)
@@ -442,6 +490,18 @@ class OpenApiSchemaGenerator:
                 config.openapi_parameters["security"] = [{config.security: []}]
         # Set the finalized parameter list
         config.openapi_parameters["parameters"] = openapi_param_list
+        # Let clients retry POST operations which have no side effects
+        if config.idempotent:
+            config.openapi_parameters[ZSWAG_IDEMPOTENT] = True
+        # Let clients remember responses of methods which are pure functions
+        if config.cache_ttl is not None:
+            config.openapi_parameters[ZSWAG_CACHE] = config.cache_ttl
+        # Reference the body fallback operation, which is only needed if there are URL parameters
+        if config.body_fallback:
+            if "requestBody" in config.openapi_parameters or not openapi_param_list:
+                print(f"[WARNING] {config.name} does not pass URL parameters, ignoring `{BODY_FALLBACK_TAG}`.")
+            else:
+                config.openapi_parameters[ZSWAG_BODY_FALLBACK] = config.name + BODY_FALLBACK_OPERATION_SUFFIX
 
 
 if __name__ == "__main__":
@@ -512,12 +572,22 @@ if __name__ == "__main__":
                          path=(method-path) : Set a particular method path.
                                               May contain placeholders for
                                               path params.
+                              body-fallback : Add a POST operation which
+                                              accepts the request as body.
+                                              Clients use it if the URL
+                                              would get too long.
+                                 idempotent : Allow clients to retry failed
+                                              requests, also for POST.
+                           cache[=(ttl-ms)] : Let clients remember responses
+                                              by request, for methods which
+                                              are pure functions. The TTL
+                                              defaults to 60000ms.
                                                    
                         A (param-specifier) tag has the following schema:
                         
                             (field?name=...
                                   &in=[path|body|query|header]
-                                  &format=[binary|base64|hex]
+                                  &format=[binary|base64|hex|x-zstd-base64url]
                                   [&style=...]
                                   [&explode=...])
                         
@@ -3,6 +3,7 @@ import base64
 import zserio
 import struct
 import functools
+import zstandard
 from enum import Enum
 from typing import Type, Tuple, Any, Dict, Union, Optional, List, get_type_hints, Iterator
 from pyzswagcl import OAMethod, OAParam, OAParamFormat, ZSERIO_REQUEST_PART_WHOLE
@@ -168,6 +169,8 @@ def str_to_bytes(s: str, fmt: OAParamFormat) -> bytes:
         return base64.b64decode(s)
     elif fmt == OAParamFormat.BASE64URL:
         return base64.urlsafe_b64decode(s)
+    elif fmt == OAParamFormat.ZSTD_BASE64URL:
+        return zstandard.ZstdDecompressor().decompress(base64.urlsafe_b64decode(s))
     elif fmt == OAParamFormat.HEX:
         return bytes.fromhex(s)
     else:  # if fmt in (OAParamFormat.BINARY, OAParamFormat.STRING):
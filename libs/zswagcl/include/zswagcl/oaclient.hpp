@@ -3,6 +3,7 @@
 #include <zserio/IService.h>
 
 #include "private/openapi-client.hpp"
+#include "private/openapi-registry.hpp"
 #include "httpcl/http-client.hpp"
 
 namespace zswagcl
@@ -16,11 +17,46 @@ public:
         std::unique_ptr<httpcl::IHttpClient> client,
         httpcl::Config httpConfig = {});
 
+    /**
+     * Create a client which shares its config and transport with
+     * other clients, e.g. as handed out by the OpenAPIRegistry.
+     */
+    OAClient(
+        std::shared_ptr<const zswagcl::OpenAPIConfig> config,
+        std::shared_ptr<httpcl::IHttpClient> client,
+        httpcl::Config httpConfig = {},
+        std::shared_ptr<const httpcl::Settings> settings = {});
+
+    using MethodHandle = OpenAPIClient::MethodHandle;
+
+    /**
+     * Call a method by its name. The context must be null,
+     * or point to a zswagcl::CallContext.
+     */
     std::vector<uint8_t> callMethod(
         zserio::StringView methodName,
         zserio::IServiceData const& requestData,
         void* context) override;
 
+    /**
+     * Look up a method once, e.g. to cache the handle for repeated calls.
+     * Returns an empty handle if the method is not part of the spec.
+     */
+    MethodHandle resolveMethod(zserio::StringView methodName) const;
+
+    /**
+     * Call a method through a handle from resolveMethod().
+     */
+    std::vector<uint8_t> callMethod(
+        MethodHandle method,
+        zserio::IServiceData const& requestData,
+        void* context);
+
+    /**
+     * Prepare the first calls in advance, see OpenAPIClient::warmup().
+     */
+    OpenAPIClient::WarmupReport warmup(std::size_t connections = 1);
+
 private:
     OpenAPIClient client_;
 };
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "httpcl/http-settings.hpp"
+
+namespace zswagcl
+{
+
+/**
+ * Spreads the requests of a client over the servers of its spec,
+ * according to a httpcl::LoadBalancingPolicy. Servers which keep
+ * failing are ejected for a while.
+ */
+class ServerBalancer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Weight of the latest latency in the moving average of a server.
+     */
+    static constexpr double EWMA_WEIGHT = 0.3;
+
+    enum class Outcome {
+        Success,
+        /** No response, or a 5xx status. */
+        Failure,
+        /** Cancelled or aborted by the deadline. */
+        Ignored
+    };
+
+    struct Stats
+    {
+        std::size_t outstanding = 0;
+
+        /**
+         * Moving average latency, if any request completed.
+         */
+        std::optional<std::chrono::microseconds> latency;
+
+        unsigned consecutiveFailures = 0;
+        bool ejected = false;
+    };
+
+    explicit ServerBalancer(std::size_t servers, std::uint32_t seed = std::random_device{}());
+
+    /**
+     * Pick a server for a request, which counts as outstanding until
+     * release(). Servers which were already tried for the request are
+     * skipped, and so are ejected servers, unless all remaining servers
+     * are ejected. Returns nothing if all servers were tried.
+     */
+    std::optional<std::size_t> pick(httpcl::LoadBalancingPolicy const& policy,
+                                    std::vector<bool> const& tried,
+                                    Clock::time_point now = Clock::now());
+
+    /**
+     * Record the outcome of a request to a server.
+     * Returns true if the server was ejected.
+     */
+    bool release(httpcl::LoadBalancingPolicy const& policy,
+                 std::size_t server,
+                 Outcome outcome,
+                 Clock::duration latency,
+                 Clock::time_point now = Clock::now());
+
+    std::vector<Stats> stats(Clock::time_point now = Clock::now()) const;
+
+private:
+    struct Server
+    {
+        std::size_t outstanding = 0;
+        std::optional<double> latency;
+        unsigned consecutiveFailures = 0;
+        Clock::time_point ejectedUntil;
+    };
+
+    mutable std::mutex mutex_;
+    std::vector<Server> servers_;
+    std::size_t next_ = 0;
+    std::mt19937 random_;
+};
+
+}
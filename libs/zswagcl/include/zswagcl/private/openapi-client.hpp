@@ -1,7 +1,16 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
 #include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 
+#include "openapi-balancer.hpp"
 #include "openapi-parser.hpp"
 #include "openapi-config.hpp"
 #include "openapi-parameter-helper.hpp"
@@ -12,35 +21,279 @@
 namespace zswagcl
 {
 
+class RetryBudget;
+class LatencyTracker;
+class SingleFlight;
+class Memo;
+
+/**
+ * Per-call options, passed as `context` to OAClient::callMethod().
+ */
+struct CallContext
+{
+    /**
+     * Point in time by which the call must be completed.
+     */
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+
+    /**
+     * Token to cancel the call from another thread.
+     */
+    std::shared_ptr<httpcl::CancellationToken> cancellation;
+
+    /**
+     * Timeouts for this call, which take precedence over
+     * the HTTP settings and the spec's operation defaults.
+     */
+    httpcl::Timeouts timeouts;
+
+    /**
+     * Headers which replace headers of the same name for this call.
+     */
+    httpcl::Headers headers;
+};
+
 class OpenAPIClient
 {
 public:
-    OpenAPIConfig config_;
+    std::shared_ptr<const OpenAPIConfig> config_;
     httpcl::Config httpConfig_;
 
+    /**
+     * Maximum length of a resolved URL (including query parameters).
+     * If a method's URL would be longer, and the method has a
+     * `bodyFallback` operation, the fallback is called instead.
+     * Initialized from the HTTP_MAX_URL_LENGTH environment variable.
+     */
+    std::size_t maxUrlLength_ = 8192;
+
+    /**
+     * Maximum total size of the responses which are remembered for
+     * operations with an `x-zswag-cache` TTL. Initialized from the
+     * HTTP_MEMO_MAX_BYTES environment variable.
+     */
+    std::size_t memoMaxBytes_ = 16 << 20;
+
     OpenAPIClient(OpenAPIConfig config,
                   httpcl::Config httpConfig,
                   std::unique_ptr<httpcl::IHttpClient> client);
+
+    /**
+     * Create a client which shares its (immutable) config, transport
+     * and settings with other clients, e.g. as handed out by the
+     * OpenAPIRegistry. The httpConfig is applied on top of the settings
+     * for each request of this client only. If no settings are given,
+     * they are loaded from HTTP_SETTINGS_FILE.
+     */
+    OpenAPIClient(std::shared_ptr<const OpenAPIConfig> config,
+                  httpcl::Config httpConfig,
+                  std::shared_ptr<httpcl::IHttpClient> client,
+                  std::shared_ptr<const httpcl::Settings> settings = {});
     ~OpenAPIClient();
 
+    /**
+     * Handle of a method in the method table of this client,
+     * see resolveMethod(). Valid for the lifetime of the client.
+     */
+    struct MethodHandle
+    {
+        std::size_t index = std::numeric_limits<std::size_t>::max();
+
+        explicit operator bool() const {
+            return index != std::numeric_limits<std::size_t>::max();
+        }
+    };
+
+    using ParameterResolver = std::function<ParameterValue(const std::string&, /* parameter identifier */
+                                                           const std::string&, /* zserio request part path */
+                                                           ParameterValueHelper&)>;
+
+    /**
+     * Look up an OpenAPI method by its operation id, without allocating.
+     * Returns an empty handle if the method is not part of the spec.
+     */
+    MethodHandle resolveMethod(std::string_view method) const;
+
     /**
      * Call OpenAPI method.
      *
      * The callback `fun` is called for each URL and request parameter of the
      * method.
      *
-     * @param method  OpenAPI method identifier.
-     * @param fun     Parameter resolve function.
+     * Failed requests of idempotent methods are retried if the HTTP
+     * config has a retry policy, see httpcl::RetryPolicy.
+     *
+     * If the spec has several servers, requests are balanced over them,
+     * see httpcl::LoadBalancingPolicy. Requests of idempotent methods
+     * which get no response or a 5xx status are sent to the next server.
+     *
+     * Throws httpcl::IHttpClient::Error with status 0 if the call was
+     * cancelled or exceeded its deadline.
+     *
+     * @param method   OpenAPI method identifier.
+     * @param fun      Parameter resolve function.
+     * @param context  Optional per-call deadline, cancellation, timeouts and headers.
      * @return Response buffer.
      */
-    std::string call(const std::string& method,
-                     const std::function<ParameterValue(const std::string&, /* parameter identifier */
-                                                        const std::string&, /* zserio request part path */
-                                                        ParameterValueHelper&)>& fun);
+    std::string call(std::string_view method,
+                     const ParameterResolver& fun,
+                     const CallContext* context = nullptr);
+
+    /**
+     * Call OpenAPI method through a handle from resolveMethod().
+     */
+    std::string call(MethodHandle method,
+                     const ParameterResolver& fun,
+                     const CallContext* context = nullptr);
+
+    /**
+     * Counters of this client, e.g. for monitoring.
+     */
+    struct Metrics
+    {
+        /**
+         * Number of hedged requests which were sent, see httpcl::HedgingPolicy.
+         */
+        std::uint64_t hedgesIssued = 0;
+
+        /**
+         * Number of hedged requests which were faster than the original request.
+         */
+        std::uint64_t hedgesWon = 0;
+
+        /**
+         * Number of calls which used the response of an identical
+         * concurrent call, see httpcl::Config::coalesce.
+         */
+        std::uint64_t coalesced = 0;
+
+        /**
+         * Number of calls which currently wait for the response
+         * of an identical concurrent call.
+         */
+        std::size_t coalescing = 0;
+
+        /**
+         * Number of calls which were answered with a remembered
+         * response, see OpenAPIConfig::Path::cacheTtl.
+         */
+        std::uint64_t memoized = 0;
+
+        /**
+         * Circuit breaker state per origin of the transport,
+         * see httpcl::CircuitBreakerPolicy.
+         */
+        std::map<std::string, httpcl::CircuitBreaker::State> circuits;
+
+        /**
+         * Concurrency limit and load per origin of the transport,
+         * see httpcl::ConcurrencyLimitPolicy.
+         */
+        std::map<std::string, httpcl::ConcurrencyLimiter::Stats> concurrency;
+
+        /**
+         * Statistics of the transport's response cache,
+         * see httpcl::Config::responseCache.
+         */
+        std::optional<httpcl::ResponseCache::Stats> cache;
+
+        /**
+         * Load and health per server URL, if the
+         * spec has several servers.
+         */
+        std::map<std::string, ServerBalancer::Stats> servers;
+    };
+
+    Metrics metrics() const;
+
+    /**
+     * Durations of the steps of warmup().
+     */
+    struct WarmupReport
+    {
+        /**
+         * Resolving the server host, see httpcl::DnsCache.
+         */
+        std::chrono::microseconds resolve{0};
+
+        /**
+         * Loading the HTTP settings, including keychain secrets.
+         */
+        std::chrono::microseconds settings{0};
+
+        /**
+         * Looking up the paths of all operations, which
+         * parses lazily parsed operations.
+         */
+        std::chrono::microseconds plans{0};
+
+        /**
+         * Opening the connections, including TLS handshakes.
+         */
+        std::chrono::microseconds connect{0};
+
+        /**
+         * The whole warmup. Some steps run in parallel,
+         * so this is less than their sum.
+         */
+        std::chrono::microseconds total{0};
+
+        /**
+         * Number of operations whose paths were looked up.
+         */
+        std::size_t methods = 0;
+
+        /**
+         * Number of connections which were opened.
+         */
+        std::size_t connections = 0;
+    };
+
+    /**
+     * Do the work of the first calls in advance, e.g. right after
+     * startup: Resolve the server host, load the HTTP settings and
+     * keychain secrets, look up all operations and open the given
+     * number of connections to the server. Throws if the HTTP
+     * settings cannot be applied, like the first call would.
+     */
+    WarmupReport warmup(std::size_t connections = 1);
 
 private:
-    std::unique_ptr<httpcl::IHttpClient> client_;
-    httpcl::Settings settings_;
+    struct MethodTable;
+    struct Counters;
+
+    /**
+     * Send a request, and send a second one if the first takes longer than
+     * the latency percentile of the hedging policy. Returns the first result.
+     */
+    httpcl::IHttpClient::Result hedge(
+        LatencyTracker& latency,
+        const httpcl::Config& httpConfig,
+        const std::string& debugContext,
+        const std::function<httpcl::IHttpClient::Result(const httpcl::Config&)>& perform);
+
+    /**
+     * Retry a failed request according to the retry policy of the
+     * HTTP config, if the method is idempotent. Returns the last result.
+     */
+    httpcl::IHttpClient::Result retry(
+        const OpenAPIConfig::Path& method,
+        const httpcl::Config& httpConfig,
+        const std::string& debugContext,
+        httpcl::IHttpClient::Result result,
+        const std::function<httpcl::IHttpClient::Result()>& sendRequest);
+
+    std::shared_ptr<httpcl::IHttpClient> client_;
+    std::shared_ptr<const MethodTable> methods_;
+    std::unique_ptr<LatencyTracker[]> latencies_;
+    std::unique_ptr<RetryBudget> retryBudget_;
+    std::unique_ptr<RetryBudget> hedgeBudget_;
+    std::unique_ptr<Counters> counters_;
+    std::unique_ptr<httpcl::RateLimiters> rateLimiters_;
+    std::unique_ptr<SingleFlight> singleFlight_;
+    std::unique_ptr<Memo> memo_;
+    std::unique_ptr<ServerBalancer> balancer_;
+    std::shared_ptr<const httpcl::Settings> settings_;
 };
 
 }
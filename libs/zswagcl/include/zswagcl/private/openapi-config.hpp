@@ -1,10 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
 #include <variant>
 #include <optional>
+#include <memory>
 
 #include "zswagcl/export.hpp"
 #include "httpcl/uri.hpp"
@@ -104,6 +106,12 @@ struct OpenAPIConfig
             Base64,    // Standard
             Base64url, // URL safe
 
+            /**
+             * Zstandard compression, followed by URL safe Base64 encoding.
+             * Keeps large blobs in URLs short.
+             */
+            ZstdBase64url,
+
             /**
              * Binary (octet) encoding
              */
@@ -178,18 +186,88 @@ struct OpenAPIConfig
          * Optional security schemes override for the global default.
          */
         std::optional<SecurityAlternatives> security;
+
+        /**
+         * Optional identifier of an alternative operation, which accepts the
+         * whole request object as body. It is called instead of this operation
+         * if the resolved URL would exceed the client's maximum URL length.
+         * Read from the `x-zswag-body-fallback` extension.
+         */
+        std::optional<std::string> bodyFallback;
+
+        /**
+         * Default timeouts of this operation, read from the
+         * `x-zswag-timeouts` extension. Timeouts from the HTTP settings
+         * or the call context take precedence.
+         */
+        httpcl::Timeouts timeouts;
+
+        /**
+         * Whether failed requests of this operation may be retried,
+         * read from the `x-zswag-idempotent` extension. If not set,
+         * GET, PUT and DELETE operations are idempotent.
+         */
+        std::optional<bool> idempotent;
+
+        /**
+         * Time for which clients remember the response to a request,
+         * read from the `x-zswag-cache` extension. Only for operations
+         * which are pure functions of their request.
+         */
+        std::optional<std::chrono::milliseconds> cacheTtl;
+
+        /**
+         * Whether the operation is idempotent, either as declared
+         * in the spec or according to its HTTP method.
+         */
+        bool isIdempotent() const;
     };
 
     /**
-     * URI parts.
+     * URI parts of the (first) server.
      */
     httpcl::URIComponents uri;
 
+    /**
+     * All servers of the spec, in order. If there are several,
+     * OpenAPIClient balances its calls over them, and ignores `uri`.
+     */
+    std::vector<httpcl::URIComponents> servers;
+
     /**
      * Map from service method name to path configuration.
+     * Empty if the operations are parsed lazily, use findPath() to
+     * look up operations.
      */
     std::map<std::string, Path> methodPath;
 
+    /**
+     * Index of operations which are only parsed on first use,
+     * see OpenAPIParseOptions::lazyOperations.
+     */
+    struct LazyPaths {
+        virtual ~LazyPaths() = default;
+        virtual std::vector<std::string> operationIds() const = 0;
+        virtual Path const* find(std::string const& methodIdent) const = 0;
+    };
+
+    /**
+     * Lazily parsed operations, shared between copies of this config.
+     */
+    std::shared_ptr<const LazyPaths> lazyPaths;
+
+    /**
+     * Get the path configuration for a service method, parsing it
+     * first if needed. Returns nullptr for unknown methods.
+     * Thread-safe. Throws if a lazily parsed operation is invalid.
+     */
+    Path const* findPath(std::string const& methodIdent) const;
+
+    /**
+     * Get the identifiers of all operations, without parsing them.
+     */
+    std::vector<std::string> operationIds() const;
+
     /**
      * Available security schemes.
      */
@@ -203,12 +281,25 @@ struct OpenAPIConfig
 
     /**
      * Original OpenAPI YAML string from which this config was parsed.
+     * Null if the config was parsed without retaining the content.
+     * Shared between copies of this config, and with the lazily
+     * parsed operations of a JSON spec.
+     */
+    std::shared_ptr<const std::string> content;
+
+    /**
+     * Hash of the original OpenAPI YAML string, see openAPIContentHash().
+     * Used to validate binary config snapshots against their source.
      */
-    std::string content;
+    std::uint64_t contentHash = 0;
 };
 
 ZSWAGCL_EXPORT extern const std::string ZSERIO_OBJECT_CONTENT_TYPE;
 ZSWAGCL_EXPORT extern const std::string ZSERIO_REQUEST_PART;
 ZSWAGCL_EXPORT extern const std::string ZSERIO_REQUEST_PART_WHOLE;
+ZSWAGCL_EXPORT extern const std::string ZSWAG_BODY_FALLBACK;
+ZSWAGCL_EXPORT extern const std::string ZSWAG_TIMEOUTS;
+ZSWAGCL_EXPORT extern const std::string ZSWAG_IDEMPOTENT;
+ZSWAGCL_EXPORT extern const std::string ZSWAG_CACHE;
 
 }
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+namespace zswagcl
+{
+
+/**
+ * Latencies of the most recent requests of an operation, from
+ * which the hedging threshold is derived.
+ */
+class LatencyTracker
+{
+public:
+    /**
+     * Number of recent latencies which are kept.
+     */
+    static constexpr std::size_t WINDOW = 256;
+
+    /**
+     * Number of latencies which are needed for a percentile.
+     */
+    static constexpr std::size_t MIN_SAMPLES = 20;
+
+    void record(std::chrono::microseconds latency);
+
+    /**
+     * Get the given percentile (0-100) of the recent latencies.
+     * Returns nothing if there are fewer than MIN_SAMPLES.
+     */
+    std::optional<std::chrono::microseconds> percentile(double percent) const;
+
+private:
+    mutable std::mutex mutex_;
+    std::array<std::chrono::microseconds::rep, WINDOW> samples_{};
+    std::size_t count_ = 0;
+    std::size_t next_ = 0;
+};
+
+}
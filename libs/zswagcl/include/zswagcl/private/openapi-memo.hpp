@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace zswagcl
+{
+
+/**
+ * Responses of operations with an `x-zswag-cache` TTL, keyed by operation
+ * and the serialized request. Entries expire after their TTL,
+ * and the least recently used entries are evicted once the total size
+ * of the responses exceeds the byte limit.
+ */
+class Memo
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * The request hash only selects the bucket. Hits are
+     * decided by the SHA-256 digest of the request.
+     */
+    struct Key
+    {
+        std::string operationId;
+        std::uint64_t requestHash = 0;
+        std::string requestDigest;
+
+        bool operator== (Key const& other) const {
+            return requestHash == other.requestHash && operationId == other.operationId &&
+                requestDigest == other.requestDigest;
+        }
+    };
+
+    explicit Memo(std::size_t maxBytes);
+
+    /**
+     * Get the response for the key, unless it is missing or expired.
+     */
+    std::shared_ptr<const std::string> get(Key const& key, Clock::time_point now = Clock::now());
+
+    /**
+     * Remember a response for the given time. Responses which are,
+     * with their key, larger than the byte limit are not stored.
+     */
+    void put(Key key, std::string response, Clock::duration ttl, Clock::time_point now = Clock::now());
+
+    std::size_t bytes() const;
+
+private:
+    struct KeyHash
+    {
+        std::size_t operator() (Key const& key) const {
+            return std::hash<std::string>()(key.operationId) ^ static_cast<std::size_t>(key.requestHash);
+        }
+    };
+
+    struct Entry
+    {
+        Key key;
+        std::shared_ptr<const std::string> response;
+        Clock::time_point expires;
+        std::size_t bytes = 0;
+    };
+
+    void evict(std::list<Entry>::iterator it);
+
+    const std::size_t maxBytes_;
+
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+    std::size_t bytes_ = 0;
+};
+
+}
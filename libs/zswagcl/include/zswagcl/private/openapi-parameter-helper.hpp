@@ -8,9 +8,11 @@
 #include <variant>
 #include <sstream>
 #include <array>
+#include <charconv>
 
 #include "stx/string.h"
 #include "zserio/Span.h"
+#include "zserio/BitBuffer.h"
 
 namespace zswagcl
 {
@@ -43,31 +45,48 @@ std::string formatBuffer(Format f, const std::uint8_t* ptr, std::size_t size);
 template <class _Type, class _Enable = void>
 struct FormatHelper;
 
+/**
+ * Append a formatted value to a string. Integers in String and Hex
+ * format are written in place, other values are formatted first.
+ */
+template <class _Type>
+void formatTo(std::string& out, Format f, _Type v)
+{
+    if constexpr (std::is_integral_v<_Type> && !std::is_same_v<_Type, bool>) {
+        if (f == Format::String || f == Format::Hex) {
+            /* Sign + 20 decimal digits fit any 64 bit value. */
+            auto const pos = out.size();
+            out.resize(pos + 24);
+            auto result = std::to_chars(out.data() + pos, out.data() + out.size(), v, f == Format::Hex ? 16 : 10);
+            out.resize(static_cast<std::size_t>(result.ptr - out.data()));
+            return;
+        }
+    }
+    out += FormatHelper<_Type>::format(f, v);
+}
+
 template <class _Type>
 struct FormatHelper<_Type, std::enable_if_t<std::is_integral_v<_Type>>>
 {
     static std::string format(Format f, _Type v)
     {
-        switch (f) {
-        case Format::Hex: {
-            std::array<char, 30> buffer;
-            if constexpr (std::is_unsigned_v<_Type>)
-                std::snprintf(buffer.data(), buffer.size(), "%llx",
-                              (unsigned long long)v);
-            else
-                std::snprintf(buffer.data(), buffer.size(), "%s%llx",
-                              v < _Type(0) ? "-" : "",
-                              (unsigned long long)std::llabs(v));
-            return {buffer.data()};
-        }
-
-        case Format::String:
-            return stx::to_string(v);
-
-        default: {
-            auto be = htobe(v);
-            return formatBuffer(f, reinterpret_cast<const std::uint8_t*>(&be), sizeof(be));
+        if constexpr (std::is_same_v<_Type, bool>) {
+            return FormatHelper<std::uint8_t>::format(f, static_cast<std::uint8_t>(v));
         }
+        else {
+            switch (f) {
+            case Format::Hex:
+            case Format::String: {
+                std::string result;
+                formatTo(result, f, v);
+                return result;
+            }
+
+            default: {
+                auto be = htobe(v);
+                return formatBuffer(f, reinterpret_cast<const std::uint8_t*>(&be), sizeof(be));
+            }
+            }
         }
     }
 };
@@ -81,6 +100,15 @@ struct FormatHelper<std::vector<std::uint8_t>>
     }
 };
 
+template <>
+struct FormatHelper<zserio::BitBuffer>
+{
+    static std::string format(Format f, const zserio::BitBuffer& v)
+    {
+        return formatBuffer(f, v.getBuffer(), v.getByteSize());
+    }
+};
+
 template <class _Type>
 struct FormatHelper<_Type, std::enable_if_t<std::is_same_v<_Type, std::string> ||
                                             std::is_same_v<_Type, const char*>>>
@@ -115,6 +143,17 @@ struct FormatHelper<_Type, std::enable_if_t<std::is_floating_point_v<_Type>>>
     }
 };
 
+/**
+ * Array elements which were formatted back to back into one string.
+ */
+struct FormattedArray
+{
+    std::string values;
+
+    /** End offset of each element in values. */
+    std::vector<std::size_t> ends;
+};
+
 template <>
 struct FormatHelper<Any>
 {
@@ -139,7 +178,8 @@ struct ParameterValue
 {
     using ValueHolder = std::variant<std::string,
                                      std::vector<std::string>,
-                                     std::map<std::string, std::string>>;
+                                     std::map<std::string, std::string>,
+                                     impl::FormattedArray>;
 
     ValueHolder value;
 
@@ -206,6 +246,26 @@ public:
         return ParameterValue(std::move(tmp));
     }
 
+    /**
+     * Like array(), but converts each element to _Value before
+     * formatting it. Used to format raw zserio arrays (e.g. int32)
+     * exactly like their widened single values (e.g. int64).
+     * The elements are appended to one string, instead of
+     * allocating a string per element.
+     */
+    template <class _Value, class _Container>
+    ParameterValue array(const _Container& v)
+    {
+        impl::FormattedArray tmp;
+        tmp.ends.reserve(std::size(v));
+        for (const auto& item : v) {
+            impl::formatTo(tmp.values, param.format, static_cast<_Value>(item));
+            tmp.ends.push_back(tmp.values.size());
+        }
+
+        return ParameterValue(std::move(tmp));
+    }
+
     template <class _Container>
     ParameterValue object(const _Container& v)
     {
@@ -227,6 +287,11 @@ public:
         return ParameterValue(format(v));
     }
 
+    ParameterValue binary(const zserio::BitBuffer& v)
+    {
+        return ParameterValue(format(v));
+    }
+
     ParameterValue binary(const zserio::Span<const uint8_t>& v)
     {
         std::vector<uint8_t> buf{v.begin(), v.end()};
@@ -9,6 +9,21 @@
 namespace zswagcl
 {
 
+struct OpenAPIParseOptions
+{
+    /**
+     * Keep the spec text in OpenAPIConfig::content.
+     */
+    bool retainContent = true;
+
+    /**
+     * Only index the operations while parsing. Each operation is parsed
+     * on first use through OpenAPIConfig::findPath(). Only applies to
+     * JSON specs: YAML specs are always parsed completely.
+     */
+    bool lazyOperations = false;
+};
+
 /**
  * Download and parse OpenAPI config from URL.
  *
@@ -16,13 +31,14 @@ namespace zswagcl
  */
 OpenAPIConfig fetchOpenAPIConfig(const std::string& url,
                                  httpcl::IHttpClient& client,
-                                 httpcl::Config httpConfig = {});
+                                 httpcl::Config httpConfig = {},
+                                 OpenAPIParseOptions const& options = {});
 
 /**
  * Parse OpenAPI config from input-stream.
  *
  * Throws on error.
  */
-OpenAPIConfig parseOpenAPIConfig(std::istream&);
+OpenAPIConfig parseOpenAPIConfig(std::istream&, OpenAPIParseOptions const& options = {});
 
 }
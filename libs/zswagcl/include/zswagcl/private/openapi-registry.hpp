@@ -0,0 +1,100 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+#include "openapi-config.hpp"
+#include "openapi-parser.hpp"
+
+#include "httpcl/http-client.hpp"
+#include "httpcl/http-settings.hpp"
+
+namespace zswagcl
+{
+
+/**
+ * Hands out immutable OpenAPI configs which are shared by many clients,
+ * together with a shared pooled transport and HTTP settings.
+ *
+ * Each spec URL (or local path) is fetched and parsed once. Concurrent
+ * requests for the same URL wait for the same fetch. Specs under different
+ * URLs with the same content and resolved server URI share one instance.
+ * Configs stay registered until clear() is called.
+ */
+class OpenAPIRegistry
+{
+public:
+    using ConfigPtr = std::shared_ptr<const OpenAPIConfig>;
+
+    /**
+     * Create a registry. If no transport or settings are given, an
+     * HttpLibHttpClient and settings from HTTP_SETTINGS_FILE are used.
+     */
+    explicit OpenAPIRegistry(std::shared_ptr<httpcl::IHttpClient> client = {},
+                             std::shared_ptr<const httpcl::Settings> settings = {});
+
+    /**
+     * Process-wide registry instance.
+     */
+    static OpenAPIRegistry& instance();
+
+    /**
+     * Get the config for the spec at the given URL. The httpConfig
+     * is only used if the spec is not registered yet.
+     *
+     * Throws on error. Failed fetches are not registered.
+     */
+    ConfigPtr fetch(std::string const& url,
+                    httpcl::Config const& httpConfig = {},
+                    OpenAPIParseOptions const& options = {});
+
+    /**
+     * Get the config for the spec in the given local file.
+     *
+     * Throws on error. Failed parses are not registered.
+     */
+    ConfigPtr load(std::string const& path,
+                   OpenAPIParseOptions const& options = {});
+
+    /**
+     * Register an already parsed config. Returns the registered instance
+     * with the same content and server URI, if there is one.
+     */
+    ConfigPtr add(OpenAPIConfig config);
+
+    /**
+     * Transport which is shared by all clients of this registry.
+     */
+    std::shared_ptr<httpcl::IHttpClient> httpClient() const;
+
+    /**
+     * HTTP settings which are shared by all clients of this registry.
+     */
+    std::shared_ptr<const httpcl::Settings> settings() const;
+
+    /**
+     * Forget all registered configs. Configs which are still in
+     * use by clients stay valid.
+     */
+    void clear();
+
+private:
+    using SourceKey = std::tuple<std::string, bool, bool>;
+    using ContentKey = std::tuple<uint64_t, std::string, bool, bool>;
+
+    ConfigPtr getOrCreate(SourceKey key, std::function<OpenAPIConfig()> const& create);
+    ConfigPtr deduplicate(OpenAPIConfig config);
+
+    std::shared_ptr<httpcl::IHttpClient> client_;
+    std::shared_ptr<const httpcl::Settings> settings_;
+
+    std::mutex mutex_;
+    std::map<SourceKey, std::shared_future<ConfigPtr>> bySource_;
+    std::map<ContentKey, ConfigPtr> byContent_;
+};
+
+}
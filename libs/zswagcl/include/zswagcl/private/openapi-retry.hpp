@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include "httpcl/http-settings.hpp"
+
+namespace zswagcl
+{
+
+/**
+ * Limits the retries of a client to a fraction of its requests, so that
+ * retries cannot multiply the load on a failing server. Each request
+ * deposits RetryPolicy::budget tokens, and each retry withdraws one.
+ * Hedged requests are limited by a separate budget of the same kind.
+ * The balance is capped, and starts with the cap, so that a few
+ * retries are possible before there is any traffic.
+ */
+class RetryBudget
+{
+public:
+    static constexpr std::int64_t MAX_BALANCE = 10;
+
+    void deposit(double tokens);
+
+    /**
+     * Take one token for a retry. Returns false if the budget is exhausted.
+     */
+    bool withdraw();
+
+    double balance() const;
+
+private:
+    // The balance is counted in thousandths of a token, so that
+    // small deposits add up exactly.
+    static constexpr std::int64_t MILLI = 1000;
+
+    mutable std::mutex mutex_;
+    std::int64_t balance_ = MAX_BALANCE * MILLI;
+};
+
+/**
+ * Whether a response status indicates a transient failure: No
+ * response at all (e.g. connection reset), or 502, 503 and 504.
+ */
+bool isRetryableStatus(int status);
+
+/**
+ * Randomized ("full jitter") backoff before the given retry (starting at 1),
+ * between zero and initialBackoff * 2^(retry-1), capped at maxBackoff.
+ */
+std::chrono::milliseconds retryBackoff(httpcl::RetryPolicy const& policy, unsigned retry);
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "httpcl/http-client.hpp"
+
+namespace zswagcl
+{
+
+/**
+ * Coalesces identical concurrent requests: While a request with
+ * a given key is in flight, further requests with the same key
+ * wait for its response instead of being sent.
+ */
+class SingleFlight
+{
+public:
+    using Result = httpcl::IHttpClient::Result;
+
+    /**
+     * Run send, unless a request with the same key is in flight. Then,
+     * wait for its result (or exception) instead, until the deadline or
+     * cancellation of the config. If the shared request was aborted by its
+     * own caller's cancellation or deadline, send is run after all.
+     *
+     * Sets shared to whether the result of another request was used.
+     */
+    std::shared_ptr<const Result> run(std::string const& key,
+                                      std::function<Result()> const& send,
+                                      httpcl::Config const& config,
+                                      bool& shared);
+
+    /**
+     * Number of distinct requests which are in flight.
+     */
+    std::size_t inFlight() const;
+
+    /**
+     * Number of requests which wait for the response of another request.
+     */
+    std::size_t waiting() const;
+
+private:
+    struct Flight;
+
+    mutable std::mutex mutex_;
+    std::size_t waiting_ = 0;
+    std::map<std::string, std::shared_ptr<Flight>> flights_;
+};
+
+}
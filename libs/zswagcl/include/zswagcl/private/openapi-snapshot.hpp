@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "zswagcl/private/openapi-config.hpp"
+
+namespace zswagcl
+{
+
+/**
+ * Version of the binary OpenAPI config snapshot format.
+ * Snapshots with a different version are rejected.
+ */
+ZSWAGCL_EXPORT extern const std::uint32_t OPENAPI_SNAPSHOT_VERSION;
+
+/**
+ * Hash (64 bit FNV-1a) of an OpenAPI YAML source text, as stored in
+ * OpenAPIConfig::contentHash and in snapshot headers.
+ */
+std::uint64_t openAPIContentHash(std::string_view content);
+
+/**
+ * Write a binary snapshot of a parsed OpenAPI config. The snapshot
+ * contains the server URI, methods, parameters and security schemes,
+ * and the original YAML content if the config still retains it.
+ * All operations of a lazily parsed config are parsed for this.
+ *
+ * Throws on error.
+ */
+void writeOpenAPIConfigSnapshot(const OpenAPIConfig& config, std::ostream& out);
+
+/**
+ * Read an OpenAPI config from a binary snapshot buffer.
+ *
+ * If expectedContentHash is given, the snapshot is rejected unless it was
+ * written for a spec with that content hash. If retainContent is false,
+ * the stored YAML content is skipped.
+ *
+ * Throws on error, e.g. a version or content hash mismatch.
+ */
+OpenAPIConfig readOpenAPIConfigSnapshot(std::string_view snapshot,
+                                        std::optional<std::uint64_t> expectedContentHash = {},
+                                        bool retainContent = true);
+
+/**
+ * Read a snapshot file and the OpenAPI config from it. The file is
+ * read into one buffer, which is kept as the retained content.
+ * See readOpenAPIConfigSnapshot() for the arguments.
+ *
+ * Throws on error.
+ */
+OpenAPIConfig loadOpenAPIConfigSnapshot(const std::string& path,
+                                        std::optional<std::uint64_t> expectedContentHash = {},
+                                        bool retainContent = true);
+
+}
@@ -1,6 +1,9 @@
 #include "oaclient.hpp"
 
 #include <cassert>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
 #include "stx/format.h"
 #include "zserio/ITypeInfo.h"
 
@@ -13,101 +16,207 @@ OAClient::OAClient(zswagcl::OpenAPIConfig config,
     : client_(std::move(config), std::move(httpConfig), std::move(client))
 {}
 
-template<typename arr_elem_t>
-ParameterValue reflectableArrayToParameterValue(std::function<void(std::vector<arr_elem_t>&, size_t)> appendFun, size_t length, ParameterValueHelper& helper) {
-    std::vector<arr_elem_t> values;
+OAClient::OAClient(std::shared_ptr<const zswagcl::OpenAPIConfig> config,
+                   std::shared_ptr<httpcl::IHttpClient> client,
+                   httpcl::Config httpConfig,
+                   std::shared_ptr<const httpcl::Settings> settings)
+    : client_(std::move(config), std::move(httpConfig), std::move(client), std::move(settings))
+{}
+
+namespace
+{
+
+/**
+ * Read the raw std::vector<elem_t> which backs an array reflectable,
+ * if the reflectable exposes it through getAnyValue(). This allows
+ * formatting all array values in one go, instead of allocating
+ * a reflectable for every single array element.
+ */
+template<typename elem_t>
+std::vector<elem_t> const* rawArray(zserio::AnyHolder<> const& any)
+{
+    using ConstRef = std::reference_wrapper<const std::vector<elem_t>>;
+    using Ref = std::reference_wrapper<std::vector<elem_t>>;
+    if (any.isType<ConstRef>())
+        return &any.get<ConstRef>().get();
+    if (any.isType<Ref>())
+        return &any.get<Ref>().get();
+    return nullptr;
+}
+
+/**
+ * Convert an array reflectable to a parameter value. The raw array of
+ * elem_t is formatted directly if available, where each value is
+ * converted to value_t (the type which the single-value path uses).
+ */
+template<typename elem_t, typename value_t, typename read_elem_fun_t>
+ParameterValue reflectableArrayToParameterValue(zserio::IReflectableConstPtr const& ref, read_elem_fun_t const& readElem, ParameterValueHelper& helper)
+{
+    if (auto values = rawArray<elem_t>(ref->getAnyValue()))
+        return helper.array<value_t>(*values);
+
+    // Fallback: Read array elements one-by-one through reflection.
+    auto const length = ref->size();
+    std::vector<decltype(readElem(ref))> values;
     values.reserve(length);
-    for (auto i = 0; i < length; ++i) {
-        appendFun(values, i);
+    for (size_t i = 0; i < length; ++i)
+        values.emplace_back(readElem(ref->at(i)));
+    return helper.array(values);
+}
+
+ParameterValue compoundArrayToParameterValue(zserio::IReflectableConstPtr const& ref, ParameterValueHelper& helper)
+{
+    // All elements are serialized into the same bit buffer, which is
+    // only re-allocated if an element is larger than all previous ones.
+    zserio::BitBuffer buffer;
+    auto const length = ref->size();
+    std::vector<std::string> values;
+    values.reserve(length);
+    for (size_t i = 0; i < length; ++i) {
+        auto element = ref->at(i);
+        auto const bitSize = element->bitSizeOf();
+        auto const byteSize = (bitSize + 7) / 8;
+        if (bitSize > buffer.getBitSize())
+            buffer = zserio::BitBuffer(bitSize);
+        else
+            std::fill(buffer.getBuffer(), buffer.getBuffer() + byteSize, 0);
+        zserio::BitStreamWriter writer(buffer);
+        element->write(writer);
+        values.emplace_back(buffer.getBuffer(), buffer.getBuffer() + byteSize);
     }
     return helper.array(values);
 }
 
-ParameterValue reflectableToParameterValue(std::string const& fieldName, zserio::IReflectableConstPtr const& ref, zserio::ITypeInfo const& refType, ParameterValueHelper& helper)
+/**
+ * Per-call cache of request parts, keyed by field path. The whole request
+ * and any compound fields are measured and serialized at most once per call,
+ * and the resulting buffers are shared by all parameters and the body
+ * which reference them.
+ */
+class RequestPartCache
+{
+public:
+    explicit RequestPartCache(zserio::IReflectableConstPtr request)
+        : request_(std::move(request))
+    {}
+
+    zserio::IReflectableConstPtr const& find(std::string const& fieldPath)
+    {
+        if (fieldPath == ZSERIO_REQUEST_PART_WHOLE)
+            return request_;
+
+        auto it = fields_.find(fieldPath);
+        if (it == fields_.end()) {
+            auto field = request_->find(fieldPath);
+            if (!field)
+                throw std::runtime_error(stx::format("Could not find field/function for identifier '{}'", fieldPath));
+            it = fields_.emplace(fieldPath, std::move(field)).first;
+        }
+        return it->second;
+    }
+
+    zserio::BitBuffer const& serialize(std::string const& fieldPath, zserio::IReflectableConstPtr const& ref)
+    {
+        auto it = buffers_.find(fieldPath);
+        if (it == buffers_.end()) {
+            zserio::BitBuffer buffer(ref->bitSizeOf());
+            zserio::BitStreamWriter writer(buffer);
+            ref->write(writer);
+            it = buffers_.emplace(fieldPath, std::move(buffer)).first;
+        }
+        return it->second;
+    }
+
+private:
+    zserio::IReflectableConstPtr request_;
+    std::unordered_map<std::string, zserio::IReflectableConstPtr> fields_;
+    std::unordered_map<std::string, zserio::BitBuffer> buffers_;
+};
+
+ParameterValue reflectableToParameterValue(std::string const& fieldName, zserio::IReflectableConstPtr const& ref, zserio::ITypeInfo const& refType, ParameterValueHelper& helper, RequestPartCache& cache)
 {
     switch (refType.getCppType())
     {
         case zserio::CppType::BOOL:
             if (ref->isArray()) {
-                return reflectableArrayToParameterValue<uint8_t>([&](auto& arr, auto i) {
-                    arr.emplace_back(static_cast<uint8_t>(ref->at(i)->getBool()));
-                }, ref->size(), helper);
+                return reflectableArrayToParameterValue<bool, uint8_t>(ref, [](auto const& elem) {
+                    return static_cast<uint8_t>(elem->getBool());
+                }, helper);
             }
             return helper.value(static_cast<uint8_t>(ref->getBool()));
         case zserio::CppType::INT8:
+            if (ref->isArray())
+                return reflectableArrayToParameterValue<int8_t, int64_t>(ref, [](auto const& elem) { return elem->toInt(); }, helper);
+            return helper.value(ref->toInt());
         case zserio::CppType::INT16:
+            if (ref->isArray())
+                return reflectableArrayToParameterValue<int16_t, int64_t>(ref, [](auto const& elem) { return elem->toInt(); }, helper);
+            return helper.value(ref->toInt());
         case zserio::CppType::INT32:
+            if (ref->isArray())
+                return reflectableArrayToParameterValue<int32_t, int64_t>(ref, [](auto const& elem) { return elem->toInt(); }, helper);
+            return helper.value(ref->toInt());
         case zserio::CppType::INT64:
-            if (ref->isArray()) {
-                return reflectableArrayToParameterValue<int64_t>([&](auto& arr, auto i) {
-                    arr.emplace_back(ref->at(i)->toInt());
-                }, ref->size(), helper);
-            }
+            if (ref->isArray())
+                return reflectableArrayToParameterValue<int64_t, int64_t>(ref, [](auto const& elem) { return elem->toInt(); }, helper);
             return helper.value(ref->toInt());
         case zserio::CppType::UINT8:
+            if (ref->isArray())
+                return reflectableArrayToParameterValue<uint8_t, uint64_t>(ref, [](auto const& elem) { return elem->toUInt(); }, helper);
+            return helper.value(ref->toUInt());
         case zserio::CppType::UINT16:
+            if (ref->isArray())
+                return reflectableArrayToParameterValue<uint16_t, uint64_t>(ref, [](auto const& elem) { return elem->toUInt(); }, helper);
+            return helper.value(ref->toUInt());
         case zserio::CppType::UINT32:
+            if (ref->isArray())
+                return reflectableArrayToParameterValue<uint32_t, uint64_t>(ref, [](auto const& elem) { return elem->toUInt(); }, helper);
+            return helper.value(ref->toUInt());
         case zserio::CppType::UINT64:
-            if (ref->isArray()) {
-                return reflectableArrayToParameterValue<uint64_t>([&](auto& arr, auto i) {
-                    arr.emplace_back(ref->at(i)->toUInt());
-                }, ref->size(), helper);
-            }
+            if (ref->isArray())
+                return reflectableArrayToParameterValue<uint64_t, uint64_t>(ref, [](auto const& elem) { return elem->toUInt(); }, helper);
             return helper.value(ref->toUInt());
         case zserio::CppType::FLOAT:
+            if (ref->isArray())
+                return reflectableArrayToParameterValue<float, double>(ref, [](auto const& elem) { return elem->toDouble(); }, helper);
+            return helper.value(ref->toDouble());
         case zserio::CppType::DOUBLE:
-            if (ref->isArray()) {
-                return reflectableArrayToParameterValue<double>([&](auto& arr, auto i) {
-                    arr.emplace_back(ref->at(i)->toDouble());
-                }, ref->size(), helper);
-            }
+            if (ref->isArray())
+                return reflectableArrayToParameterValue<double, double>(ref, [](auto const& elem) { return elem->toDouble(); }, helper);
             return helper.value(ref->toDouble());
         case zserio::CppType::STRING:
             if (ref->isArray()) {
-                return reflectableArrayToParameterValue<std::string>([&](auto& arr, auto i) {
-                    arr.emplace_back(ref->at(i)->toString());
-                }, ref->size(), helper);
+                return reflectableArrayToParameterValue<std::string, std::string>(ref, [](auto const& elem) {
+                    return elem->toString();
+                }, helper);
             }
             return helper.value(ref->toString());
-        case zserio::CppType::BIT_BUFFER: {
+        case zserio::CppType::BYTES: {
             if (ref->isArray()) {
-                return reflectableArrayToParameterValue<std::string>([&](auto& arr, auto i) {
-                    auto const& buffer = ref->at(i)->getBytes();
-                    arr.emplace_back(buffer.begin(), buffer.end());
-                }, ref->size(), helper);
+                return reflectableArrayToParameterValue<std::vector<uint8_t>, std::vector<uint8_t>>(ref, [](auto const& elem) {
+                    return elem->getBytes();
+                }, helper);
             }
-            auto const& buffer = ref->getBytes();
-            return helper.binary(std::vector<uint8_t>(buffer.begin(), buffer.end()));
+            return helper.binary(ref->getBytes());
         }
-        case zserio::CppType::BYTES: {
+        case zserio::CppType::BIT_BUFFER: {
             if (ref->isArray()) {
-                return reflectableArrayToParameterValue<std::string>([&](auto& arr, auto i) {
-                    auto const& buffer = ref->at(i)->getBitBuffer();
-                    arr.emplace_back(buffer.getBuffer(), buffer.getBuffer() + buffer.getByteSize());
-                }, ref->size(), helper);
+                return reflectableArrayToParameterValue<zserio::BitBuffer, zserio::BitBuffer>(ref, [](auto const& elem) {
+                    return elem->getBitBuffer();
+                }, helper);
             }
-            auto const& buffer = ref->getBitBuffer();
-            return helper.binary(std::vector<uint8_t>(buffer.getBuffer(), buffer.getBuffer() + buffer.getByteSize()));
+            return helper.binary(ref->getBitBuffer());
         }
         case zserio::CppType::ENUM:
         case zserio::CppType::BITMASK: {
-            return reflectableToParameterValue(fieldName, ref, refType.getUnderlyingType(), helper);
+            return reflectableToParameterValue(fieldName, ref, refType.getUnderlyingType(), helper, cache);
         }
         case zserio::CppType::STRUCT:
         case zserio::CppType::CHOICE:
         case zserio::CppType::UNION: {
-            if (ref->isArray()) {
-                return reflectableArrayToParameterValue<std::string>([&](auto& arr, auto i) {
-                    zserio::BitBuffer buffer(ref->at(i)->bitSizeOf());
-                    zserio::BitStreamWriter writer(buffer);
-                    ref->at(i)->write(writer);
-                    arr.emplace_back(buffer.getBuffer(), buffer.getBuffer() + buffer.getByteSize());
-                }, ref->size(), helper);
-            }
-            zserio::BitBuffer buffer(ref->bitSizeOf());
-            zserio::BitStreamWriter writer(buffer);
-            ref->write(writer);
-            return helper.binary(std::vector<uint8_t>(buffer.getBuffer(), buffer.getBuffer() + buffer.getByteSize()));
+            if (ref->isArray())
+                return compoundArrayToParameterValue(ref, helper);
+            return helper.binary(cache.serialize(fieldName, ref));
         }
 
         case zserio::CppType::SQL_TABLE:
@@ -120,28 +229,47 @@ ParameterValue reflectableToParameterValue(std::string const& fieldName, zserio:
     throw std::runtime_error(stx::format("Failed to serialize field '{}' for HTTP transport.", fieldName));
 }
 
+}
+
+OAClient::MethodHandle OAClient::resolveMethod(zserio::StringView methodName) const
+{
+    return client_.resolveMethod({methodName.data(), methodName.size()});
+}
+
+OpenAPIClient::WarmupReport OAClient::warmup(std::size_t connections)
+{
+    return client_.warmup(connections);
+}
+
 std::vector<uint8_t> OAClient::callMethod(
     zserio::StringView methodName,
     zserio::IServiceData const& requestData,
     void* context)
+{
+    auto method = resolveMethod(methodName);
+    if (!method)
+        throw httpcl::logRuntimeError(stx::format(
+            "The method '{}' is not part of the used OpenAPI specification",
+            std::string_view(methodName.data(), methodName.size())));
+    return callMethod(method, requestData, context);
+}
+
+std::vector<uint8_t> OAClient::callMethod(
+    MethodHandle method,
+    zserio::IServiceData const& requestData,
+    void* context)
 {
     if (!requestData.getReflectable()) {
         throw std::runtime_error(stx::format("Cannot use OAClient: Make sure that zserio generator call has -withTypeInfoCode flag!"));
     }
-    const auto strMethodName = std::string(methodName.begin(), methodName.end());
 
-    auto response = client_.call(strMethodName, [&](const std::string& parameter, const std::string& field, ParameterValueHelper& helper) -> ParameterValue {
-        if (field == ZSERIO_REQUEST_PART_WHOLE) {
-            zserio::BitBuffer buffer(requestData.getReflectable()->bitSizeOf());
-            zserio::BitStreamWriter writer(buffer);
-            requestData.getReflectable()->write(writer);
-            return helper.binary(std::vector<uint8_t>(buffer.getBuffer(), buffer.getBuffer() + buffer.getByteSize()));
-        }
-        auto reflectableField = requestData.getReflectable()->find(field);
-        if (!reflectableField)
-            throw std::runtime_error(stx::format("Could not find field/function for identifier '{}'", field));
-        return reflectableToParameterValue(field, reflectableField, reflectableField->getTypeInfo(), helper);
-    });
+    RequestPartCache cache(requestData.getReflectable());
+    auto response = client_.call(method, [&](const std::string& parameter, const std::string& field, ParameterValueHelper& helper) -> ParameterValue {
+        auto const& reflectable = cache.find(field);
+        if (field == ZSERIO_REQUEST_PART_WHOLE)
+            return helper.binary(cache.serialize(field, reflectable));
+        return reflectableToParameterValue(field, reflectable, reflectable->getTypeInfo(), helper, cache);
+    }, static_cast<CallContext const*>(context));
 
     return {response.begin(), response.end()};
 }
@@ -0,0 +1,118 @@
+#include "private/openapi-balancer.hpp"
+
+#include <algorithm>
+
+namespace zswagcl
+{
+
+using Strategy = httpcl::LoadBalancingPolicy::Strategy;
+
+ServerBalancer::ServerBalancer(std::size_t servers, std::uint32_t seed)
+    : servers_(servers)
+    , random_(seed)
+{}
+
+std::optional<std::size_t> ServerBalancer::pick(httpcl::LoadBalancingPolicy const& policy,
+                                                std::vector<bool> const& tried,
+                                                Clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto const count = servers_.size();
+
+    // Candidates in round-robin order, starting after the last pick.
+    std::vector<std::size_t> candidates;
+    std::vector<std::size_t> ejected;
+    for (auto i = 0u; i < count; ++i) {
+        auto server = (next_ + i) % count;
+        if (server < tried.size() && tried[server])
+            continue;
+        if (now < servers_[server].ejectedUntil)
+            ejected.push_back(server);
+        else
+            candidates.push_back(server);
+    }
+
+    // If all servers are ejected, try the one which returns first.
+    if (candidates.empty()) {
+        if (ejected.empty())
+            return {};
+        candidates.push_back(*std::min_element(ejected.begin(), ejected.end(), [&](auto a, auto b) {
+            return servers_[a].ejectedUntil < servers_[b].ejectedUntil;
+        }));
+    }
+
+    auto result = candidates.front();
+    switch (policy.strategy) {
+    case Strategy::RoundRobin:
+        break;
+    case Strategy::LeastOutstanding:
+        result = *std::min_element(candidates.begin(), candidates.end(), [&](auto a, auto b) {
+            return servers_[a].outstanding < servers_[b].outstanding;
+        });
+        break;
+    case Strategy::PowerOfTwoChoices:
+        if (candidates.size() > 1) {
+            // Servers without a latency yet cost nothing, so they get probed.
+            auto const cost = [&](std::size_t server) {
+                auto const& s = servers_[server];
+                return s.latency.value_or(0.) * static_cast<double>(s.outstanding + 1);
+            };
+            std::uniform_int_distribution<std::size_t> distribution(0, candidates.size() - 1);
+            auto first = distribution(random_);
+            auto second = distribution(random_);
+            if (second == first)
+                second = (first + 1) % candidates.size();
+            result = cost(candidates[second]) < cost(candidates[first]) ? candidates[second] : candidates[first];
+        }
+        break;
+    }
+
+    next_ = (result + 1) % count;
+    ++servers_[result].outstanding;
+    return result;
+}
+
+bool ServerBalancer::release(httpcl::LoadBalancingPolicy const& policy,
+                             std::size_t server,
+                             Outcome outcome,
+                             Clock::duration latency,
+                             Clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& s = servers_[server];
+    --s.outstanding;
+    if (outcome == Outcome::Ignored)
+        return false;
+
+    // Slow failures, like timeouts, also raise the latency.
+    auto const sample = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+    s.latency = s.latency ? EWMA_WEIGHT * sample + (1. - EWMA_WEIGHT) * *s.latency : sample;
+
+    if (outcome == Outcome::Success) {
+        s.consecutiveFailures = 0;
+        return false;
+    }
+
+    if (++s.consecutiveFailures < policy.maxFailures)
+        return false;
+    s.ejectedUntil = now + policy.ejectionTime;
+    return true;
+}
+
+std::vector<ServerBalancer::Stats> ServerBalancer::stats(Clock::time_point now) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Stats> result;
+    for (auto const& s : servers_) {
+        Stats stats;
+        stats.outstanding = s.outstanding;
+        if (s.latency)
+            stats.latency = std::chrono::microseconds(static_cast<std::int64_t>(*s.latency));
+        stats.consecutiveFailures = s.consecutiveFailures;
+        stats.ejected = now < s.ejectedUntil;
+        result.push_back(stats);
+    }
+    return result;
+}
+
+}
@@ -1,11 +1,23 @@
 #include "private/openapi-client.hpp"
+#include "private/openapi-hedging.hpp"
+#include "private/openapi-memo.hpp"
+#include "private/openapi-retry.hpp"
+#include "private/openapi-single-flight.hpp"
+#include "private/openapi-snapshot.hpp"
 
 #include <cassert>
 #include <variant>
 #include <future>
+#include <atomic>
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <map>
+#include <mutex>
 
 #include "stx/format.h"
 #include "spdlog/spdlog.h"
+#include "httpcl/digest.hpp"
 #include "httpcl/log.hpp"
 
 namespace zswagcl
@@ -67,10 +79,10 @@ void resolveHeaderAndQueryParameters(httpcl::Config& result,
         {
             ParameterValueHelper helper(parameter);
             auto values = paramCb(parameter.ident, parameter.field, helper).queryOrHeaderPairs(parameter);
-            auto& destination = (parameter.location == OpenAPIConfig::ParameterLocation::Header) ?
-                result.headers : result.query;
-            for (auto const& value : values)
-                destination.insert(value);
+            if (parameter.location == OpenAPIConfig::ParameterLocation::Header)
+                result.headers.insert(values.begin(), values.end());
+            else
+                result.query.insert(values.begin(), values.end());
             break;
         }
         default:
@@ -113,115 +125,725 @@ void checkSecurityAlternativesAndApplyApiKey(OpenAPIConfig::SecurityAlternatives
         throw std::runtime_error(error.str());
 }
 
+/**
+ * Identify a request by everything that may affect its response:
+ * The full URL, headers, cookies and a digest of the basic-auth credentials.
+ */
+std::string coalescingKey(httpcl::URIComponents uri, httpcl::Config const& config)
+{
+    for (auto const& [key, value] : config.query)
+        uri.addQuery(key, value);
+
+    auto result = uri.build();
+    for (auto const& [key, value] : config.headers)
+        result.append("\nH:").append(key).append(": ").append(value);
+    for (auto const& [key, value] : config.cookies)
+        result.append("\nC:").append(key).append("=").append(value);
+    if (config.auth)
+        result.append("\nA:").append(httpcl::PreparedConfig::get(config)->authDigest);
+    return result;
+}
+
+/**
+ * Get the binary encoded request object.
+ */
+std::string serializeRequest(const OpenAPIClient::ParameterResolver& paramCb)
+{
+    OpenAPIConfig::Parameter bodyParameter;
+    bodyParameter.ident = "body";
+    bodyParameter.format = OpenAPIConfig::Parameter::Format::Binary;
+
+    ParameterValueHelper bodyHelper(bodyParameter);
+    return paramCb("", ZSERIO_REQUEST_PART_WHOLE, bodyHelper).bodyStr();
+}
+
+/**
+ * Memo key of a serialized request, and of the headers of
+ * the call context, which may also affect the response.
+ */
+Memo::Key makeMemoKey(std::string const& operationId, std::string const& request, CallContext const* context)
+{
+    auto hash = openAPIContentHash(request);
+    std::string headers;
+    if (context && !context->headers.empty()) {
+        for (auto const& [key, value] : context->headers)
+            headers.append(key).append(": ").append(value).append("\n");
+        hash ^= openAPIContentHash(headers) * 0x9e3779b97f4a7c15ull;
+    }
+    return {operationId, hash, httpcl::sha256(headers + '\0' + request)};
 }
 
+}
+
+/**
+ * Operation ids of the spec in sorted order, for binary search by
+ * string_view. The path of a lazily parsed operation is looked up on first use.
+ * Built once per config, and shared by all clients of the config.
+ */
+struct OpenAPIClient::MethodTable
+{
+    struct Entry
+    {
+        std::string ident;
+        mutable std::atomic<OpenAPIConfig::Path const*> path{nullptr};
+
+        /**
+         * Get the path, looking it up on first use.
+         * Returns null if it is not part of the spec.
+         */
+        OpenAPIConfig::Path const* resolve(OpenAPIConfig const& config) const
+        {
+            auto result = path.load(std::memory_order_acquire);
+            if (!result) {
+                result = config.findPath(ident);
+                if (result)
+                    path.store(result, std::memory_order_release);
+            }
+            return result;
+        }
+    };
+
+    /** Keeps the config at its address while the table is shared. */
+    std::shared_ptr<const OpenAPIConfig> config;
+    std::unique_ptr<Entry[]> entries;
+    std::size_t size = 0;
+
+    explicit MethodTable(std::shared_ptr<const OpenAPIConfig> config)
+        : config(std::move(config))
+    {
+        auto ids = this->config->operationIds();
+        std::sort(ids.begin(), ids.end());
+        entries = std::make_unique<Entry[]>(ids.size());
+        size = ids.size();
+        for (auto i = 0u; i < size; ++i) {
+            entries[i].ident = std::move(ids[i]);
+            if (auto it = this->config->methodPath.find(entries[i].ident); it != this->config->methodPath.end())
+                entries[i].path = &it->second;
+        }
+    }
+
+    /**
+     * Get the table of a config, which is only built by the first client.
+     */
+    static std::shared_ptr<const MethodTable> of(std::shared_ptr<const OpenAPIConfig> const& config)
+    {
+        static std::mutex mutex;
+        static std::map<OpenAPIConfig const*, std::weak_ptr<const MethodTable>> tables;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& table = tables[config.get()];
+        if (auto result = table.lock())
+            return result;
+
+        auto result = std::make_shared<const MethodTable>(config);
+        table = result;
+        for (auto it = tables.begin(); it != tables.end();) {
+            if (it->second.expired())
+                it = tables.erase(it);
+            else
+                ++it;
+        }
+        return result;
+    }
+};
+
+struct OpenAPIClient::Counters
+{
+    std::atomic<std::uint64_t> hedgesIssued{0};
+    std::atomic<std::uint64_t> hedgesWon{0};
+    std::atomic<std::uint64_t> coalesced{0};
+    std::atomic<std::uint64_t> memoized{0};
+};
+
 OpenAPIClient::OpenAPIClient(OpenAPIConfig config,
                              httpcl::Config httpConfig,
                              std::unique_ptr<httpcl::IHttpClient> client)
+    : OpenAPIClient(std::make_shared<const OpenAPIConfig>(std::move(config)),
+                    std::move(httpConfig),
+                    std::shared_ptr<httpcl::IHttpClient>(std::move(client)))
+{}
+
+OpenAPIClient::OpenAPIClient(std::shared_ptr<const OpenAPIConfig> config,
+                             httpcl::Config httpConfig,
+                             std::shared_ptr<httpcl::IHttpClient> client,
+                             std::shared_ptr<const httpcl::Settings> settings)
     : config_(std::move(config))
+    , httpConfig_(std::move(httpConfig))
     , client_(std::move(client))
-    , httpConfig_(httpConfig)
+    , settings_(std::move(settings))
 {
-    httpcl::log().debug("Instantiating OpenApiClient for node at '{}'", config_.uri.build());
+    assert(config_);
     assert(client_);
+    httpcl::log().debug("Instantiating OpenApiClient for node at '{}'", config_->uri.build());
+
+    if (!settings_)
+        settings_ = std::make_shared<const httpcl::Settings>();
+    methods_ = MethodTable::of(config_);
+    latencies_ = std::make_unique<LatencyTracker[]>(methods_->size);
+    retryBudget_ = std::make_unique<RetryBudget>();
+    hedgeBudget_ = std::make_unique<RetryBudget>();
+    counters_ = std::make_unique<Counters>();
+    rateLimiters_ = std::make_unique<httpcl::RateLimiters>();
+    singleFlight_ = std::make_unique<SingleFlight>();
+
+    if (auto maxUrlLengthStr = std::getenv("HTTP_MAX_URL_LENGTH")) {
+        try {
+            maxUrlLength_ = std::stoull(maxUrlLengthStr);
+        }
+        catch (std::exception& e) {
+            httpcl::log().warn("Could not parse value of HTTP_MAX_URL_LENGTH.");
+        }
+    }
+    if (auto memoMaxBytesStr = std::getenv("HTTP_MEMO_MAX_BYTES")) {
+        try {
+            memoMaxBytes_ = std::stoull(memoMaxBytesStr);
+        }
+        catch (std::exception& e) {
+            httpcl::log().warn("Could not parse value of HTTP_MEMO_MAX_BYTES.");
+        }
+    }
+    memo_ = std::make_unique<Memo>(memoMaxBytes_);
+
+    if (config_->servers.size() > 1)
+        balancer_ = std::make_unique<ServerBalancer>(config_->servers.size());
 }
 
 OpenAPIClient::~OpenAPIClient()
 {}
 
-std::string OpenAPIClient::call(const std::string& methodIdent,
-                                const std::function<ParameterValue(const std::string&, /* parameter ident */
-                                                                   const std::string&, /* zserio member path */
-                                                                   ParameterValueHelper&)>& paramCb)
+OpenAPIClient::Metrics OpenAPIClient::metrics() const
 {
-    auto methodIter = config_.methodPath.find(methodIdent);
-    if (methodIter == config_.methodPath.end())
-        throw httpcl::logRuntimeError(stx::format("The method '{}' is not part of the used OpenAPI specification", methodIdent));
+    Metrics result;
+    result.hedgesIssued = counters_->hedgesIssued;
+    result.hedgesWon = counters_->hedgesWon;
+    result.coalesced = counters_->coalesced;
+    result.coalescing = singleFlight_->waiting();
+    result.memoized = counters_->memoized;
+    result.circuits = client_->circuitStates();
+    result.concurrency = client_->concurrencyLimits();
+    result.cache = client_->cacheStats();
+    if (balancer_) {
+        auto servers = balancer_->stats();
+        for (auto i = 0u; i < servers.size(); ++i)
+            result.servers[config_->servers[i].build()] = servers[i];
+    }
+    return result;
+}
+
+OpenAPIClient::WarmupReport OpenAPIClient::warmup(std::size_t connections)
+{
+    using namespace std::chrono;
+
+    WarmupReport report;
+    auto const start = steady_clock::now();
+    auto const since = [](steady_clock::time_point begin) {
+        return duration_cast<microseconds>(steady_clock::now() - begin);
+    };
+
+    // Look up the operations while the connections are opened.
+    auto plans = std::async(std::launch::async, [&] {
+        auto const begin = steady_clock::now();
+        for (auto i = 0u; i < methods_->size; ++i)
+            if (methods_->entries[i].resolve(*config_))
+                ++report.methods;
+        report.plans = since(begin);
+    });
+
+    auto servers = balancer_ ? config_->servers : std::vector<httpcl::URIComponents>{config_->uri};
+    auto resolve = std::async(std::launch::async, [&] {
+        auto const begin = steady_clock::now();
+        if (auto dns = httpcl::DnsCache::shared())
+            for (auto const& server : servers)
+                if (!dns->resolve(server.host))
+                    httpcl::log().warn("Could not resolve {}.", server.host);
+        report.resolve = since(begin);
+    });
+
+    auto begin = steady_clock::now();
+    auto uri = config_->uri.build();
+    auto httpConfig = (*settings_)[uri];
+    httpConfig |= httpConfig_;
+    httpcl::PreparedConfig::get(httpConfig);
+    report.settings = since(begin);
+
+    // Connections use the resolved addresses.
+    resolve.get();
+    begin = steady_clock::now();
+    std::vector<std::future<std::size_t>> opened;
+    for (auto const& server : servers)
+        opened.emplace_back(std::async(std::launch::async, [&, serverUri = server.build()] {
+            return client_->preconnect(serverUri, httpConfig, connections);
+        }));
+    for (auto& count : opened)
+        report.connections += count.get();
+    report.connect = since(begin);
+
+    plans.get();
+    report.total = since(start);
+    httpcl::log().debug(
+        "Warmed up the client for {} in {}us: {} methods, {} connections.",
+        uri, report.total.count(), report.methods, report.connections);
+    return report;
+}
+
+httpcl::IHttpClient::Result OpenAPIClient::hedge(
+    LatencyTracker& latency,
+    const httpcl::Config& httpConfig,
+    const std::string& debugContext,
+    const std::function<httpcl::IHttpClient::Result(const httpcl::Config&)>& perform)
+{
+    using Result = httpcl::IHttpClient::Result;
+    auto const& policy = *httpConfig.hedging;
+    auto const start = std::chrono::steady_clock::now();
+    hedgeBudget_->deposit(policy.budget);
+
+    // Outcome of the first finished request.
+    struct Race
+    {
+        std::mutex mutex;
+        std::condition_variable done;
+        std::optional<Result> result;
+        std::exception_ptr error;
+        std::size_t winner = 0;
+        std::size_t running = 0;
+
+        bool finished() const {
+            return result || error;
+        }
+    } race;
+
+    // Each request is cancelled through its own token, which
+    // is also cancelled if the whole call is cancelled.
+    std::array<std::shared_ptr<httpcl::CancellationToken>, 2> tokens{
+        std::make_shared<httpcl::CancellationToken>(),
+        std::make_shared<httpcl::CancellationToken>()};
+
+    std::vector<std::future<void>> requests;
+    auto cancelSubscription = httpcl::CancellationToken::subscribe(httpConfig.cancellation, [&tokens] {
+        for (auto const& token : tokens)
+            token->cancel();
+    });
+
+    auto launch = [&](std::size_t index) {
+        auto requestConfig = httpConfig;
+        requestConfig.cancellation = tokens[index];
+        {
+            std::lock_guard<std::mutex> lock(race.mutex);
+            ++race.running;
+        }
+        requests.emplace_back(std::async(std::launch::async, [&race, &perform, index, requestConfig = std::move(requestConfig)] {
+            std::optional<Result> result;
+            std::exception_ptr error;
+            try {
+                result = perform(requestConfig);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(race.mutex);
+            --race.running;
+            // A failed connection only wins if no other request is running.
+            if (race.finished() || (result && result->status == 0 && race.running > 0))
+                return;
+            race.result = std::move(result);
+            race.error = error;
+            race.winner = index;
+            race.done.notify_all();
+        }));
+    };
+
+    launch(0);
+    std::unique_lock<std::mutex> lock(race.mutex);
+    if (auto threshold = latency.percentile(policy.percentile)) {
+        auto delay = std::max<std::chrono::microseconds>(*threshold, policy.minDelay);
+        if (!race.done.wait_for(lock, delay, [&race] { return race.finished(); })) {
+            if (hedgeBudget_->withdraw()) {
+                lock.unlock();
+                httpcl::log().debug("{} No response after {} us, sending hedged request ...", debugContext, delay.count());
+                ++counters_->hedgesIssued;
+                launch(1);
+                lock.lock();
+            }
+            else
+                httpcl::log().debug("{} Hedging budget is exhausted.", debugContext);
+        }
+    }
+
+    while (!race.done.wait_for(lock, std::chrono::seconds{1}, [&race] { return race.finished(); }))
+        httpcl::log().debug("{} Waiting for response ...", debugContext);
+    auto winner = race.winner;
+    auto error = race.error;
+    auto result = std::move(race.result);
+    lock.unlock();
+
+    // Cancel the slower request. Its thread is joined on return.
+    for (auto i = 0u; i < tokens.size(); ++i)
+        if (i != winner)
+            tokens[i]->cancel();
+    if (winner > 0)
+        ++counters_->hedgesWon;
+
+    if (error)
+        std::rethrow_exception(error);
+    if (result->status != 0)
+        latency.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
+    httpcl::log().debug("{} Response received (code {}, content length {} bytes).", debugContext, result->status, result->content.size());
+    return std::move(*result);
+}
+
+httpcl::IHttpClient::Result OpenAPIClient::retry(
+    const OpenAPIConfig::Path& method,
+    const httpcl::Config& httpConfig,
+    const std::string& debugContext,
+    httpcl::IHttpClient::Result result,
+    const std::function<httpcl::IHttpClient::Result()>& sendRequest)
+{
+    auto const& policy = *httpConfig.retry;
+    retryBudget_->deposit(policy.budget);
+    if (!method.isIdempotent())
+        return result;
+
+    auto const stopped = [&httpConfig](std::chrono::milliseconds delay) {
+        return (httpConfig.cancellation && httpConfig.cancellation->cancelled()) ||
+            (httpConfig.deadline && std::chrono::steady_clock::now() + delay >= *httpConfig.deadline);
+    };
+
+    for (auto attempt = 1u; attempt < policy.maxAttempts && isRetryableStatus(result.status); ++attempt)
+    {
+        auto delay = retryBackoff(policy, attempt);
+        if (auto retryAfterStr = result.header("Retry-After")) {
+            if (auto retryAfter = httpcl::parseRetryAfter(*retryAfterStr)) {
+                if (*retryAfter > policy.maxBackoff) {
+                    httpcl::log().debug("{} Retry-After {} exceeds the maximum backoff, not retrying.", debugContext, *retryAfterStr);
+                    break;
+                }
+                delay = std::max(delay, *retryAfter);
+            }
+        }
 
-    const auto& method = methodIter->second;
+        if (stopped(delay))
+            break;
+        if (!retryBudget_->withdraw()) {
+            httpcl::log().warn("{} Retry budget is exhausted, not retrying.", debugContext);
+            break;
+        }
+
+        httpcl::log().debug("{} Got HTTP status {}, retrying in {} ms (attempt {} of {}) ...",
+                            debugContext, result.status, delay.count(), attempt + 1, policy.maxAttempts);
+        if (!httpcl::sleepUnlessCancelled(delay, httpConfig.cancellation))
+            break;
+        result = sendRequest();
+    }
+
+    return result;
+}
 
-    httpcl::URIComponents uri(config_.uri);
-    uri.appendPath(resolvePath(method, paramCb));
+OpenAPIClient::MethodHandle OpenAPIClient::resolveMethod(std::string_view methodIdent) const
+{
+    auto begin = methods_->entries.get();
+    auto end = begin + methods_->size;
+    auto it = std::lower_bound(begin, end, methodIdent, [](auto const& entry, std::string_view ident) {
+        return std::string_view(entry.ident) < ident;
+    });
+    if (it == end || it->ident != methodIdent)
+        return {};
+    return {static_cast<std::size_t>(it - begin)};
+}
+
+std::string OpenAPIClient::call(std::string_view methodIdent,
+                                const ParameterResolver& paramCb,
+                                const CallContext* context)
+{
+    auto handle = resolveMethod(methodIdent);
+    if (!handle)
+        throw httpcl::logRuntimeError(stx::format("The method '{}' is not part of the used OpenAPI specification", methodIdent));
+    return call(handle, paramCb, context);
+}
+
+std::string OpenAPIClient::call(MethodHandle methodHandle,
+                                const ParameterResolver& paramCb,
+                                const CallContext* context)
+{
+    if (!methodHandle || methodHandle.index >= methods_->size)
+        throw httpcl::logRuntimeError("Invalid OpenAPI method handle.");
+
+    auto const& entry = methods_->entries[methodHandle.index];
+    auto methodPtr = entry.resolve(*config_);
+    if (!methodPtr)
+        throw httpcl::logRuntimeError(stx::format("The method '{}' is not part of the used OpenAPI specification", entry.ident));
+
+    const auto& method = *methodPtr;
+
+    // Operations which are pure functions remember their responses.
+    std::optional<std::string> request;
+    std::optional<Memo::Key> memoKey;
+    if (method.cacheTtl) {
+        request = serializeRequest(paramCb);
+        memoKey = makeMemoKey(entry.ident, *request, context);
+        if (auto response = memo_->get(*memoKey)) {
+            httpcl::log().debug("[{}] Using the remembered response.", entry.ident);
+            ++counters_->memoized;
+            return *response;
+        }
+    }
+    auto const remember = [&](std::string response) {
+        if (memoKey)
+            memo_->put(*memoKey, response, *method.cacheTtl);
+        return response;
+    };
+
+    auto const path = resolvePath(method, paramCb);
+    httpcl::URIComponents uri(config_->uri);
+    uri.appendPath(path);
     std::string builtUri = uri.build();
     std::string debugContext = stx::format("[{} {}]", method.httpMethod, uri.buildPath());
     httpcl::log().debug("{} Calling endpoint {} ...", debugContext, builtUri);
 
-    // Initialize HTTP config from persistent and ad-hoc values
-    auto httpConfig = settings_[builtUri];
-    httpConfig |= httpConfig_;
+    // Header and query parameters, which are resolved once for all servers.
+    httpcl::Config parameters;
 
-    // Make sure that the server responds with correct content type
-    httpConfig.headers.insert({"Accept", ZSERIO_OBJECT_CONTENT_TYPE});
+    // Initialize HTTP config for a request URL from persistent, ad-hoc
+    // and per-call values. The settings are looked up for each URL, so
+    // that every server gets its own credentials.
+    auto configFor = [&](const std::string& target)
+    {
+        auto result = (*settings_)[target];
+        result |= httpConfig_;
+
+        // Timeouts of the call take precedence over the settings,
+        // which take precedence over the spec's operation defaults.
+        auto timeouts = method.timeouts;
+        timeouts |= result.timeouts;
+        if (context) {
+            timeouts |= context->timeouts;
+            if (context->deadline && (!result.deadline || *context->deadline < *result.deadline))
+                result.deadline = context->deadline;
+            if (context->cancellation)
+                result.cancellation = context->cancellation;
+            for (auto const& [key, value] : context->headers)
+                result.headers.set(key, value);
+        }
+        result.timeouts = timeouts;
 
-    httpcl::log().debug("{} Resolving query/path parameters ...", debugContext);
-    resolveHeaderAndQueryParameters(httpConfig, method, paramCb);
+        // Make sure that the server responds with correct content type
+        result.headers.set("Accept", ZSERIO_OBJECT_CONTENT_TYPE);
+
+        result.headers |= parameters.headers;
+        result.query |= parameters.query;
+        return result;
+    };
 
     // Check whether the given config fulfills the required security schemes.
     // Throws if the http config does not fulfill any allowed scheme.
-    if (method.security) {
-        httpcl::log().debug("{} Checking required security schemes for method ...", debugContext);
-        checkSecurityAlternativesAndApplyApiKey(*method.security, httpConfig);
-    }
-    else {
-        httpcl::log().debug("{} Checking default security scheme ...", debugContext);
-        checkSecurityAlternativesAndApplyApiKey(config_.defaultSecurityScheme, httpConfig);
+    auto secure = [&](httpcl::Config& requestConfig)
+    {
+        if (method.security)
+            checkSecurityAlternativesAndApplyApiKey(*method.security, requestConfig);
+        else
+            checkSecurityAlternativesAndApplyApiKey(config_->defaultSecurityScheme, requestConfig);
+    };
+
+    auto httpConfig = configFor(builtUri);
+
+    if (httpConfig.cancellation && httpConfig.cancellation->cancelled())
+        throw httpcl::IHttpClient::Error({0, {}}, stx::format("{} Call was cancelled.", debugContext));
+    if (httpConfig.deadline && std::chrono::steady_clock::now() >= *httpConfig.deadline)
+        throw httpcl::IHttpClient::Error({0, {}}, stx::format("{} Deadline exceeded.", debugContext));
+
+    httpcl::log().debug("{} Resolving query/path parameters ...", debugContext);
+    resolveHeaderAndQueryParameters(parameters, method, paramCb);
+    httpConfig.headers |= parameters.headers;
+    httpConfig.query |= parameters.query;
+
+    // Switch to the body-carrying fallback operation, if the URL is too long.
+    if (method.bodyFallback) {
+        httpcl::URIComponents fullUri(uri);
+        for (auto const& [key, value] : httpConfig.query)
+            fullUri.addQuery(key, value);
+        auto urlLength = fullUri.build().size();
+
+        if (urlLength > maxUrlLength_) {
+            auto fallback = config_->findPath(*method.bodyFallback);
+            if (!fallback || !fallback->bodyRequestObject || fallback->bodyFallback)
+                throw httpcl::logRuntimeError(stx::format(
+                    "{} The body fallback '{}' must be an operation which accepts the request body.",
+                    debugContext, *method.bodyFallback));
+
+            httpcl::log().debug("{} URL length {} exceeds {}, calling '{}' instead ...",
+                                debugContext, urlLength, maxUrlLength_, *method.bodyFallback);
+            return remember(call(*method.bodyFallback, paramCb, context));
+        }
     }
 
+    httpcl::log().debug("{} Checking security schemes for method ...", debugContext);
+    secure(httpConfig);
+
     const auto& httpMethod = method.httpMethod;
-    std::future<httpcl::IHttpClient::Result> resultFuture = ([&]()
+    httpcl::OptionalBodyAndContentType body;
+    if (httpMethod != "GET" && method.bodyRequestObject) {
+        httpcl::log().debug("{} Fetching body request body ...", debugContext);
+        body = httpcl::BodyAndContentType{
+            request ? *request : serializeRequest(paramCb), ZSERIO_OBJECT_CONTENT_TYPE
+        };
+    }
+
+    // Operations with a rate limit wait for their turn before each attempt.
+    std::shared_ptr<httpcl::RateLimiter> rateLimiter;
+    if (auto it = httpConfig.operationRateLimits.find(entry.ident); it != httpConfig.operationRateLimits.end())
+        rateLimiter = rateLimiters_->get(entry.ident, it->second);
+
+    auto transmitTo = [&](const std::string& target, const httpcl::Config& requestConfig)
+    {
+        if (httpMethod == "GET")
+            return client_->get(target, requestConfig);
+        if (httpMethod == "POST")
+            return client_->post(target, body, requestConfig);
+        if (httpMethod == "PUT")
+            return client_->put(target, body, requestConfig);
+        if (httpMethod == "PATCH")
+            return client_->patch(target, body, requestConfig);
+        if (httpMethod == "DELETE")
+            return client_->del(target, body, requestConfig);
+
+        throw httpcl::logRuntimeError(stx::format(
+            "{} Unsupported HTTP method!", debugContext));
+    };
+
+    // Send each request to one of the servers, and fail over to
+    // the next server if an idempotent request fails.
+    auto transmit = [&](const httpcl::Config& requestConfig)
     {
-        if (httpMethod == "GET") {
-            httpcl::log().debug("{} Executing request ...", debugContext);
-            return std::async(std::launch::async, [builtUri, httpConfig, this]{
-                return client_->get(builtUri, httpConfig);
-            });
-        } else {
-            httpcl::OptionalBodyAndContentType body;
-            if (method.bodyRequestObject) {
-                httpcl::log().debug("{} Fetching body request body ...", debugContext);
-                body = httpcl::BodyAndContentType{
-                    "", ZSERIO_OBJECT_CONTENT_TYPE
-                };
-
-                OpenAPIConfig::Parameter bodyParameter;
-                bodyParameter.ident = "body";
-                bodyParameter.format = OpenAPIConfig::Parameter::Format::Binary;
-
-                ParameterValueHelper bodyHelper(bodyParameter);
-                body->body = paramCb("", ZSERIO_REQUEST_PART_WHOLE, bodyHelper).bodyStr();
+        if (!balancer_)
+            return transmitTo(builtUri, requestConfig);
+
+        using Outcome = ServerBalancer::Outcome;
+        auto const policy = requestConfig.loadBalancing.value_or(httpcl::LoadBalancingPolicy{});
+        std::vector<bool> tried(config_->servers.size());
+        while (true) {
+            auto server = *balancer_->pick(policy, tried);
+            tried[server] = true;
+            auto const remaining = std::count(tried.begin(), tried.end(), false) > 0;
+
+            httpcl::URIComponents serverUri(config_->servers[server]);
+            serverUri.appendPath(path);
+            auto const target = serverUri.build();
+            auto const start = std::chrono::steady_clock::now();
+            auto const release = [&](Outcome outcome) {
+                if (balancer_->release(policy, server, outcome, std::chrono::steady_clock::now() - start))
+                    httpcl::log().warn("{} Ejecting server {} after {} failures.",
+                                       debugContext, config_->servers[server].build(), policy.maxFailures);
+            };
+
+            httpcl::IHttpClient::Result result;
+            try {
+                // Other servers than the first one may have their own settings.
+                if (target == builtUri)
+                    result = transmitTo(target, requestConfig);
+                else {
+                    auto serverConfig = configFor(target);
+                    serverConfig.deadline = requestConfig.deadline;
+                    serverConfig.cancellation = requestConfig.cancellation;
+                    secure(serverConfig);
+                    result = transmitTo(target, serverConfig);
+                }
+            }
+            catch (httpcl::IHttpClient::CircuitOpenError const&) {
+                // The request was not sent, so any method may fail over.
+                release(Outcome::Failure);
+                if (!remaining)
+                    throw;
+                continue;
+            }
+            catch (...) {
+                release(Outcome::Ignored);
+                throw;
             }
 
-            httpcl::log().debug("{} Executing request ...", debugContext);
-            if (httpMethod == "POST")
-                return std::async(std::launch::async, [builtUri, body, httpConfig, this]{
-                    return client_->post(builtUri, body, httpConfig);
-                });
-            if (httpMethod == "PUT")
-                return std::async(std::launch::async, [builtUri, body, httpConfig, this]{
-                    return client_->put(builtUri, body, httpConfig);
-                });
-            if (httpMethod == "PATCH")
-                return std::async(std::launch::async, [builtUri, body, httpConfig, this]{
-                    return client_->patch(builtUri, body, httpConfig);
-                });
-            if (httpMethod == "DELETE")
-                return std::async(std::launch::async, [builtUri, body, httpConfig, this]{
-                    return client_->del(builtUri, body, httpConfig);
-                });
-
-            throw httpcl::logRuntimeError(stx::format(
-                "{} Unsupported HTTP method!", debugContext));
-        }
-    }());
-
-    // Wait for resultFuture
-    while (resultFuture.wait_for(std::chrono::seconds{1}) != std::future_status::ready)
-        httpcl::log().debug("{} Waiting for response ...", debugContext);
-    auto result = resultFuture.get();
-    httpcl::log().debug("{} Response received (code {}, content length {} bytes).", debugContext, result.status, result.content.size());
+            if (result.status == 0 &&
+                ((requestConfig.cancellation && requestConfig.cancellation->cancelled()) ||
+                 (requestConfig.deadline && std::chrono::steady_clock::now() >= *requestConfig.deadline))) {
+                release(Outcome::Ignored);
+                return result;
+            }
+
+            auto const failed = result.status == 0 || result.status >= 500;
+            release(failed ? Outcome::Failure : Outcome::Success);
+            if (!failed || !remaining || !method.isIdempotent())
+                return result;
+            httpcl::log().debug("{} Server {} failed (status {}), trying the next server ...",
+                                debugContext, config_->servers[server].build(), result.status);
+        }
+    };
+
+    // Execute the request with the given config, blocking.
+    auto perform = [&](const httpcl::Config& requestConfig)
+    {
+        if (!rateLimiter)
+            return transmit(requestConfig);
+
+        auto waitUntil = std::chrono::steady_clock::now() + rateLimiter->policy().maxWait;
+        if (requestConfig.deadline)
+            waitUntil = std::min(waitUntil, *requestConfig.deadline);
+        if (!rateLimiter->acquire(waitUntil, requestConfig.cancellation)) {
+            // Cancellation and deadline are reported by the caller.
+            if ((requestConfig.cancellation && requestConfig.cancellation->cancelled()) ||
+                (requestConfig.deadline && std::chrono::steady_clock::now() >= *requestConfig.deadline))
+                return httpcl::IHttpClient::Result{0, {}};
+            throw httpcl::IHttpClient::RateLimitError(entry.ident);
+        }
+
+        auto result = transmit(requestConfig);
+        rateLimiter->update(result.status, result.headers);
+        return result;
+    };
+
+    auto sendRequest = [&]()
+    {
+        httpcl::log().debug("{} Executing request ...", debugContext);
+        if (httpConfig.hedging && httpMethod == "GET" && method.isIdempotent())
+            return hedge(latencies_[methodHandle.index], httpConfig, debugContext, perform);
+
+        auto resultFuture = std::async(std::launch::async, perform, std::cref(httpConfig));
+
+        // Wait for resultFuture
+        while (resultFuture.wait_for(std::chrono::seconds{1}) != std::future_status::ready)
+            httpcl::log().debug("{} Waiting for response ...", debugContext);
+        auto result = resultFuture.get();
+        httpcl::log().debug("{} Response received (code {}, content length {} bytes).", debugContext, result.status, result.content.size());
+        return result;
+    };
+
+    auto sendWithRetries = [&]()
+    {
+        auto result = sendRequest();
+        if (httpConfig.retry)
+            result = retry(method, httpConfig, debugContext, std::move(result), sendRequest);
+        return result;
+    };
+
+    // Identical concurrent GET calls share one request, if enabled.
+    httpcl::IHttpClient::Result result;
+    if (httpConfig.coalesce.value_or(false) && httpMethod == "GET" && method.isIdempotent()) {
+        auto shared = false;
+        result = *singleFlight_->run(coalescingKey(uri, httpConfig), sendWithRetries, httpConfig, shared);
+        if (shared) {
+            httpcl::log().debug("{} Shared the response of an identical call.", debugContext);
+            ++counters_->coalesced;
+        }
+    }
+    else
+        result = sendWithRetries();
 
     if (result.status >= 200 && result.status < 300) {
-        return std::move(result.content);
+        return remember(std::move(result.content));
+    }
+
+    if (result.status == 0) {
+        if (httpConfig.cancellation && httpConfig.cancellation->cancelled())
+            throw httpcl::IHttpClient::Error(result, stx::format("{} Call was cancelled.", debugContext));
+        if (httpConfig.deadline && std::chrono::steady_clock::now() >= *httpConfig.deadline)
+            throw httpcl::IHttpClient::Error(result, stx::format("{} Deadline exceeded.", debugContext));
     }
 
     // Throw due to bad response code
@@ -9,6 +9,10 @@ namespace zswagcl
 const std::string ZSERIO_OBJECT_CONTENT_TYPE = "application/x-zserio-object";
 const std::string ZSERIO_REQUEST_PART = "x-zserio-request-part";
 const std::string ZSERIO_REQUEST_PART_WHOLE = "*";
+const std::string ZSWAG_BODY_FALLBACK = "x-zswag-body-fallback";
+const std::string ZSWAG_TIMEOUTS = "x-zswag-timeouts";
+const std::string ZSWAG_IDEMPOTENT = "x-zswag-idempotent";
+const std::string ZSWAG_CACHE = "x-zswag-cache";
 
 bool OpenAPIConfig::BasicAuth::checkOrApply(httpcl::Config& config, std::string& err) const {
     if (config.auth.has_value())
@@ -20,7 +24,7 @@ bool OpenAPIConfig::BasicAuth::checkOrApply(httpcl::Config& config, std::string&
     };
 
     auto found = std::any_of(config.headers.begin(), config.headers.end(), [&](auto const& headerNameAndValue){
-        return headerNameAndValue.first == "Authorization" &&
+        return httpcl::Headers::keyEquals(headerNameAndValue.first, "Authorization") &&
                std::regex_match(headerNameAndValue.second, basicAuthValueRe);
     });
 
@@ -62,7 +66,7 @@ bool OpenAPIConfig::CookieAuth::checkOrApply(httpcl::Config& config, std::string
     if (config.cookies.find(cookieName) != config.cookies.end())
         return true;
     if (config.apiKey) {
-        config.cookies.insert({cookieName, *config.apiKey});
+        config.cookies.tryEmplace(cookieName, *config.apiKey);
         return true;
     }
     err = stx::format("Neither api-key nor cookie `{}` is set.", cookieName);
@@ -76,7 +80,7 @@ bool OpenAPIConfig::BearerAuth::checkOrApply(httpcl::Config& config, std::string
     };
 
     auto found = std::any_of(config.headers.begin(), config.headers.end(), [&](auto const& headerNameAndValue){
-        return headerNameAndValue.first == "Authorization" &&
+        return httpcl::Headers::keyEquals(headerNameAndValue.first, "Authorization") &&
                std::regex_match(headerNameAndValue.second, bearerValueRe);
     });
 
@@ -86,6 +90,35 @@ bool OpenAPIConfig::BearerAuth::checkOrApply(httpcl::Config& config, std::string
     return false;
 }
 
+bool OpenAPIConfig::Path::isIdempotent() const
+{
+    if (idempotent)
+        return *idempotent;
+    return httpMethod == "GET" || httpMethod == "PUT" || httpMethod == "DELETE";
+}
+
+OpenAPIConfig::Path const* OpenAPIConfig::findPath(std::string const& methodIdent) const
+{
+    if (auto it = methodPath.find(methodIdent); it != methodPath.end())
+        return &it->second;
+    if (lazyPaths)
+        return lazyPaths->find(methodIdent);
+    return nullptr;
+}
+
+std::vector<std::string> OpenAPIConfig::operationIds() const
+{
+    std::vector<std::string> result;
+    result.reserve(methodPath.size());
+    for (auto const& [methodIdent, path] : methodPath)
+        result.emplace_back(methodIdent);
+    if (lazyPaths) {
+        auto lazyIds = lazyPaths->operationIds();
+        result.insert(result.end(), lazyIds.begin(), lazyIds.end());
+    }
+    return result;
+}
+
 OpenAPIConfig::SecurityScheme::SecurityScheme(std::string id) :
     id(std::move(id))
 {}
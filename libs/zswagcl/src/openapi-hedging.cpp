@@ -0,0 +1,35 @@
+#include "private/openapi-hedging.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace zswagcl
+{
+
+void LatencyTracker::record(std::chrono::microseconds latency)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples_[next_] = latency.count();
+    next_ = (next_ + 1) % WINDOW;
+    count_ = std::min(count_ + 1, WINDOW);
+}
+
+std::optional<std::chrono::microseconds> LatencyTracker::percentile(double percent) const
+{
+    std::array<std::chrono::microseconds::rep, WINDOW> samples;
+    std::size_t count;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_ < MIN_SAMPLES)
+            return {};
+        count = count_;
+        std::copy(samples_.begin(), samples_.begin() + count, samples.begin());
+    }
+
+    auto rank = static_cast<std::size_t>(std::ceil(std::clamp(percent, 0., 100.) / 100. * count));
+    auto nth = samples.begin() + (rank > 0 ? rank - 1 : 0);
+    std::nth_element(samples.begin(), nth, samples.begin() + count);
+    return std::chrono::microseconds(*nth);
+}
+
+}
@@ -0,0 +1,56 @@
+#include "private/openapi-memo.hpp"
+
+namespace zswagcl
+{
+
+Memo::Memo(std::size_t maxBytes)
+    : maxBytes_(maxBytes)
+{}
+
+std::shared_ptr<const std::string> Memo::get(Key const& key, Clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end())
+        return {};
+
+    auto entry = it->second;
+    if (now >= entry->expires) {
+        evict(entry);
+        return {};
+    }
+    lru_.splice(lru_.begin(), lru_, entry);
+    return entry->response;
+}
+
+void Memo::put(Key key, std::string response, Clock::duration ttl, Clock::time_point now)
+{
+    auto const bytes = key.operationId.size() + key.requestDigest.size() + response.size();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto it = index_.find(key); it != index_.end())
+        evict(it->second);
+    if (bytes > maxBytes_)
+        return;
+    while (bytes_ + bytes > maxBytes_)
+        evict(std::prev(lru_.end()));
+
+    lru_.push_front({std::move(key), std::make_shared<const std::string>(std::move(response)), now + ttl, bytes});
+    index_.emplace(lru_.front().key, lru_.begin());
+    bytes_ += bytes;
+}
+
+std::size_t Memo::bytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+void Memo::evict(std::list<Entry>::iterator it)
+{
+    bytes_ -= it->bytes;
+    index_.erase(it->key);
+    lru_.erase(it);
+}
+
+}
@@ -4,6 +4,9 @@
 
 #include <functional>
 #include <optional>
+#include <stdexcept>
+
+#include <zstd.h>
 
 using namespace std::string_literals;
 
@@ -12,6 +15,17 @@ namespace zswagcl
 namespace impl
 {
 
+static std::string zstdCompress(const std::uint8_t* ptr, std::size_t size)
+{
+    std::string result(ZSTD_compressBound(size), '\0');
+    auto compressedSize = ZSTD_compress(result.data(), result.size(), ptr, size, ZSTD_CLEVEL_DEFAULT);
+    if (ZSTD_isError(compressedSize))
+        throw std::runtime_error(ZSTD_getErrorName(compressedSize));
+
+    result.resize(compressedSize);
+    return result;
+}
+
 std::string formatBuffer(Format f, const std::uint8_t* ptr, std::size_t size)
 {
     static_assert(std::is_integral_v<unsigned char>);
@@ -25,6 +39,11 @@ std::string formatBuffer(Format f, const std::uint8_t* ptr, std::size_t size)
     case Format::Base64url:
         return base64url_encode(ptr, size);
 
+    case Format::ZstdBase64url: {
+        auto compressed = zstdCompress(ptr, size);
+        return base64url_encode(reinterpret_cast<const std::uint8_t*>(compressed.data()), compressed.size());
+    }
+
     case Format::Binary:
     case Format::String:
         return std::string(ptr, ptr + size);
@@ -49,11 +68,13 @@ struct Overloaded : _T...
 template <class... _T>
 Overloaded(_T...) -> Overloaded<_T...>;
 
+using Views = std::vector<std::string_view>;
+
 template <class _Result, class _Variant>
 _Result visitValue(const _Variant& v,
                    _Result defaultValue,
                    std::function<std::optional<_Result>(const std::string&)> single,
-                   std::function<std::optional<_Result>(const std::vector<std::string>&)> vector,
+                   std::function<std::optional<_Result>(const Views&)> vector,
                    std::function<std::optional<_Result>(const std::map<std::string, std::string>&)> map)
 {
     auto result = defaultValue;
@@ -64,18 +85,44 @@ _Result visitValue(const _Variant& v,
                 result = *res;
         },
         [&](const std::vector<std::string>& v) {
-            if (auto res = vector(v))
+            if (auto res = vector(Views(v.begin(), v.end())))
                 result = *res;
         },
         [&](const std::map<std::string, std::string>& v) {
             if (auto res = map(v))
                 result = *res;
+        },
+        [&](const impl::FormattedArray& v) {
+            Views views;
+            views.reserve(v.ends.size());
+            std::size_t begin = 0;
+            for (auto end : v.ends) {
+                views.emplace_back(std::string_view(v.values).substr(begin, end - begin));
+                begin = end;
+            }
+            if (auto res = vector(views))
+                result = *res;
         }
     }, v);
 
     return result;
 }
 
+std::string join(const Views& values, std::string_view separator, std::string prefix = {})
+{
+    auto size = prefix.size();
+    for (auto const& value : values)
+        size += value.size() + separator.size();
+    prefix.reserve(size);
+
+    for (auto it = values.begin(); it != values.end(); ++it) {
+        if (it != values.begin())
+            prefix += separator;
+        prefix += *it;
+    }
+    return prefix;
+}
+
 std::string joinMap(const std::map<std::string, std::string>& map,
                     const std::string& kvSeparator,
                     const std::string& pairSeparator)
@@ -98,7 +145,7 @@ std::string ParameterValue::bodyStr() const
         [&](const std::string& v) -> std::optional<std::string> {
             return v;
         },
-        [&](const std::vector<std::string>&) -> std::optional<std::string> {
+        [&](const Views&) -> std::optional<std::string> {
             throw std::runtime_error("Expected parameter-value of type string, got vector");
         },
         [&](const std::map<std::string, std::string>&) -> std::optional<std::string> {
@@ -121,18 +168,18 @@ std::string ParameterValue::pathStr(const OpenAPIConfig::Parameter& param) const
                 return {};
             }
         },
-        [&](const std::vector<std::string>& v) -> std::optional<std::string> {
+        [&](const Views& v) -> std::optional<std::string> {
             switch (param.style) {
             case Style::Simple:
-                return stx::join(v.begin(), v.end(), ",");
+                return join(v, ",");
             case Style::Label:
                 if (param.explode)
-                    return "."s + stx::join(v.begin(), v.end(), ".");
-                return "."s + stx::join(v.begin(), v.end(), ",");
+                    return join(v, ".", ".");
+                return join(v, ",", ".");
             case Style::Matrix:
                 if (param.explode)
-                    return ";"s + param.ident + "=" + stx::join(v.begin(), v.end(), ";"s + param.ident + "=");
-                return ";"s + param.ident + "=" + stx::join(v.begin(), v.end(), ",");
+                    return join(v, ";"s + param.ident + "=", ";"s + param.ident + "=");
+                return join(v, ",", ";"s + param.ident + "=");
             default:
                 return {};
             }
@@ -176,7 +223,7 @@ std::vector<std::pair<std::string, std::string>> ParameterValue::queryOrHeaderPa
                 return {};
             }
         },
-        [&](const std::vector<std::string>& v) -> std::optional<List> {
+        [&](const Views& v) -> std::optional<List> {
             switch (param.style) {
             case Style::Form:
                 /* Result example: ?id=1&id=2&id=3*/
@@ -184,12 +231,12 @@ std::vector<std::pair<std::string, std::string>> ParameterValue::queryOrHeaderPa
                     List tmp;
                     tmp.resize(v.size());
                     std::transform(v.begin(), v.end(), tmp.begin(), [&](const auto& v) {
-                        return std::make_pair(param.ident, v);
+                        return std::make_pair(param.ident, std::string(v));
                     });
 
                     return tmp;
                 }
-                return {{std::make_pair(param.ident, stx::join(v.begin(), v.end(), ","))}};
+                return {{std::make_pair(param.ident, join(v, ","))}};
             default:
                 return {};
             }
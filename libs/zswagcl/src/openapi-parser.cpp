@@ -1,4 +1,5 @@
 #include "private/openapi-parser.hpp"
+#include "private/openapi-snapshot.hpp"
 
 #include "httpcl/http-settings.hpp"
 #include "httpcl/uri.hpp"
@@ -7,22 +8,32 @@
 #include "stx/format.h"
 #include "httpcl/log.hpp"
 #include <httplib.h>
+#include <filesystem>
+#include <fstream>
 #include <future>
+#include <mutex>
+#include <random>
+#include <thread>
 
+#include <charconv>
+#include <cstring>
 #include <sstream>
 #include <string>
+#include <string_view>
 
 using namespace std::string_literals;
 
 namespace {
 
-struct YAMLScope {
+/**
+ * Position in the OpenAPI document, used for error messages.
+ */
+struct SpecScope {
     std::string name_;
-    YAMLScope const* parent_ = nullptr;
-    YAML::Node node_;
+    SpecScope const* parent_ = nullptr;
 
-    explicit YAMLScope(std::string name, YAML::Node const& n, YAMLScope const* parent = nullptr)
-        : name_(std::move(name)), node_(n), parent_(parent)
+    SpecScope(std::string name, SpecScope const* parent)
+        : name_(std::move(name)), parent_(parent)
     {}
 
     std::string str() const {
@@ -68,6 +79,14 @@ struct YAMLScope {
             str(),
             field));
     }
+};
+
+struct YAMLScope : SpecScope {
+    YAML::Node node_;
+
+    explicit YAMLScope(std::string name, YAML::Node const& n, SpecScope const* parent = nullptr)
+        : SpecScope(std::move(name), parent), node_(n)
+    {}
 
     operator bool() const {
         return node_.operator bool();
@@ -94,7 +113,7 @@ struct YAMLScope {
         return node_.as<T>();
     }
 
-    void forEach(std::function<void(YAMLScope const& child)> const& fun) {
+    void forEach(std::function<void(YAMLScope const& child)> const& fun) const {
         if (!node_ || !fun || !(node_.IsMap() || node_.IsSequence()))
             return;
         size_t i = 0;
@@ -108,14 +127,300 @@ struct YAMLScope {
     }
 };
 
+/**
+ * Thrown if a spec which looks like JSON is not valid JSON.
+ */
+struct JSONError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * Scope over the raw text of a JSON value. Children are located by
+ * scanning the text, so no document tree is built, and strings are only
+ * decoded when read.
+ */
+struct JSONScope : SpecScope {
+    std::string_view value_;
+
+    explicit JSONScope(std::string name, std::string_view value, SpecScope const* parent = nullptr)
+        : SpecScope(std::move(name), parent), value_(value)
+    {}
+
+    /** Check whether a document should be read as JSON. */
+    static bool sniff(std::string_view content) {
+        std::size_t pos = 0;
+        skipWhitespace(content, pos);
+        return pos < content.size() && content[pos] == '{';
+    }
+
+    /** Create the root scope for a JSON document. */
+    static JSONScope document(std::string_view content) {
+        std::size_t pos = 0;
+        skipWhitespace(content, pos);
+        auto start = pos;
+        skipValue(content, pos);
+        auto end = pos;
+        skipWhitespace(content, pos);
+        if (pos != content.size())
+            throw error(content, pos, "Unexpected trailing characters");
+        return JSONScope("", content.substr(start, end - start));
+    }
+
+    operator bool() const {
+        return !value_.empty();
+    }
+
+    JSONScope operator[] (char const* name) const {
+        std::string_view result;
+        forEachMember([&](std::string_view rawKey, std::string_view value) {
+            if (rawKey == name || (hasEscapes(rawKey) && decode(rawKey) == name)) {
+                result = value;
+                return false;
+            }
+            return true;
+        });
+        return JSONScope(name, result, this);
+    }
+
+    JSONScope operator[] (std::string const& name) const {
+        return operator[](name.c_str());
+    }
+
+    JSONScope mandatoryChild(std::string const& name) const {
+        auto result = operator[](name);
+        if (!result)
+            throw missingFieldError(name);
+        return result;
+    }
+
+    template<typename T>
+    T as() const {
+        if (value_.empty())
+            throw httpcl::logRuntimeError(stx::format("Missing value at {}.", str()));
+
+        if constexpr (std::is_same_v<T, bool>) {
+            if (value_ == "true")
+                return true;
+            if (value_ == "false")
+                return false;
+            throw valueError(std::string(value_), {"true", "false"});
+        }
+        else {
+            static_assert(std::is_same_v<T, std::string>);
+            if (value_.front() == '"')
+                return decode(value_.substr(1, value_.size() - 2));
+            return std::string(value_);
+        }
+    }
+
+    void forEach(std::function<void(JSONScope const& child)> const& fun) const {
+        if (value_.empty() || !fun)
+            return;
+        if (value_.front() == '{') {
+            forEachMember([&](std::string_view rawKey, std::string_view value) {
+                fun(JSONScope(decode(rawKey), value, this));
+                return true;
+            });
+        }
+        else if (value_.front() == '[') {
+            std::size_t pos = 1;
+            auto i = 0u;
+            skipWhitespace(value_, pos);
+            while (pos < value_.size() && value_[pos] != ']') {
+                auto start = pos;
+                skipValue(value_, pos);
+                fun(JSONScope(stx::to_string(i++), value_.substr(start, pos - start), this));
+                skipSeparator(value_, pos, ']');
+            }
+        }
+    }
+
+private:
+    /**
+     * Call fun(rawKey, value) for each member of an object value,
+     * until it returns false. rawKey is the undecoded key text.
+     */
+    template <class _Fun>
+    void forEachMember(_Fun&& fun) const {
+        if (value_.empty() || value_.front() != '{')
+            return;
+        std::size_t pos = 1;
+        skipWhitespace(value_, pos);
+        while (pos < value_.size() && value_[pos] != '}') {
+            if (value_[pos] != '"')
+                throw error(value_, pos, "Expected object key");
+            auto keyStart = pos;
+            skipString(value_, pos);
+            auto rawKey = value_.substr(keyStart + 1, pos - keyStart - 2);
+            skipWhitespace(value_, pos);
+            if (pos >= value_.size() || value_[pos] != ':')
+                throw error(value_, pos, "Expected `:`");
+            ++pos;
+            skipWhitespace(value_, pos);
+            auto valueStart = pos;
+            skipValue(value_, pos);
+            if (!fun(rawKey, value_.substr(valueStart, pos - valueStart)))
+                return;
+            skipSeparator(value_, pos, '}');
+        }
+    }
+
+    static JSONError error(std::string_view text, std::size_t pos, char const* what) {
+        return JSONError(stx::format("Invalid JSON: {} near `{}`.", what, text.substr(pos, 32)));
+    }
+
+    static void skipWhitespace(std::string_view text, std::size_t& pos) {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\r' || text[pos] == '\t'))
+            ++pos;
+    }
+
+    static void skipSeparator(std::string_view text, std::size_t& pos, char close) {
+        skipWhitespace(text, pos);
+        if (pos < text.size() && text[pos] == ',') {
+            ++pos;
+            skipWhitespace(text, pos);
+        }
+        else if (pos >= text.size() || text[pos] != close)
+            throw error(text, pos, "Expected `,`");
+    }
+
+    static void skipString(std::string_view text, std::size_t& pos) {
+        for (++pos; pos < text.size(); ++pos) {
+            if (text[pos] == '\\')
+                ++pos;
+            else if (text[pos] == '"') {
+                ++pos;
+                return;
+            }
+        }
+        throw error(text, pos, "Unterminated string");
+    }
+
+    static void skipValue(std::string_view text, std::size_t& pos) {
+        if (pos >= text.size())
+            throw error(text, pos, "Expected value");
+
+        switch (text[pos]) {
+        case '"':
+            skipString(text, pos);
+            return;
+        case '{':
+        case '[': {
+            auto depth = 0u;
+            do {
+                switch (text[pos]) {
+                case '"':
+                    skipString(text, pos);
+                    continue;
+                case '{':
+                case '[':
+                    ++depth;
+                    break;
+                case '}':
+                case ']':
+                    --depth;
+                    break;
+                }
+                ++pos;
+            } while (depth > 0 && pos < text.size());
+            if (depth > 0)
+                throw error(text, pos, "Unterminated object or array");
+            return;
+        }
+        default: {
+            auto start = pos;
+            while (pos < text.size() && !std::strchr(",}] \n\r\t", text[pos]))
+                ++pos;
+            if (pos == start)
+                throw error(text, pos, "Expected value");
+        }
+        }
+    }
+
+    static bool hasEscapes(std::string_view raw) {
+        return raw.find('\\') != std::string_view::npos;
+    }
+
+    /** Decode the text between the quotes of a JSON string. */
+    static std::string decode(std::string_view raw) {
+        if (!hasEscapes(raw))
+            return std::string(raw);
+
+        std::string result;
+        result.reserve(raw.size());
+        for (std::size_t pos = 0; pos < raw.size(); ++pos) {
+            if (raw[pos] != '\\') {
+                result.push_back(raw[pos]);
+                continue;
+            }
+            if (++pos >= raw.size())
+                throw error(raw, pos, "Invalid escape");
+            switch (raw[pos]) {
+            case 'b': result.push_back('\b'); break;
+            case 'f': result.push_back('\f'); break;
+            case 'n': result.push_back('\n'); break;
+            case 'r': result.push_back('\r'); break;
+            case 't': result.push_back('\t'); break;
+            case 'u': {
+                auto codePoint = readHex4(raw, pos);
+                if (codePoint >= 0xd800 && codePoint < 0xdc00 &&
+                    pos + 2 < raw.size() && raw[pos + 1] == '\\' && raw[pos + 2] == 'u')
+                {
+                    pos += 2;
+                    codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (readHex4(raw, pos) - 0xdc00);
+                }
+                appendUtf8(result, codePoint);
+                break;
+            }
+            default:
+                result.push_back(raw[pos]);
+            }
+        }
+        return result;
+    }
+
+    static std::uint32_t readHex4(std::string_view raw, std::size_t& pos) {
+        std::uint32_t value = 0;
+        if (pos + 4 >= raw.size())
+            throw error(raw, pos, "Invalid unicode escape");
+        auto result = std::from_chars(raw.data() + pos + 1, raw.data() + pos + 5, value, 16);
+        if (result.ptr != raw.data() + pos + 5)
+            throw error(raw, pos, "Invalid unicode escape");
+        pos += 4;
+        return value;
+    }
+
+    static void appendUtf8(std::string& out, std::uint32_t codePoint) {
+        if (codePoint < 0x80) {
+            out.push_back(static_cast<char>(codePoint));
+        }
+        else if (codePoint < 0x800) {
+            out.push_back(static_cast<char>(0xc0 | (codePoint >> 6)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+        }
+        else if (codePoint < 0x10000) {
+            out.push_back(static_cast<char>(0xe0 | (codePoint >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+        }
+        else {
+            out.push_back(static_cast<char>(0xf0 | (codePoint >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+        }
+    }
+};
+
 }
 
 namespace zswagcl
 {
 
-static auto parseParameterLocation(YAMLScope const& inNode)
+template <class Scope>
+static auto parseParameterLocation(Scope const& inNode)
 {
-    auto str = inNode.as<std::string>();
+    auto str = inNode.template as<std::string>();
     if (str == "query")
         return OpenAPIConfig::ParameterLocation::Query;
     else if (str == "path")
@@ -130,10 +435,11 @@ static auto parseParameterLocation(YAMLScope const& inNode)
  * JSON schema is _not_ supported. The only field that is respected is
  * the 'format' field.
  */
-static auto parseParameterSchema(YAMLScope const& schemaNode)
+template <class Scope>
+static auto parseParameterSchema(Scope const& schemaNode)
 {
     if (auto formatNode = schemaNode["format"]) {
-        auto format = formatNode.as<std::string>();
+        auto format = formatNode.template as<std::string>();
 
         if (format == "string")
             return OpenAPIConfig::Parameter::String;
@@ -141,6 +447,8 @@ static auto parseParameterSchema(YAMLScope const& schemaNode)
             return OpenAPIConfig::Parameter::Base64;
         if (format == "base64url")
             return OpenAPIConfig::Parameter::Base64url;
+        if (format == "x-zstd-base64url")
+            return OpenAPIConfig::Parameter::ZstdBase64url;
         if (format == "hex")
             return OpenAPIConfig::Parameter::Hex;
         if (format == "binary")
@@ -151,6 +459,7 @@ static auto parseParameterSchema(YAMLScope const& schemaNode)
             "byte",
             "base64",
             "base64url",
+            "x-zstd-base64url",
             "hex",
             "binary"
         });
@@ -165,7 +474,8 @@ static auto parseParameterSchema(YAMLScope const& schemaNode)
  *
  * Documentation: https://swagger.io/specification/#parameter-style
  */
-static void parseParameterStyle(YAMLScope const& styleNode,
+template <class Scope>
+static void parseParameterStyle(Scope const& styleNode,
                                 OpenAPIConfig::Parameter& parameter)
 {
     /* Set default style for parameter location */
@@ -185,7 +495,7 @@ static void parseParameterStyle(YAMLScope const& styleNode,
     }
 
     if (styleNode) {
-        const auto& styleStr = styleNode.as<std::string>();
+        const auto& styleStr = styleNode.template as<std::string>();
 
         if (styleStr == "matrix") {
             if (parameter.location != OpenAPIConfig::ParameterLocation::Path)
@@ -210,11 +520,12 @@ static void parseParameterStyle(YAMLScope const& styleNode,
     }
 }
 
-static void parseParameterExplode(YAMLScope const& explodeNode,
+template <class Scope>
+static void parseParameterExplode(Scope const& explodeNode,
                                   OpenAPIConfig::Parameter& parameter)
 {
     if (explodeNode) {
-        auto explodeBool = explodeNode.as<bool>();
+        auto explodeBool = explodeNode.template as<bool>();
 
         parameter.explode = explodeBool;
 
@@ -231,18 +542,19 @@ static void parseParameterExplode(YAMLScope const& explodeNode,
     }
 }
 
-static void parseMethodParameter(YAMLScope const& parameterNode,
+template <class Scope>
+static void parseMethodParameter(Scope const& parameterNode,
                                  OpenAPIConfig::Path& path)
 {
     auto nameNode = parameterNode.mandatoryChild("name");
-    auto& parameter = path.parameters[nameNode.as<std::string>()];
-    parameter.ident = nameNode.as<std::string>();
+    auto& parameter = path.parameters[nameNode.template as<std::string>()];
+    parameter.ident = nameNode.template as<std::string>();
 
     if (auto inNode = parameterNode["in"]) {
         parameter.location = parseParameterLocation(inNode);
     }
 
-    parameter.field = parameterNode.mandatoryChild(ZSERIO_REQUEST_PART).as<std::string>();
+    parameter.field = parameterNode.mandatoryChild(ZSERIO_REQUEST_PART).template as<std::string>();
 
     if (auto schemaNode = parameterNode["schema"]) {
         parameter.format = parseParameterSchema(schemaNode);
@@ -252,34 +564,34 @@ static void parseMethodParameter(YAMLScope const& parameterNode,
     parseParameterExplode(parameterNode["explode"], parameter);
 }
 
-static void parseMethodBody(YAMLScope const& methodNode,
+template <class Scope>
+static void parseMethodBody(Scope const& methodNode,
                             OpenAPIConfig::Path& path)
 {
     if (auto bodyNode = methodNode["requestBody"]) {
-        if (auto contentNode = bodyNode["content"]) {
-            for (auto contentTypeNode : contentNode.node_) {
-                auto contentType = contentTypeNode.first.as<std::string>();
-                if (contentType == ZSERIO_OBJECT_CONTENT_TYPE)
-                    path.bodyRequestObject = true;
-                else
-                    httpcl::log().debug("Ignoring request body MIME type '{}'.", contentType);
-            }
-        }
+        bodyNode["content"].forEach([&](auto const& contentTypeNode){
+            auto const& contentType = contentTypeNode.name_;
+            if (contentType == ZSERIO_OBJECT_CONTENT_TYPE)
+                path.bodyRequestObject = true;
+            else
+                httpcl::log().debug("Ignoring request body MIME type '{}'.", contentType);
+        });
     }
 }
 
+template <class Scope>
 static OpenAPIConfig::SecurityAlternatives parseSecurity(
-        YAMLScope const& securityNode,
+        Scope const& securityNode,
         OpenAPIConfig const& config)
 {
     OpenAPIConfig::SecurityAlternatives result;
 
-    for (auto const& alternative : securityNode.node_)
+    securityNode.forEach([&](auto const& alternative)
     {
         auto& newAlternativeAuthSet = result.emplace_back();
 
-        for (auto const& requiredScheme : alternative) {
-            auto schemeName = requiredScheme.first.as<std::string>();
+        alternative.forEach([&](auto const& requiredScheme) {
+            auto const& schemeName = requiredScheme.name_;
             auto scheme = config.securitySchemes.find(schemeName);
             if (scheme != config.securitySchemes.end())
                 newAlternativeAuthSet.emplace_back(scheme->second);
@@ -291,22 +603,48 @@ static OpenAPIConfig::SecurityAlternatives parseSecurity(
                                [](auto const& kv){return kv.first;});
                 throw securityNode.valueError(schemeName, schemeNames);
             }
-        }
+        });
 
         if (newAlternativeAuthSet.empty())
             throw securityNode.valueError("<empty>", {"<non-empty dictionary with scheme-name keys>"});
-    }
+    });
     return result;
 }
 
+template <class Scope>
+static httpcl::Timeouts parseTimeouts(Scope const& timeoutsNode)
+{
+    httpcl::Timeouts result;
+
+    timeoutsNode.forEach([&](auto const& timeoutNode) {
+        auto value = timeoutNode.template as<std::string>();
+        std::uint64_t ms = 0;
+        auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), ms);
+        if (ec != std::errc() || end != value.data() + value.size())
+            throw timeoutNode.valueError(value, {"<timeout in milliseconds>"});
+
+        auto const& name = timeoutNode.name_;
+        if (name == "connect")
+            result.connect = std::chrono::milliseconds(ms);
+        else if (name == "first-byte")
+            result.firstByte = std::chrono::milliseconds(ms);
+        else if (name == "total")
+            result.total = std::chrono::milliseconds(ms);
+        else
+            throw timeoutsNode.valueError(name, {"connect", "first-byte", "total"});
+    });
+    return result;
+}
+
+template <class Scope>
 static void parseMethod(const std::string& method,
-                        const YAMLScope& pathNode,
+                        const Scope& pathNode,
                         OpenAPIConfig& config)
 {
     if (auto methodNode = pathNode[method]) {
         auto opIdNode = methodNode.mandatoryChild("operationId");
 
-        auto& path = config.methodPath[opIdNode.as<std::string>()];
+        auto& path = config.methodPath[opIdNode.template as<std::string>()];
         path.path = pathNode.name_;
         path.httpMethod = method;
         std::transform(path.httpMethod.begin(),
@@ -322,21 +660,40 @@ static void parseMethod(const std::string& method,
             path.security = parseSecurity(securityNode, config);
 
         parseMethodBody(methodNode, path);
+
+        if (auto bodyFallbackNode = methodNode[ZSWAG_BODY_FALLBACK])
+            path.bodyFallback = bodyFallbackNode.template as<std::string>();
+
+        if (auto timeoutsNode = methodNode[ZSWAG_TIMEOUTS])
+            path.timeouts = parseTimeouts(timeoutsNode);
+
+        if (auto idempotentNode = methodNode[ZSWAG_IDEMPOTENT])
+            path.idempotent = idempotentNode.template as<bool>();
+
+        if (auto cacheNode = methodNode[ZSWAG_CACHE]) {
+            auto value = cacheNode.template as<std::string>();
+            std::uint64_t ms = 0;
+            auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), ms);
+            if (ec != std::errc() || end != value.data() + value.size())
+                throw cacheNode.valueError(value, {"<ttl in milliseconds>"});
+            path.cacheTtl = std::chrono::milliseconds(ms);
+        }
     }
 }
 
+template <class Scope>
 static void parseSecurityScheme(
-    const YAMLScope& schemeNode,
+    const Scope& schemeNode,
     OpenAPIConfig& config)
 {
     auto& name = schemeNode.name_;
     OpenAPIConfig::SecuritySchemePtr newScheme;
     auto schemeTypeNode = schemeNode.mandatoryChild("type");
-    auto schemeType = schemeTypeNode.as<std::string>();
+    auto schemeType = schemeTypeNode.template as<std::string>();
 
     if (schemeType == "http") {
         auto schemeHttpTypeNode = schemeNode.mandatoryChild("scheme");
-        auto schemeHttpType = schemeHttpTypeNode.as<std::string>();
+        auto schemeHttpType = schemeHttpTypeNode.template as<std::string>();
         if (schemeHttpType == "basic")
             newScheme = std::make_shared<OpenAPIConfig::BasicAuth>(name);
         else if (schemeHttpType == "bearer")
@@ -346,9 +703,9 @@ static void parseSecurityScheme(
     }
     else if (schemeType == "apiKey") {
         auto keyLocationNode = schemeNode.mandatoryChild("in");
-        auto keyLocationString = keyLocationNode.as<std::string>();
+        auto keyLocationString = keyLocationNode.template as<std::string>();
         auto parameterNameNode = schemeNode.mandatoryChild("name");
-        auto parameterName = parameterNameNode.as<std::string>();
+        auto parameterName = parameterNameNode.template as<std::string>();
 
         if (keyLocationString == "query")
             newScheme = std::make_shared<OpenAPIConfig::APIKeyAuth>(name, OpenAPIConfig::ParameterLocation::Query, parameterName);
@@ -365,40 +722,108 @@ static void parseSecurityScheme(
     config.securitySchemes[name] = newScheme;
 }
 
-static void parsePath(const YAMLScope& pathNode,
+static const char* supportedMethods[] = {
+    "get", "post", "put", "delete"
+};
+
+template <class Scope>
+static void parsePath(const Scope& pathNode,
                       OpenAPIConfig& config)
 {
-    static const char* supportedMethods[] = {
-        "get", "post", "put", "delete"
-    };
-
     for (const auto method : supportedMethods) {
         parseMethod(method, pathNode, config);
     }
 }
 
-static void parseServer(const YAMLScope& serverNode,
+/**
+ * Operation index for OpenAPIParseOptions::lazyOperations. Keeps the
+ * path scope of each operation, and parses it on first lookup. Only used
+ * with JSON scopes, which point into the shared spec text: YAML nodes
+ * would keep the whole document alive.
+ */
+template <class Scope>
+class LazyPaths : public OpenAPIConfig::LazyPaths
+{
+public:
+    explicit LazyPaths(std::shared_ptr<const std::string> content = {}) : content_(std::move(content)) {}
+
+    /** JSON text which JSON scopes point into. */
+    const std::shared_ptr<const std::string> content_;
+
+    /** Security schemes which operations may reference. */
+    std::map<std::string, OpenAPIConfig::SecuritySchemePtr> securitySchemes_;
+
+    void index(Scope const& pathNode)
+    {
+        for (const auto method : supportedMethods) {
+            if (auto methodNode = pathNode[method]) {
+                auto opId = methodNode.mandatoryChild("operationId").template as<std::string>();
+                auto& operation = operations_.insert_or_assign(opId, Operation{method, pathNode}).first->second;
+                operation.pathNode.parent_ = &pathsScope_;
+            }
+        }
+    }
+
+    std::vector<std::string> operationIds() const override
+    {
+        std::vector<std::string> result;
+        result.reserve(operations_.size());
+        for (auto const& [opId, operation] : operations_)
+            result.emplace_back(opId);
+        return result;
+    }
+
+    OpenAPIConfig::Path const* find(std::string const& methodIdent) const override
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto parsed = parsed_.find(methodIdent); parsed != parsed_.end())
+            return &parsed->second;
+
+        auto operation = operations_.find(methodIdent);
+        if (operation == operations_.end())
+            return nullptr;
+
+        OpenAPIConfig scratch;
+        scratch.securitySchemes = securitySchemes_;
+        parseMethod(operation->second.method, operation->second.pathNode, scratch);
+        return &parsed_.emplace(methodIdent, std::move(scratch.methodPath[methodIdent])).first->second;
+    }
+
+private:
+    struct Operation {
+        std::string method;
+        Scope pathNode;
+    };
+
+    SpecScope docScope_{"", nullptr};
+    SpecScope pathsScope_{"paths", &docScope_};
+    std::map<std::string, Operation> operations_;
+
+    mutable std::mutex mutex_;
+    mutable std::map<std::string, OpenAPIConfig::Path> parsed_;
+};
+
+template <class Scope>
+static void parseServer(const Scope& serverNode,
                         OpenAPIConfig& config)
 {
     if (auto urlNode = serverNode["url"]) {
-        auto urlStr = urlNode.as<std::string>();
+        auto urlStr = urlNode.template as<std::string>();
         if (urlStr.empty()) {
             // Ignore empty URLs.
         } else if (urlStr.front() == '/') {
-            config.uri = httpcl::URIComponents::fromStrPath(urlStr);
+            config.servers.push_back(httpcl::URIComponents::fromStrPath(urlStr));
         } else {
-            config.uri = httpcl::URIComponents::fromStrRfc3986(urlStr);
+            config.servers.push_back(httpcl::URIComponents::fromStrRfc3986(urlStr));
         }
     }
 }
 
-OpenAPIConfig parseOpenAPIConfig(std::istream& ss)
+template <class Scope>
+static OpenAPIConfig parseDocument(Scope const& docScope,
+                                   std::shared_ptr<LazyPaths<Scope>> lazyPaths = {})
 {
     OpenAPIConfig config;
-    config.content = std::string(std::istreambuf_iterator<char>(ss), {});
-
-    auto doc = YAML::Load(config.content);
-    YAMLScope docScope{"", doc};
     docScope["servers"].forEach([&](auto const& serverNode){
         try { parseServer(serverNode, config); }
         catch (const httpcl::URIError& e) {
@@ -406,6 +831,8 @@ OpenAPIConfig parseOpenAPIConfig(std::istream& ss)
                 stx::format("OpenAPI spec contains invalid server entry:\n    {}", e.what()));
         }
     });
+    if (!config.servers.empty())
+        config.uri = config.servers.front();
 
     if (auto components = docScope["components"]) {
         components["securitySchemes"].forEach([&](auto const& scheme){
@@ -418,15 +845,190 @@ OpenAPIConfig parseOpenAPIConfig(std::istream& ss)
     }
 
     docScope.mandatoryChild("paths").forEach([&](auto const& path){
-        parsePath(path, config);
+        if (lazyPaths)
+            lazyPaths->index(path);
+        else
+            parsePath(path, config);
     });
 
+    if (lazyPaths) {
+        lazyPaths->securitySchemes_ = config.securitySchemes;
+        config.lazyPaths = std::move(lazyPaths);
+    }
+    return config;
+}
+
+OpenAPIConfig parseOpenAPIConfig(std::istream& ss, OpenAPIParseOptions const& options)
+{
+    auto content = std::make_shared<const std::string>(std::istreambuf_iterator<char>(ss), std::istreambuf_iterator<char>());
+
+    auto config = [&]() {
+        // JSON specs are read straight from the text, without building
+        // a YAML document. Anything which is not plain JSON goes to yaml-cpp.
+        if (JSONScope::sniff(*content)) {
+            try {
+                if (!options.lazyOperations)
+                    return parseDocument(JSONScope::document(*content));
+                // The operations point into the text, which is shared with the config.
+                auto lazyPaths = std::make_shared<LazyPaths<JSONScope>>(content);
+                return parseDocument(JSONScope::document(*lazyPaths->content_), lazyPaths);
+            }
+            catch (JSONError const& e) {
+                httpcl::log().debug("Parsing spec as YAML: {}", e.what());
+            }
+        }
+        // yaml-cpp always loads the whole document, so YAML specs are
+        // parsed eagerly, also if lazy operations were requested.
+        if (options.lazyOperations)
+            httpcl::log().debug("Lazy operation parsing needs a JSON spec, parsing all operations.");
+        return parseDocument(YAMLScope("", YAML::Load(*content)));
+    }();
+
+    config.contentHash = openAPIContentHash(*content);
+    if (options.retainContent)
+        config.content = std::move(content);
     return config;
 }
 
+namespace
+{
+
+/**
+ * On-disk cache of fetched OpenAPI specs, enabled by HTTP_SPEC_CACHE_DIR.
+ * Per spec URL, it stores a binary config snapshot and a YAML file with the
+ * ETag/Last-Modified validators of the response. The YAML file also holds
+ * the content hash of its snapshot, so a snapshot which was replaced by
+ * another writer is not used with the wrong validators.
+ *
+ * For lazily parsed operations, the spec text is stored instead of a
+ * snapshot, as writing a snapshot would parse all operations. Loading
+ * then only indexes the operations again.
+ */
+struct SpecCache
+{
+    std::filesystem::path entryPath_; // Snapshot, or spec text if lazy
+    std::filesystem::path metaPath_;
+    OpenAPIParseOptions options_;
+    std::string url_;
+    std::optional<std::uint64_t> contentHash_;
+    std::optional<std::string> etag_;
+    std::optional<std::string> lastModified_;
+    bool staleIfError_ = false;
+    bool hasEntry_ = false;
+
+    static std::optional<SpecCache> forUrl(const std::string& url, OpenAPIParseOptions const& options)
+    {
+        auto cacheDir = std::getenv("HTTP_SPEC_CACHE_DIR");
+        if (!cacheDir || !*cacheDir)
+            return {};
+
+        SpecCache cache;
+        auto key = stx::format("{:016x}", openAPIContentHash(url));
+        cache.entryPath_ = std::filesystem::path(cacheDir) / (key + (options.lazyOperations ? ".spec" : ".oas"));
+        cache.metaPath_ = std::filesystem::path(cacheDir) / (key + ".yaml");
+        cache.options_ = options;
+        cache.url_ = url;
+        if (auto staleIfError = std::getenv("HTTP_SPEC_CACHE_STALE_IF_ERROR"))
+            cache.staleIfError_ = *staleIfError != '\0';
+
+        try {
+            if (std::filesystem::exists(cache.metaPath_) && std::filesystem::exists(cache.entryPath_)) {
+                auto meta = YAML::LoadFile(cache.metaPath_.string());
+                if (meta["url"] && meta["url"].as<std::string>() == url && meta["content-hash"]) {
+                    cache.contentHash_ = std::stoull(meta["content-hash"].as<std::string>(), nullptr, 16);
+                    if (auto etag = meta["etag"])
+                        cache.etag_ = etag.as<std::string>();
+                    if (auto lastModified = meta["last-modified"])
+                        cache.lastModified_ = lastModified.as<std::string>();
+                    cache.hasEntry_ = true;
+                }
+            }
+        }
+        catch (std::exception const& e) {
+            httpcl::log().warn("Ignoring unreadable spec cache entry for '{}': {}", url, e.what());
+        }
+
+        return cache;
+    }
+
+    /** Add If-None-Match/If-Modified-Since headers for the cached entry. */
+    void applyValidators(httpcl::Config& httpConfig) const
+    {
+        if (!hasEntry_)
+            return;
+        if (etag_)
+            httpConfig.headers.emplace("If-None-Match", *etag_);
+        if (lastModified_)
+            httpConfig.headers.emplace("If-Modified-Since", *lastModified_);
+    }
+
+    std::optional<OpenAPIConfig> load() const
+    {
+        if (!hasEntry_)
+            return {};
+        try {
+            if (!options_.lazyOperations)
+                return loadOpenAPIConfigSnapshot(entryPath_.string(), contentHash_, options_.retainContent);
+
+            std::ifstream specIn(entryPath_, std::ios::binary);
+            auto config = parseOpenAPIConfig(specIn, options_);
+            if (config.contentHash != contentHash_)
+                throw httpcl::logRuntimeError("Cached spec is outdated: Content hash mismatch.");
+            return config;
+        }
+        catch (std::exception const& e) {
+            httpcl::log().warn("Could not load cached spec for '{}': {}", url_, e.what());
+        }
+        return {};
+    }
+
+    void store(const OpenAPIConfig& config, const httpcl::IHttpClient::Result& res) const
+    {
+        try {
+            std::filesystem::create_directories(entryPath_.parent_path());
+
+            // Write to temporary files first, so concurrent readers never
+            // observe partially written entries. The names must be unique
+            // across the threads and processes which share the directory.
+            std::random_device random;
+            auto tmpSuffix = stx::format(".{:08x}{:08x}.tmp", random(), random());
+            auto entryTmp = entryPath_.string() + tmpSuffix;
+            auto metaTmp = metaPath_.string() + tmpSuffix;
+            {
+                std::ofstream entryOut(entryTmp, std::ios::binary);
+                if (options_.lazyOperations)
+                    entryOut << res.content;
+                else
+                    writeOpenAPIConfigSnapshot(config, entryOut);
+                if (!entryOut)
+                    throw std::runtime_error("Failed to write the cached spec.");
+            }
+            {
+                YAML::Node meta;
+                meta["url"] = url_;
+                meta["content-hash"] = stx::format("{:016x}", config.contentHash);
+                if (auto etag = res.header("ETag"))
+                    meta["etag"] = *etag;
+                if (auto lastModified = res.header("Last-Modified"))
+                    meta["last-modified"] = *lastModified;
+                std::ofstream metaOut(metaTmp);
+                metaOut << meta;
+            }
+            std::filesystem::rename(entryTmp, entryPath_);
+            std::filesystem::rename(metaTmp, metaPath_);
+        }
+        catch (std::exception const& e) {
+            httpcl::log().warn("Could not write spec cache entry for '{}': {}", url_, e.what());
+        }
+    }
+};
+
+}
+
 OpenAPIConfig fetchOpenAPIConfig(const std::string& url,
                                  httpcl::IHttpClient& client,
-                                 httpcl::Config httpConfig)
+                                 httpcl::Config httpConfig,
+                                 OpenAPIParseOptions const& options)
 {
     std::string debugContext = stx::format("[fetchOpenAPIConfig({})]", url);
 
@@ -437,32 +1039,86 @@ OpenAPIConfig fetchOpenAPIConfig(const std::string& url,
     // Load client config content.
     httpcl::log().debug("{} Parsing URL ...", debugContext);
     auto uriParts = httpcl::URIComponents::fromStrRfc3986(url);
-    httpcl::log().debug("{} Executing HTTP GET ...", debugContext);
-    auto resFuture = std::async(std::launch::async, [uriParts, httpConfig, &client] {
-        return client.get(uriParts.build(), httpConfig);
-    });
-    while (resFuture.wait_for(std::chrono::seconds{1}) != std::future_status::ready)
-        httpcl::log().debug("{} Waiting for response ...", debugContext);
-    auto res = resFuture.get();
-    httpcl::log().debug("{} Got HTTP status {}, {} bytes.", debugContext, res.status, res.content.size());
+    auto cache = SpecCache::forUrl(url, options);
+
+    // Relative server URLs refer to the host of the spec.
+    auto const completeServers = [&](OpenAPIConfig& config) {
+        auto const complete = [&](httpcl::URIComponents& server) {
+            if (server.scheme.empty())
+                server.scheme = uriParts.scheme;
+            if (server.host.empty()) {
+                server.host = uriParts.host;
+                server.port = uriParts.port;
+            }
+        };
+        complete(config.uri);
+        for (auto& server : config.servers)
+            complete(server);
+    };
+    auto get = [&](httpcl::Config const& getConfig) {
+        httpcl::log().debug("{} Executing HTTP GET ...", debugContext);
+        auto resFuture = std::async(std::launch::async, [uriParts, getConfig, &client] {
+            return client.get(uriParts.build(), getConfig);
+        });
+        while (resFuture.wait_for(std::chrono::seconds{1}) != std::future_status::ready)
+            httpcl::log().debug("{} Waiting for response ...", debugContext);
+
+        httpcl::IHttpClient::Result res{0, {}};
+        try {
+            res = resFuture.get();
+        }
+        catch (std::exception const& e) {
+            if (!cache || !cache->staleIfError_)
+                throw;
+            httpcl::log().warn("{} HTTP GET failed: {}", debugContext, e.what());
+        }
+        httpcl::log().debug("{} Got HTTP status {}, {} bytes.", debugContext, res.status, res.content.size());
+        return res;
+    };
+
+    // Revalidate a cached copy of the spec, if there is one.
+    auto res = [&] {
+        if (!cache)
+            return get(httpConfig);
+        auto conditionalConfig = httpConfig;
+        cache->applyValidators(conditionalConfig);
+        return get(conditionalConfig);
+    }();
+
+    if (res.status == 304 && cache) {
+        if (auto config = cache->load()) {
+            httpcl::log().debug("{} Spec not modified, using cached copy.", debugContext);
+            completeServers(*config);
+            return std::move(*config);
+        }
+        // The cached copy is unusable, fetch the spec again without validators.
+        res = get(httpConfig);
+    }
 
     // Parse loaded JSON
     if (res.status >= 200 && res.status < 300) {
         std::stringstream ss(res.content, std::ios_base::in);
 
         httpcl::log().debug("{} Parsing OpenAPI spec", debugContext);
-        auto config = parseOpenAPIConfig(ss);
-        if (config.uri.scheme.empty())
-            config.uri.scheme = uriParts.scheme;
-        if (config.uri.host.empty()) {
-            config.uri.host = uriParts.host;
-            config.uri.port = uriParts.port;
-        }
-        httpcl::log().debug("{} Parsed spec has {} methods.", debugContext, config.methodPath.size());
+        auto config = parseOpenAPIConfig(ss, options);
+        completeServers(config);
+        httpcl::log().debug("{} Parsed spec has {} methods.", debugContext, config.operationIds().size());
 
+        if (cache)
+            cache->store(config, res);
         return config;
     }
 
+    // Start with a stale copy of the spec if the server is unavailable.
+    if (cache && cache->staleIfError_ && (res.status == 0 || res.status >= 500)) {
+        if (auto config = cache->load()) {
+            httpcl::log().warn("{} Spec server unavailable (status {}), using cached copy.",
+                               debugContext, res.status);
+            completeServers(*config);
+            return std::move(*config);
+        }
+    }
+
     throw httpcl::IHttpClient::Error(
         res,
         stx::format(
@@ -0,0 +1,114 @@
+#include "private/openapi-registry.hpp"
+
+#include <fstream>
+
+#include "stx/format.h"
+#include "httpcl/log.hpp"
+
+namespace zswagcl
+{
+
+OpenAPIRegistry::OpenAPIRegistry(std::shared_ptr<httpcl::IHttpClient> client,
+                                 std::shared_ptr<const httpcl::Settings> settings)
+    : client_(std::move(client))
+    , settings_(std::move(settings))
+{
+    if (!client_)
+        client_ = std::make_shared<httpcl::HttpLibHttpClient>();
+    if (!settings_)
+        settings_ = std::make_shared<httpcl::Settings>();
+}
+
+OpenAPIRegistry& OpenAPIRegistry::instance()
+{
+    static OpenAPIRegistry registry;
+    return registry;
+}
+
+OpenAPIRegistry::ConfigPtr OpenAPIRegistry::fetch(std::string const& url,
+                                                  httpcl::Config const& httpConfig,
+                                                  OpenAPIParseOptions const& options)
+{
+    return getOrCreate({url, options.retainContent, options.lazyOperations}, [&] {
+        return fetchOpenAPIConfig(url, *client_, httpConfig, options);
+    });
+}
+
+OpenAPIRegistry::ConfigPtr OpenAPIRegistry::load(std::string const& path,
+                                                 OpenAPIParseOptions const& options)
+{
+    return getOrCreate({"file:" + path, options.retainContent, options.lazyOperations}, [&] {
+        std::ifstream fs(path);
+        if (!fs)
+            throw httpcl::logRuntimeError(stx::format("Could not open OpenAPI spec '{}'.", path));
+        return parseOpenAPIConfig(fs, options);
+    });
+}
+
+OpenAPIRegistry::ConfigPtr OpenAPIRegistry::add(OpenAPIConfig config)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return deduplicate(std::move(config));
+}
+
+std::shared_ptr<httpcl::IHttpClient> OpenAPIRegistry::httpClient() const
+{
+    return client_;
+}
+
+std::shared_ptr<const httpcl::Settings> OpenAPIRegistry::settings() const
+{
+    return settings_;
+}
+
+void OpenAPIRegistry::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    bySource_.clear();
+    byContent_.clear();
+}
+
+OpenAPIRegistry::ConfigPtr OpenAPIRegistry::getOrCreate(SourceKey key, std::function<OpenAPIConfig()> const& create)
+{
+    std::promise<ConfigPtr> promise;
+    std::shared_future<ConfigPtr> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = bySource_.find(key);
+        if (it != bySource_.end())
+            pending = it->second;
+        else
+            bySource_.emplace(key, promise.get_future().share());
+    }
+
+    // Another caller is already fetching/parsing the same spec.
+    if (pending.valid())
+        return pending.get();
+
+    try {
+        auto config = create();
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto result = deduplicate(std::move(config));
+        promise.set_value(result);
+        return result;
+    }
+    catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            bySource_.erase(key);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+OpenAPIRegistry::ConfigPtr OpenAPIRegistry::deduplicate(OpenAPIConfig config)
+{
+    ContentKey key{config.contentHash, config.uri.build(), bool(config.content), bool(config.lazyPaths)};
+    auto& entry = byContent_[key];
+    if (!entry)
+        entry = std::make_shared<const OpenAPIConfig>(std::move(config));
+    return entry;
+}
+
+}
@@ -0,0 +1,52 @@
+#include "private/openapi-retry.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace zswagcl
+{
+
+void RetryBudget::deposit(double tokens)
+{
+    auto milliTokens = std::llround(tokens * MILLI);
+    std::lock_guard<std::mutex> lock(mutex_);
+    balance_ = std::min<std::int64_t>(balance_ + milliTokens, MAX_BALANCE * MILLI);
+}
+
+bool RetryBudget::withdraw()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (balance_ < MILLI)
+        return false;
+    balance_ -= MILLI;
+    return true;
+}
+
+double RetryBudget::balance() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<double>(balance_) / MILLI;
+}
+
+bool isRetryableStatus(int status)
+{
+    return status == 0 || status == 502 || status == 503 || status == 504;
+}
+
+std::chrono::milliseconds retryBackoff(httpcl::RetryPolicy const& policy, unsigned retry)
+{
+    thread_local std::mt19937_64 random{std::random_device{}()};
+
+    auto limit = policy.initialBackoff;
+    for (auto i = 1u; i < retry && limit < policy.maxBackoff; ++i)
+        limit *= 2;
+    limit = std::min(limit, policy.maxBackoff);
+    if (limit.count() <= 0)
+        return std::chrono::milliseconds(0);
+
+    std::uniform_int_distribution<std::chrono::milliseconds::rep> jitter(0, limit.count());
+    return std::chrono::milliseconds(jitter(random));
+}
+
+}
@@ -0,0 +1,128 @@
+#include "private/openapi-single-flight.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+
+namespace zswagcl
+{
+
+namespace
+{
+
+bool isAborted(httpcl::Config const& config)
+{
+    return (config.cancellation && config.cancellation->cancelled()) ||
+        (config.deadline && std::chrono::steady_clock::now() >= *config.deadline);
+}
+
+}
+
+struct SingleFlight::Flight
+{
+    std::mutex mutex;
+    std::condition_variable done;
+    bool finished = false;
+    bool aborted = false;
+    std::shared_ptr<const Result> result;
+    std::exception_ptr error;
+};
+
+std::shared_ptr<const SingleFlight::Result> SingleFlight::run(
+    std::string const& key,
+    std::function<Result()> const& send,
+    httpcl::Config const& config,
+    bool& shared)
+{
+    std::shared_ptr<Flight> flight;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& entry = flights_[key];
+        if (!entry) {
+            entry = std::make_shared<Flight>();
+        }
+        else {
+            flight = entry;
+            ++waiting_;
+        }
+    }
+
+    if (!flight) {
+        // This is the first request with the key: Send it.
+        std::shared_ptr<const Result> result;
+        std::exception_ptr error;
+        try {
+            result = std::make_shared<const Result>(send());
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        std::shared_ptr<Flight> own;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = flights_.find(key);
+            own = std::move(it->second);
+            flights_.erase(it);
+        }
+        {
+            std::lock_guard<std::mutex> lock(own->mutex);
+            own->finished = true;
+            own->aborted = (error || result->status == 0) && isAborted(config);
+            own->result = result;
+            own->error = error;
+        }
+        own->done.notify_all();
+
+        shared = false;
+        if (error)
+            std::rethrow_exception(error);
+        return result;
+    }
+
+    // Wait for the request in flight, or for this request's cancellation.
+    auto subscription = httpcl::CancellationToken::subscribe(config.cancellation, [&flight] {
+        std::lock_guard<std::mutex> lock(flight->mutex);
+        flight->done.notify_all();
+    });
+
+    std::unique_lock<std::mutex> lock(flight->mutex);
+    auto const ready = [&] {
+        return flight->finished || (config.cancellation && config.cancellation->cancelled());
+    };
+    if (config.deadline)
+        flight->done.wait_until(lock, *config.deadline, ready);
+    else
+        flight->done.wait(lock, ready);
+    {
+        std::lock_guard<std::mutex> flightsLock(mutex_);
+        --waiting_;
+    }
+
+    if (!flight->finished)
+        return std::make_shared<const Result>(Result{0, {}});
+
+    if (flight->aborted) {
+        lock.unlock();
+        return run(key, send, config, shared);
+    }
+
+    shared = true;
+    if (flight->error)
+        std::rethrow_exception(flight->error);
+    return flight->result;
+}
+
+std::size_t SingleFlight::inFlight() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return flights_.size();
+}
+
+std::size_t SingleFlight::waiting() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return waiting_;
+}
+
+}
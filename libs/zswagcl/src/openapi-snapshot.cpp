@@ -0,0 +1,423 @@
+#include "private/openapi-snapshot.hpp"
+
+#include "httpcl/log.hpp"
+#include "stx/format.h"
+
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace zswagcl
+{
+
+const std::uint32_t OPENAPI_SNAPSHOT_VERSION = 5;
+
+namespace
+{
+
+constexpr std::string_view SNAPSHOT_MAGIC = "ZSWAGOAS";
+
+enum class SecuritySchemeKind : std::uint8_t {
+    Basic,
+    Bearer,
+    APIKey,
+    Cookie
+};
+
+/**
+ * Little-endian writer for the snapshot primitives.
+ */
+struct SnapshotWriter
+{
+    std::ostream& out_;
+
+    template <class _Int>
+    void integer(_Int value)
+    {
+        static_assert(std::is_integral_v<_Int>);
+        char bytes[sizeof(_Int)];
+        for (auto i = 0u; i < sizeof(_Int); ++i)
+            bytes[i] = static_cast<char>(static_cast<std::uint64_t>(value) >> (i * 8u));
+        out_.write(bytes, sizeof(_Int));
+    }
+
+    void string(std::string_view value)
+    {
+        integer(static_cast<std::uint32_t>(value.size()));
+        out_.write(value.data(), static_cast<std::streamsize>(value.size()));
+    }
+
+    void timeout(const std::optional<std::chrono::milliseconds>& value)
+    {
+        integer(static_cast<std::uint8_t>(value.has_value()));
+        if (value)
+            integer(static_cast<std::uint64_t>(value->count()));
+    }
+
+    void uri(const httpcl::URIComponents& value)
+    {
+        string(value.scheme);
+        string(value.host);
+        string(value.path);
+        integer(value.port);
+        string(value.query);
+        integer(static_cast<std::uint32_t>(value.queryVars.size()));
+        for (auto const& [key, var] : value.queryVars) {
+            string(key);
+            string(var);
+        }
+    }
+
+    void security(const OpenAPIConfig::SecurityAlternatives& alternatives)
+    {
+        integer(static_cast<std::uint32_t>(alternatives.size()));
+        for (auto const& alternative : alternatives) {
+            integer(static_cast<std::uint32_t>(alternative.size()));
+            for (auto const& scheme : alternative)
+                string(scheme->id);
+        }
+    }
+
+    void scheme(const OpenAPIConfig::SecuritySchemePtr& scheme)
+    {
+        string(scheme->id);
+        if (std::dynamic_pointer_cast<OpenAPIConfig::BasicAuth>(scheme)) {
+            integer(static_cast<std::uint8_t>(SecuritySchemeKind::Basic));
+        }
+        else if (std::dynamic_pointer_cast<OpenAPIConfig::BearerAuth>(scheme)) {
+            integer(static_cast<std::uint8_t>(SecuritySchemeKind::Bearer));
+        }
+        else if (auto apiKey = std::dynamic_pointer_cast<OpenAPIConfig::APIKeyAuth>(scheme)) {
+            integer(static_cast<std::uint8_t>(SecuritySchemeKind::APIKey));
+            integer(static_cast<std::uint8_t>(apiKey->location));
+            string(apiKey->keyName);
+        }
+        else if (auto cookie = std::dynamic_pointer_cast<OpenAPIConfig::CookieAuth>(scheme)) {
+            integer(static_cast<std::uint8_t>(SecuritySchemeKind::Cookie));
+            string(cookie->cookieName);
+        }
+        else {
+            throw httpcl::logRuntimeError(stx::format(
+                "Cannot write security scheme '{}' to OpenAPI config snapshot.", scheme->id));
+        }
+    }
+};
+
+/**
+ * Bounds-checked little-endian reader for the snapshot primitives.
+ */
+struct SnapshotReader
+{
+    std::string_view data_;
+    const OpenAPIConfig& config_;
+
+    std::string_view take(std::size_t size)
+    {
+        if (size > data_.size())
+            throw httpcl::logRuntimeError("OpenAPI config snapshot is truncated.");
+        auto result = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return result;
+    }
+
+    template <class _Int>
+    _Int integer()
+    {
+        static_assert(std::is_integral_v<_Int>);
+        auto bytes = take(sizeof(_Int));
+        std::uint64_t value = 0;
+        for (auto i = 0u; i < sizeof(_Int); ++i)
+            value |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(bytes[i])) << (i * 8u);
+        return static_cast<_Int>(value);
+    }
+
+    template <class _Enum>
+    _Enum enumeration(_Enum last)
+    {
+        auto value = integer<std::uint8_t>();
+        if (value > static_cast<std::uint8_t>(last))
+            throw httpcl::logRuntimeError(stx::format(
+                "OpenAPI config snapshot contains invalid enum value {}.", value));
+        return static_cast<_Enum>(value);
+    }
+
+    bool boolean()
+    {
+        return integer<std::uint8_t>() != 0;
+    }
+
+    std::string string()
+    {
+        return std::string(take(integer<std::uint32_t>()));
+    }
+
+    std::optional<std::chrono::milliseconds> timeout()
+    {
+        if (!boolean())
+            return {};
+        return std::chrono::milliseconds(integer<std::uint64_t>());
+    }
+
+    httpcl::URIComponents uri()
+    {
+        httpcl::URIComponents result;
+        result.scheme = string();
+        result.host = string();
+        result.path = string();
+        result.port = integer<std::uint16_t>();
+        result.query = string();
+        for (auto n = integer<std::uint32_t>(); n > 0; --n) {
+            auto key = string();
+            result.queryVars.emplace(std::move(key), string());
+        }
+        return result;
+    }
+
+    OpenAPIConfig::SecurityAlternatives security()
+    {
+        OpenAPIConfig::SecurityAlternatives result(integer<std::uint32_t>());
+        for (auto& alternative : result) {
+            alternative.resize(integer<std::uint32_t>());
+            for (auto& scheme : alternative) {
+                auto id = string();
+                auto schemeIt = config_.securitySchemes.find(id);
+                if (schemeIt == config_.securitySchemes.end())
+                    throw httpcl::logRuntimeError(stx::format(
+                        "OpenAPI config snapshot references unknown security scheme '{}'.", id));
+                scheme = schemeIt->second;
+            }
+        }
+        return result;
+    }
+
+    OpenAPIConfig::SecuritySchemePtr scheme()
+    {
+        using Location = OpenAPIConfig::ParameterLocation;
+
+        auto id = string();
+        switch (enumeration(SecuritySchemeKind::Cookie)) {
+        case SecuritySchemeKind::Basic:
+            return std::make_shared<OpenAPIConfig::BasicAuth>(id);
+        case SecuritySchemeKind::Bearer:
+            return std::make_shared<OpenAPIConfig::BearerAuth>(id);
+        case SecuritySchemeKind::APIKey: {
+            auto location = enumeration(Location::Header);
+            return std::make_shared<OpenAPIConfig::APIKeyAuth>(id, location, string());
+        }
+        case SecuritySchemeKind::Cookie:
+            return std::make_shared<OpenAPIConfig::CookieAuth>(id, string());
+        }
+        return {};
+    }
+};
+
+}
+
+std::uint64_t openAPIContentHash(std::string_view content)
+{
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (auto c : content) {
+        hash ^= static_cast<std::uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+void writeOpenAPIConfigSnapshot(const OpenAPIConfig& config, std::ostream& out)
+{
+    SnapshotWriter w{out};
+
+    out.write(SNAPSHOT_MAGIC.data(), SNAPSHOT_MAGIC.size());
+    w.integer(OPENAPI_SNAPSHOT_VERSION);
+    w.integer(config.contentHash);
+
+    w.uri(config.uri);
+    w.integer(static_cast<std::uint32_t>(config.servers.size()));
+    for (auto const& server : config.servers)
+        w.uri(server);
+
+    w.integer(static_cast<std::uint32_t>(config.securitySchemes.size()));
+    for (auto const& [name, scheme] : config.securitySchemes) {
+        w.string(name);
+        w.scheme(scheme);
+    }
+    w.security(config.defaultSecurityScheme);
+
+    auto methodNames = config.operationIds();
+    w.integer(static_cast<std::uint32_t>(methodNames.size()));
+    for (auto const& methodName : methodNames) {
+        auto const& path = *config.findPath(methodName);
+        w.string(methodName);
+        w.string(path.path);
+        w.string(path.httpMethod);
+
+        w.integer(static_cast<std::uint32_t>(path.parameters.size()));
+        for (auto const& [paramName, param] : path.parameters) {
+            w.string(paramName);
+            w.integer(static_cast<std::uint8_t>(param.location));
+            w.string(param.ident);
+            w.string(param.field);
+            w.string(param.defaultValue);
+            w.integer(static_cast<std::uint8_t>(param.format));
+            w.integer(static_cast<std::uint8_t>(param.style));
+            w.integer(static_cast<std::uint8_t>(param.explode));
+        }
+
+        w.integer(static_cast<std::uint8_t>(path.bodyRequestObject));
+        w.integer(static_cast<std::uint8_t>(path.security.has_value()));
+        if (path.security)
+            w.security(*path.security);
+        w.integer(static_cast<std::uint8_t>(path.bodyFallback.has_value()));
+        if (path.bodyFallback)
+            w.string(*path.bodyFallback);
+        w.timeout(path.timeouts.connect);
+        w.timeout(path.timeouts.firstByte);
+        w.timeout(path.timeouts.total);
+        w.integer(static_cast<std::uint8_t>(path.idempotent.has_value()));
+        if (path.idempotent)
+            w.integer(static_cast<std::uint8_t>(*path.idempotent));
+        w.timeout(path.cacheTtl);
+    }
+
+    w.string(config.content ? std::string_view(*config.content) : std::string_view());
+
+    if (!out)
+        throw httpcl::logRuntimeError("Failed to write OpenAPI config snapshot.");
+}
+
+namespace
+{
+
+/**
+ * Read a snapshot, except for the YAML content, which is returned
+ * as a view into the snapshot instead.
+ */
+OpenAPIConfig readSnapshot(std::string_view snapshot,
+                           std::optional<std::uint64_t> expectedContentHash,
+                           std::string_view& content)
+{
+    using Parameter = OpenAPIConfig::Parameter;
+
+    OpenAPIConfig config;
+    SnapshotReader r{snapshot, config};
+
+    if (r.take(SNAPSHOT_MAGIC.size()) != SNAPSHOT_MAGIC)
+        throw httpcl::logRuntimeError("Not an OpenAPI config snapshot.");
+    if (auto version = r.integer<std::uint32_t>(); version != OPENAPI_SNAPSHOT_VERSION)
+        throw httpcl::logRuntimeError(stx::format(
+            "OpenAPI config snapshot has version {}, expected {}.", version, OPENAPI_SNAPSHOT_VERSION));
+    config.contentHash = r.integer<std::uint64_t>();
+    if (expectedContentHash && *expectedContentHash != config.contentHash)
+        throw httpcl::logRuntimeError("OpenAPI config snapshot is outdated: Content hash mismatch.");
+
+    config.uri = r.uri();
+    for (auto n = r.integer<std::uint32_t>(); n > 0; --n)
+        config.servers.push_back(r.uri());
+
+    for (auto n = r.integer<std::uint32_t>(); n > 0; --n) {
+        auto name = r.string();
+        config.securitySchemes.emplace(std::move(name), r.scheme());
+    }
+    config.defaultSecurityScheme = r.security();
+
+    for (auto n = r.integer<std::uint32_t>(); n > 0; --n) {
+        auto& path = config.methodPath[r.string()];
+        path.path = r.string();
+        path.httpMethod = r.string();
+
+        for (auto m = r.integer<std::uint32_t>(); m > 0; --m) {
+            auto& param = path.parameters[r.string()];
+            param.location = r.enumeration(OpenAPIConfig::ParameterLocation::Header);
+            param.ident = r.string();
+            param.field = r.string();
+            param.defaultValue = r.string();
+            param.format = r.enumeration(Parameter::Binary);
+            param.style = r.enumeration(Parameter::Matrix);
+            param.explode = r.boolean();
+        }
+
+        path.bodyRequestObject = r.boolean();
+        if (r.boolean())
+            path.security = r.security();
+        if (r.boolean())
+            path.bodyFallback = r.string();
+        path.timeouts.connect = r.timeout();
+        path.timeouts.firstByte = r.timeout();
+        path.timeouts.total = r.timeout();
+        if (r.boolean())
+            path.idempotent = r.boolean();
+        path.cacheTtl = r.timeout();
+    }
+
+    content = r.take(r.integer<std::uint32_t>());
+    return config;
+}
+
+}
+
+OpenAPIConfig readOpenAPIConfigSnapshot(std::string_view snapshot,
+                                        std::optional<std::uint64_t> expectedContentHash,
+                                        bool retainContent)
+{
+    std::string_view content;
+    auto config = readSnapshot(snapshot, expectedContentHash, content);
+    if (retainContent)
+        config.content = std::make_shared<const std::string>(content);
+    return config;
+}
+
+OpenAPIConfig loadOpenAPIConfigSnapshot(const std::string& path,
+                                        std::optional<std::uint64_t> expectedContentHash,
+                                        bool retainContent)
+{
+    httpcl::log().debug("Loading OpenAPI config snapshot '{}' ...", path);
+
+    // Read the file into one buffer, which becomes the retained content.
+    std::string data;
+#ifndef _WIN32
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw httpcl::logRuntimeError(stx::format("Could not open OpenAPI config snapshot '{}'.", path));
+
+    struct stat fileStat{};
+    auto ok = ::fstat(fd, &fileStat) == 0;
+    if (ok) {
+        data.resize(static_cast<std::size_t>(fileStat.st_size));
+        for (std::size_t offset = 0; ok && offset < data.size();) {
+            auto n = ::pread(fd, data.data() + offset, data.size() - offset, static_cast<off_t>(offset));
+            if (n > 0)
+                offset += static_cast<std::size_t>(n);
+            else if (n == 0 || errno != EINTR)
+                ok = false;
+        }
+    }
+    ::close(fd);
+    if (!ok)
+        throw httpcl::logRuntimeError(stx::format("Could not read OpenAPI config snapshot '{}'.", path));
+#else
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs)
+        throw httpcl::logRuntimeError(stx::format("Could not open OpenAPI config snapshot '{}'.", path));
+    data.assign(std::istreambuf_iterator<char>(ifs), {});
+#endif
+
+    std::string_view content;
+    auto config = readSnapshot(data, expectedContentHash, content);
+    if (retainContent) {
+        // The content is stored last, so only the front is dropped.
+        auto offset = static_cast<std::size_t>(content.data() - data.data());
+        auto size = content.size();
+        data.erase(0, offset);
+        data.resize(size);
+        config.content = std::make_shared<const std::string>(std::move(data));
+    }
+    return config;
+}
+
+}
@@ -232,6 +232,67 @@ TEST_CASE("HTTP-Service", "[oaclient]") {
         REQUIRE(postCalled);
     }
 
+    SECTION("Request Blob in Query and Body") {
+        auto postCalled = false;
+
+        /* Create request object */
+        auto request = service_client_test::Request(
+            "hello", 2, std::vector<std::string>{"a", "b"},
+            service_client_test::Flat("admin", "Alex"));
+        auto bitBuf = zserio::serialize(request);
+        std::string buffer(bitBuf.getBuffer(), bitBuf.getBuffer() + bitBuf.getByteSize());
+
+        /* Setup mock client */
+        auto client = std::make_unique<httpcl::MockHttpClient>();
+        client->postFun = [&](std::string_view uri,
+                              httpcl::OptionalBodyAndContentType const& body,
+                              httpcl::Config const& conf)
+        {
+            REQUIRE(uri == "https://my.server.com/api/blob?"
+                           "flat=" + stx::to_hex(buffer.end() - 11, buffer.end()) + "&"
+                           "whole=" + stx::to_hex(buffer.begin(), buffer.end()));
+            REQUIRE(body);
+            REQUIRE(body->body == buffer);
+
+            postCalled = true;
+            return httpcl::IHttpClient::Result{200, {}};
+        };
+
+        /* Fire */
+        auto config = makeConfig(R"json(
+            "/blob": {
+                "post": {
+                    "operationId": "blob",
+                    "parameters": [
+                        {
+                            "name": "whole",
+                            "in": "query",
+                            "schema": { "format": "hex" },
+                            "x-zserio-request-part": "*"
+                        }, {
+                            "name": "flat",
+                            "in": "query",
+                            "schema": { "format": "hex" },
+                            "x-zserio-request-part": "flat"
+                        }
+                    ],
+                    "requestBody": {
+                        "content": {
+                            "application/x-zserio-object": {
+                                "schema": { "type": "string" }
+                            }
+                        }
+                    }
+                }
+            }
+        )json");
+        auto service = OAClient(config, std::move(client));
+        auto response = service.callMethod("blob", zserio::ReflectableServiceData(request.reflectable()), nullptr);
+
+        /* Check result */
+        REQUIRE(postCalled);
+    }
+
     SECTION("Authorization Schemes")
     {
         /* Initialize environment */
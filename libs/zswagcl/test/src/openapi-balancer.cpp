@@ -0,0 +1,85 @@
+#include <catch2/catch_all.hpp>
+
+#include "zswagcl/private/openapi-balancer.hpp"
+
+using namespace zswagcl;
+using namespace std::chrono_literals;
+
+using Strategy = httpcl::LoadBalancingPolicy::Strategy;
+using Outcome = ServerBalancer::Outcome;
+
+TEST_CASE("Server balancer", "[zswagcl::openapi-balancer]") {
+    ServerBalancer balancer(3, 42);
+    httpcl::LoadBalancingPolicy policy;
+    std::vector<bool> none(3);
+    auto const now = ServerBalancer::Clock::now();
+
+    SECTION("Round robin rotates over all servers") {
+        for (auto expected : {0u, 1u, 2u, 0u}) {
+            auto server = balancer.pick(policy, none, now);
+            REQUIRE(server == expected);
+            balancer.release(policy, *server, Outcome::Success, 1ms, now);
+        }
+    }
+
+    SECTION("Tried servers are skipped") {
+        std::vector<bool> tried{true, false, true};
+        REQUIRE(balancer.pick(policy, tried, now) == 1u);
+        REQUIRE_FALSE(balancer.pick(policy, {true, true, true}, now));
+    }
+
+    SECTION("Least outstanding prefers idle servers") {
+        policy.strategy = Strategy::LeastOutstanding;
+        auto a = *balancer.pick(policy, none, now);
+        auto b = *balancer.pick(policy, none, now);
+        auto c = *balancer.pick(policy, none, now);
+        REQUIRE(a != b);
+        REQUIRE(b != c);
+        REQUIRE(a != c);
+
+        balancer.release(policy, b, Outcome::Success, 1ms, now);
+        REQUIRE(balancer.pick(policy, none, now) == b);
+        REQUIRE(balancer.stats(now)[b].outstanding == 1);
+    }
+
+    SECTION("Power of two choices prefers fast servers") {
+        policy.strategy = Strategy::PowerOfTwoChoices;
+        for (auto server = 0u; server < 3; ++server) {
+            balancer.pick(policy, {server != 0, server != 1, server != 2}, now);
+            balancer.release(policy, server, Outcome::Success, server == 2 ? 1ms : 100ms, now);
+        }
+
+        // The fast server wins every comparison it is part of.
+        std::vector<int> picks(3);
+        for (auto i = 0; i < 300; ++i) {
+            auto server = *balancer.pick(policy, none, now);
+            ++picks[server];
+            balancer.release(policy, server, Outcome::Ignored, 0ms, now);
+        }
+        REQUIRE(picks[2] > picks[0] + picks[1]);
+        REQUIRE(balancer.stats(now)[2].latency == std::chrono::microseconds(1000));
+    }
+
+    SECTION("Failing servers are ejected") {
+        policy.maxFailures = 2;
+        balancer.pick(policy, {false, true, true}, now);
+        REQUIRE_FALSE(balancer.release(policy, 0, Outcome::Failure, 1ms, now));
+        balancer.pick(policy, {false, true, true}, now);
+        REQUIRE(balancer.release(policy, 0, Outcome::Failure, 1ms, now));
+        REQUIRE(balancer.stats(now)[0].ejected);
+
+        for (auto i = 0; i < 4; ++i) {
+            auto server = balancer.pick(policy, none, now);
+            REQUIRE(server != 0u);
+            balancer.release(policy, *server, Outcome::Success, 1ms, now);
+        }
+
+        // Back after the ejection time, or if no other server is left.
+        REQUIRE(balancer.pick(policy, {false, true, true}, now) == 0u);
+        balancer.release(policy, 0, Outcome::Ignored, 0ms, now);
+        auto const later = now + policy.ejectionTime;
+        REQUIRE_FALSE(balancer.stats(later)[0].ejected);
+        REQUIRE(balancer.pick(policy, {false, true, true}, later) == 0u);
+        REQUIRE(balancer.release(policy, 0, Outcome::Failure, 1ms, later));
+    }
+}
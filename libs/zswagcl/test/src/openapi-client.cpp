@@ -0,0 +1,404 @@
+#include <catch2/catch_all.hpp>
+
+#include <sstream>
+#include <tuple>
+
+#include "zswagcl/private/openapi-client.hpp"
+
+using namespace zswagcl;
+
+namespace
+{
+
+auto makeConfig(std::string const& spec)
+{
+    std::istringstream ss(spec);
+    return parseOpenAPIConfig(ss);
+}
+
+const auto bodyFallbackSpec = R"yaml(
+openapi: 3.0.1
+servers:
+  - url: https://my.server.com/api
+paths:
+  /get:
+    get:
+      operationId: get
+      x-zswag-body-fallback: getViaBody
+      parameters:
+        - name: data
+          in: query
+          x-zserio-request-part: "*"
+          schema:
+            format: hex
+  /get/body:
+    post:
+      operationId: getViaBody
+      requestBody:
+        content:
+          application/x-zserio-object:
+            schema:
+              type: string
+)yaml";
+
+const auto timeoutsSpec = R"yaml(
+openapi: 3.0.1
+servers:
+  - url: https://my.server.com/api
+paths:
+  /post:
+    post:
+      operationId: post
+      x-zswag-timeouts:
+        connect: 250
+        first-byte: 1000
+        total: 5000
+)yaml";
+
+}
+
+TEST_CASE("Oversized URL body fallback", "[zswagcl::openapi-client]") {
+    auto config = makeConfig(bodyFallbackSpec);
+    REQUIRE(config.methodPath["get"].bodyFallback == "getViaBody");
+
+    auto getCalled = false;
+    auto postCalled = false;
+    auto client = std::make_unique<httpcl::MockHttpClient>();
+    client->getFun = [&](std::string_view uri) {
+        getCalled = true;
+        REQUIRE(uri == "https://my.server.com/api/get?data=0102");
+        return httpcl::IHttpClient::Result{200, {}};
+    };
+    client->postFun = [&](std::string_view uri,
+                          httpcl::OptionalBodyAndContentType const& body,
+                          httpcl::Config const& conf) {
+        postCalled = true;
+        REQUIRE(uri == "https://my.server.com/api/get/body");
+        REQUIRE(body);
+        REQUIRE(body->body == "\x01\x02");
+        return httpcl::IHttpClient::Result{200, {}};
+    };
+
+    OpenAPIClient oaClient(config, {}, std::move(client));
+    auto resolveRequest = [](std::string const&, std::string const& field, ParameterValueHelper& helper) {
+        REQUIRE(field == ZSERIO_REQUEST_PART_WHOLE);
+        return helper.binary(std::vector<uint8_t>{1, 2});
+    };
+
+    SECTION("Short URL uses the original operation") {
+        oaClient.call("get", resolveRequest);
+        REQUIRE(getCalled);
+        REQUIRE_FALSE(postCalled);
+    }
+
+    SECTION("Long URL uses the fallback operation") {
+        oaClient.maxUrlLength_ = 16;
+        oaClient.call("get", resolveRequest);
+        REQUIRE_FALSE(getCalled);
+        REQUIRE(postCalled);
+    }
+}
+
+TEST_CASE("Method handles", "[zswagcl::openapi-client]") {
+    auto lazy = GENERATE(false, true);
+    std::istringstream ss(bodyFallbackSpec);
+    auto config = parseOpenAPIConfig(ss, {true, lazy});
+
+    std::vector<std::string> calledUris;
+    auto client = std::make_unique<httpcl::MockHttpClient>();
+    client->postFun = [&](std::string_view uri, httpcl::OptionalBodyAndContentType const&, httpcl::Config const&) {
+        calledUris.emplace_back(uri);
+        return httpcl::IHttpClient::Result{200, {}};
+    };
+
+    OpenAPIClient oaClient(config, {}, std::move(client));
+    auto resolveRequest = [](std::string const&, std::string const&, ParameterValueHelper& helper) {
+        return helper.binary(std::vector<uint8_t>{1, 2});
+    };
+
+    REQUIRE_FALSE(oaClient.resolveMethod("unknown"));
+    REQUIRE_FALSE(oaClient.resolveMethod("getViaBod"));
+    REQUIRE_THROWS(oaClient.call("unknown", resolveRequest));
+    REQUIRE_THROWS(oaClient.call(OpenAPIClient::MethodHandle{}, resolveRequest));
+
+    auto getViaBody = oaClient.resolveMethod(std::string_view("getViaBody!").substr(0, 10));
+    REQUIRE(getViaBody);
+    REQUIRE(oaClient.resolveMethod("get").index != getViaBody.index);
+
+    oaClient.call(getViaBody, resolveRequest);
+    oaClient.call(getViaBody, resolveRequest);
+    REQUIRE(calledUris == std::vector<std::string>(2, "https://my.server.com/api/get/body"));
+
+    // Clients of a shared config share the method table, also after the first one is gone.
+    auto sharedConfig = std::make_shared<const OpenAPIConfig>(config);
+    auto sharedTransport = std::make_shared<httpcl::MockHttpClient>();
+    sharedTransport->postFun = [&](std::string_view uri, httpcl::OptionalBodyAndContentType const&, httpcl::Config const&) {
+        calledUris.emplace_back(uri);
+        return httpcl::IHttpClient::Result{200, {}};
+    };
+    auto first = std::make_unique<OpenAPIClient>(sharedConfig, httpcl::Config{}, sharedTransport);
+    auto handle = first->resolveMethod("getViaBody");
+    first->call(handle, resolveRequest);
+    first.reset();
+    OpenAPIClient second(sharedConfig, {}, sharedTransport);
+    REQUIRE(second.resolveMethod("getViaBody").index == handle.index);
+    second.call(handle, resolveRequest);
+    REQUIRE(calledUris.size() == 4);
+}
+
+TEST_CASE("Warmup", "[zswagcl::openapi-client]") {
+    auto lazy = GENERATE(false, true);
+    std::istringstream ss(R"yaml(
+openapi: 3.0.1
+servers:
+  - url: http://localhost:8080/api
+paths:
+  /a:
+    get:
+      operationId: a
+  /b:
+    get:
+      operationId: b
+)yaml");
+    auto config = parseOpenAPIConfig(ss, {true, lazy});
+
+    std::string preconnectUri;
+    auto client = std::make_unique<httpcl::MockHttpClient>();
+    client->preconnectFun = [&](std::string_view uri, std::size_t connections) {
+        preconnectUri = uri;
+        return connections;
+    };
+
+    OpenAPIClient oaClient(config, {}, std::move(client));
+    auto report = oaClient.warmup(3);
+    REQUIRE(preconnectUri == "http://localhost:8080/api");
+    REQUIRE(report.connections == 3);
+    REQUIRE(report.methods == 2);
+    REQUIRE(report.total >= report.connect);
+    REQUIRE(report.total >= report.plans);
+}
+
+TEST_CASE("Multiple servers", "[zswagcl::openapi-client]") {
+    std::istringstream ss(R"yaml(
+openapi: 3.0.1
+servers:
+  - url: https://a.server.com/api
+  - url: https://b.server.com/api
+paths:
+  /get:
+    get:
+      operationId: get
+  /post:
+    post:
+      operationId: post
+)yaml");
+    auto config = parseOpenAPIConfig(ss);
+    REQUIRE(config.servers.size() == 2);
+    REQUIRE(config.uri.build() == "https://a.server.com/api");
+
+    std::vector<std::string> calledUris;
+    int status = 200;
+    auto client = std::make_unique<httpcl::MockHttpClient>();
+    client->getFun = [&](std::string_view uri) {
+        calledUris.emplace_back(uri);
+        return httpcl::IHttpClient::Result{uri.find("a.server") != std::string_view::npos ? status : 200, {}};
+    };
+    client->postFun = [&](std::string_view uri, httpcl::OptionalBodyAndContentType const&, httpcl::Config const&) {
+        calledUris.emplace_back(uri);
+        return httpcl::IHttpClient::Result{status, {}};
+    };
+
+    OpenAPIClient oaClient(config, {}, std::move(client));
+    auto resolveRequest = [](std::string const&, std::string const&, ParameterValueHelper& helper) {
+        return helper.binary(std::vector<uint8_t>{});
+    };
+
+    SECTION("Calls are balanced over the servers") {
+        oaClient.call("get", resolveRequest);
+        oaClient.call("get", resolveRequest);
+        REQUIRE(calledUris == std::vector<std::string>{
+            "https://a.server.com/api/get", "https://b.server.com/api/get"});
+    }
+
+    SECTION("Idempotent calls fail over to the next server") {
+        status = 503;
+        oaClient.call("get", resolveRequest);
+        REQUIRE(calledUris == std::vector<std::string>{
+            "https://a.server.com/api/get", "https://b.server.com/api/get"});
+        REQUIRE(oaClient.metrics().servers["https://a.server.com/api"].consecutiveFailures == 1);
+    }
+
+    SECTION("Other calls do not fail over") {
+        status = 503;
+        REQUIRE_THROWS_AS(oaClient.call("post", resolveRequest), httpcl::IHttpClient::Error);
+        REQUIRE(calledUris.size() == 1);
+    }
+
+    SECTION("Failing servers are ejected") {
+        status = 0;
+        for (auto i = 0; i < 3; ++i)
+            oaClient.call("get", resolveRequest);
+        REQUIRE(oaClient.metrics().servers["https://a.server.com/api"].ejected);
+
+        calledUris.clear();
+        oaClient.call("get", resolveRequest);
+        oaClient.call("get", resolveRequest);
+        REQUIRE(calledUris == std::vector<std::string>(2, "https://b.server.com/api/get"));
+    }
+}
+
+TEST_CASE("Server-scoped settings", "[zswagcl::openapi-client]") {
+    std::istringstream ss(R"yaml(
+openapi: 3.0.1
+servers:
+  - url: https://a.server.com/api
+  - url: https://b.server.com/api
+components:
+  securitySchemes:
+    key:
+      type: apiKey
+      in: header
+      name: X-API-Key
+security:
+  - key: []
+paths:
+  /post:
+    post:
+      operationId: post
+)yaml");
+    auto config = std::make_shared<const OpenAPIConfig>(parseOpenAPIConfig(ss));
+
+    auto settings = std::make_shared<httpcl::Settings>();
+    settings->settings["https://a\\.server\\.com/.*"].apiKey = "key-a";
+    settings->settings["https://a\\.server\\.com/.*"].headers.set("X-Server", "a");
+    settings->settings["https://b\\.server\\.com/.*"].apiKey = "key-b";
+    settings->settings["https://b\\.server\\.com/.*"].headers.set("X-Server", "b");
+
+    std::vector<std::tuple<std::string, std::string, std::string>> calls;
+    auto client = std::make_shared<httpcl::MockHttpClient>();
+    client->postFun = [&](std::string_view uri, httpcl::OptionalBodyAndContentType const&, httpcl::Config const& conf) {
+        calls.emplace_back(uri, conf.headers.find("X-Server")->second, conf.headers.find("X-API-Key")->second);
+        return httpcl::IHttpClient::Result{200, {}};
+    };
+
+    OpenAPIClient oaClient(config, {}, client, settings);
+    auto resolveRequest = [](std::string const&, std::string const&, ParameterValueHelper& helper) {
+        return helper.binary(std::vector<uint8_t>{});
+    };
+
+    oaClient.call("post", resolveRequest);
+    oaClient.call("post", resolveRequest);
+    REQUIRE(calls == std::vector<std::tuple<std::string, std::string, std::string>>{
+        {"https://a.server.com/api/post", "a", "key-a"},
+        {"https://b.server.com/api/post", "b", "key-b"}});
+
+    SECTION("Servers without the required credentials are not called") {
+        settings->settings.erase("https://b\\.server\\.com/.*");
+        calls.clear();
+        oaClient.call("post", resolveRequest);
+        REQUIRE_THROWS(oaClient.call("post", resolveRequest));
+        REQUIRE(calls.size() == 1);
+    }
+}
+
+TEST_CASE("Per-call deadlines and cancellation", "[zswagcl::openapi-client]") {
+    auto config = makeConfig(timeoutsSpec);
+    auto const& timeouts = config.methodPath["post"].timeouts;
+    REQUIRE(timeouts.connect == std::chrono::milliseconds(250));
+    REQUIRE(timeouts.firstByte == std::chrono::milliseconds(1000));
+    REQUIRE(timeouts.total == std::chrono::milliseconds(5000));
+
+    std::optional<httpcl::Config> sentConfig;
+    std::shared_ptr<httpcl::CancellationToken> cancelOnSend;
+    auto client = std::make_unique<httpcl::MockHttpClient>();
+    client->postFun = [&](std::string_view, httpcl::OptionalBodyAndContentType const&, httpcl::Config const& conf) {
+        sentConfig = conf;
+        if (cancelOnSend) {
+            cancelOnSend->cancel();
+            return httpcl::IHttpClient::Result{0, {}};
+        }
+        return httpcl::IHttpClient::Result{200, {}};
+    };
+
+    httpcl::Config httpConfig;
+    httpConfig.timeouts.firstByte = std::chrono::milliseconds(2000);
+    httpConfig.headers.insert({"X-Tenant", "a"});
+    OpenAPIClient oaClient(config, httpConfig, std::move(client));
+    auto noParameters = [](std::string const&, std::string const&, ParameterValueHelper& helper) {
+        return helper.value(0);
+    };
+    auto isCancelled = Catch::Matchers::Predicate<httpcl::IHttpClient::Error>(
+        [](httpcl::IHttpClient::Error const& e) {
+            return e.result.status == 0 && std::string(e.what()).find("cancelled") != std::string::npos;
+        });
+
+    SECTION("Spec timeouts are defaults") {
+        oaClient.call("post", noParameters);
+        REQUIRE(sentConfig->timeouts.connect == std::chrono::milliseconds(250));
+        REQUIRE(sentConfig->timeouts.firstByte == std::chrono::milliseconds(2000));
+        REQUIRE(sentConfig->timeouts.total == std::chrono::milliseconds(5000));
+        REQUIRE_FALSE(sentConfig->deadline);
+        REQUIRE_FALSE(sentConfig->cancellation);
+    }
+
+    SECTION("Call context takes precedence") {
+        CallContext context;
+        context.deadline = std::chrono::steady_clock::now() + std::chrono::minutes(1);
+        context.cancellation = std::make_shared<httpcl::CancellationToken>();
+        context.timeouts.total = std::chrono::milliseconds(100);
+        context.headers.insert({"x-tenant", "b"});
+
+        oaClient.call("post", noParameters, &context);
+        REQUIRE(sentConfig->timeouts.connect == std::chrono::milliseconds(250));
+        REQUIRE(sentConfig->timeouts.total == std::chrono::milliseconds(100));
+        REQUIRE(sentConfig->deadline == context.deadline);
+        REQUIRE(sentConfig->cancellation == context.cancellation);
+        REQUIRE(sentConfig->headers.count("X-Tenant") == 1);
+        REQUIRE(sentConfig->headers.find("X-Tenant")->second == "b");
+    }
+
+    SECTION("Cancelled and expired calls are not sent") {
+        CallContext cancelled;
+        cancelled.cancellation = std::make_shared<httpcl::CancellationToken>();
+        cancelled.cancellation->cancel();
+        REQUIRE_THROWS_MATCHES(oaClient.call("post", noParameters, &cancelled),
+                               httpcl::IHttpClient::Error, isCancelled);
+
+        CallContext expired;
+        expired.deadline = std::chrono::steady_clock::now();
+        REQUIRE_THROWS_AS(oaClient.call("post", noParameters, &expired), httpcl::IHttpClient::Error);
+        REQUIRE_FALSE(sentConfig);
+    }
+
+    SECTION("Aborted requests report the cancellation") {
+        CallContext context;
+        context.cancellation = std::make_shared<httpcl::CancellationToken>();
+        cancelOnSend = context.cancellation;
+        REQUIRE_THROWS_MATCHES(oaClient.call("post", noParameters, &context),
+                               httpcl::IHttpClient::Error, isCancelled);
+        REQUIRE(sentConfig);
+    }
+}
+
+TEST_CASE("Operation rate limits", "[zswagcl::openapi-client]") {
+    auto config = makeConfig(timeoutsSpec);
+
+    auto calls = 0;
+    auto client = std::make_unique<httpcl::MockHttpClient>();
+    client->postFun = [&](std::string_view, httpcl::OptionalBodyAndContentType const&, httpcl::Config const&) {
+        ++calls;
+        return httpcl::IHttpClient::Result{200, {}, {{"RateLimit-Remaining", "0"}, {"RateLimit-Reset", "60"}}};
+    };
+
+    httpcl::Config httpConfig;
+    httpConfig.operationRateLimits["post"] = httpcl::RateLimitPolicy{1000., 10, std::chrono::milliseconds(0)};
+    OpenAPIClient oaClient(config, httpConfig, std::move(client));
+    auto noParameters = [](std::string const&, std::string const&, ParameterValueHelper& helper) {
+        return helper.value(0);
+    };
+
+    // The exhausted quota of the response stops further calls.
+    oaClient.call("post", noParameters);
+    REQUIRE_THROWS_AS(oaClient.call("post", noParameters), httpcl::IHttpClient::RateLimitError);
+    REQUIRE(calls == 1);
+}
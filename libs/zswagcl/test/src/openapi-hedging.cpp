@@ -0,0 +1,134 @@
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+#include "zswagcl/private/openapi-client.hpp"
+#include "zswagcl/private/openapi-hedging.hpp"
+
+using namespace zswagcl;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+const auto hedgingSpec = R"yaml(
+openapi: 3.0.1
+servers:
+  - url: https://my.server.com/api
+paths:
+  /get:
+    get:
+      operationId: get
+  /post:
+    post:
+      operationId: post
+)yaml";
+
+/**
+ * Mock transport which passes the config of GET requests on.
+ */
+struct HedgingHttpClient : httpcl::MockHttpClient
+{
+    std::function<Result(httpcl::Config const&)> respond;
+
+    Result get(const std::string&, const httpcl::Config& config) override {
+        return respond(config);
+    }
+};
+
+}
+
+TEST_CASE("Latency percentiles", "[zswagcl::openapi-hedging]") {
+    LatencyTracker tracker;
+    for (auto i = 1u; i < LatencyTracker::MIN_SAMPLES; ++i)
+        tracker.record(std::chrono::microseconds(i));
+    REQUIRE_FALSE(tracker.percentile(95));
+
+    tracker.record(20us);
+    REQUIRE(tracker.percentile(95) == 19us);
+    REQUIRE(tracker.percentile(50) == 10us);
+    REQUIRE(tracker.percentile(100) == 20us);
+
+    // Old latencies are forgotten.
+    for (auto i = 0u; i < LatencyTracker::WINDOW; ++i)
+        tracker.record(1000us);
+    REQUIRE(tracker.percentile(0) == 1000us);
+}
+
+TEST_CASE("Hedged requests", "[zswagcl::openapi-hedging]") {
+    std::istringstream ss(hedgingSpec);
+    auto config = parseOpenAPIConfig(ss);
+
+    std::atomic<int> requests{0};
+    std::atomic<int> cancelled{0};
+    std::atomic<bool> slow{false};
+    auto transport = std::make_unique<HedgingHttpClient>();
+    transport->respond = [&](httpcl::Config const& conf) {
+        auto index = requests++;
+        // While slow, the first of two requests hangs until it is cancelled.
+        if (slow && index % 2 == 0) {
+            while (!conf.cancellation->cancelled())
+                std::this_thread::sleep_for(1ms);
+            ++cancelled;
+            return httpcl::IHttpClient::Result{0, {}};
+        }
+        return httpcl::IHttpClient::Result{200, std::to_string(index)};
+    };
+    transport->postFun = [mock = transport.get()](std::string_view, httpcl::OptionalBodyAndContentType const&, httpcl::Config const& conf) {
+        return mock->respond(conf);
+    };
+
+    httpcl::Config httpConfig;
+    httpConfig.hedging = httpcl::HedgingPolicy{95., 1ms, 0.05};
+    OpenAPIClient oaClient(config, httpConfig, std::move(transport));
+    auto noParameters = [](std::string const&, std::string const&, ParameterValueHelper& helper) {
+        return helper.value(0);
+    };
+
+    // Learn the latency of the operation.
+    for (auto i = 0u; i < LatencyTracker::MIN_SAMPLES; ++i)
+        oaClient.call("get", noParameters);
+    REQUIRE(oaClient.metrics().hedgesIssued == 0);
+
+    SECTION("Slow requests are hedged") {
+        slow = true;
+        requests = 0;
+        REQUIRE(oaClient.call("get", noParameters) == "1");
+        REQUIRE(requests == 2);
+        REQUIRE(cancelled == 1);
+        REQUIRE(oaClient.metrics().hedgesIssued == 1);
+        REQUIRE(oaClient.metrics().hedgesWon == 1);
+    }
+
+    SECTION("Hedging is limited by the budget") {
+        slow = true;
+        for (auto i = 0; i < 10; ++i) {
+            requests = 0;
+            oaClient.call("get", noParameters);
+        }
+        REQUIRE(oaClient.metrics().hedgesIssued == 10);
+
+        // The next call waits for the cancelled request, so cancel it.
+        auto token = std::make_shared<httpcl::CancellationToken>();
+        CallContext context;
+        context.cancellation = token;
+        std::thread canceller([&] {
+            std::this_thread::sleep_for(50ms);
+            token->cancel();
+        });
+        requests = 0;
+        REQUIRE_THROWS_AS(oaClient.call("get", noParameters, &context), httpcl::IHttpClient::Error);
+        canceller.join();
+        REQUIRE(requests == 1);
+        REQUIRE(oaClient.metrics().hedgesIssued == 10);
+    }
+
+    SECTION("Only GET requests are hedged") {
+        slow = true;
+        requests = 1;
+        REQUIRE(oaClient.call("post", noParameters) == "1");
+        REQUIRE(oaClient.metrics().hedgesIssued == 0);
+    }
+}
@@ -0,0 +1,126 @@
+#include <catch2/catch_all.hpp>
+
+#include <sstream>
+
+#include "zswagcl/private/openapi-client.hpp"
+#include "zswagcl/private/openapi-memo.hpp"
+
+using namespace zswagcl;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+const auto memoSpec = R"yaml(
+openapi: 3.0.1
+servers:
+  - url: https://my.server.com/api
+paths:
+  /lookup:
+    post:
+      operationId: lookup
+      x-zswag-cache: 60000
+      requestBody:
+        content:
+          application/x-zserio-object:
+            schema:
+              type: string
+  /update:
+    post:
+      operationId: update
+      requestBody:
+        content:
+          application/x-zserio-object:
+            schema:
+              type: string
+)yaml";
+
+}
+
+TEST_CASE("Memo", "[zswagcl::openapi-memo]") {
+    Memo memo(100);
+    auto const now = Memo::Clock::now();
+
+    SECTION("Responses expire after their TTL") {
+        memo.put({"op", 1}, "a", 10s, now);
+        REQUIRE(*memo.get({"op", 1}, now + 9s) == "a");
+        REQUIRE_FALSE(memo.get({"op", 2}, now));
+        REQUIRE_FALSE(memo.get({"other", 1}, now));
+        REQUIRE_FALSE(memo.get({"op", 1}, now + 10s));
+        REQUIRE(memo.bytes() == 0);
+    }
+
+    SECTION("Least recently used responses are evicted") {
+        memo.put({"op", 1}, std::string(30, 'a'), 10s, now);
+        memo.put({"op", 2}, std::string(30, 'b'), 10s, now);
+        memo.put({"op", 3}, std::string(30, 'c'), 10s, now);
+        REQUIRE(memo.get({"op", 1}, now));
+
+        memo.put({"op", 4}, std::string(30, 'd'), 10s, now);
+        REQUIRE(memo.bytes() <= 100);
+        REQUIRE_FALSE(memo.get({"op", 2}, now));
+        REQUIRE(memo.get({"op", 1}, now));
+        REQUIRE(memo.get({"op", 4}, now));
+
+        // Too large responses are not stored.
+        memo.put({"op", 5}, std::string(100, 'e'), 10s, now);
+        REQUIRE_FALSE(memo.get({"op", 5}, now));
+    }
+
+    SECTION("Requests with colliding hashes are told apart") {
+        memo.put({"op", 1, "digest-a"}, "a", 10s, now);
+        memo.put({"op", 1, "digest-b"}, "b", 10s, now);
+        REQUIRE(*memo.get({"op", 1, "digest-a"}, now) == "a");
+        REQUIRE(*memo.get({"op", 1, "digest-b"}, now) == "b");
+        REQUIRE_FALSE(memo.get({"op", 1}, now));
+
+        // The stored keys count towards the byte limit.
+        REQUIRE(memo.bytes() == 2 * (2 + 8 + 1));
+    }
+}
+
+TEST_CASE("Memoized operations", "[zswagcl::openapi-memo]") {
+    std::istringstream ss(memoSpec);
+    auto config = parseOpenAPIConfig(ss);
+    REQUIRE(config.methodPath["lookup"].cacheTtl == 60s);
+    REQUIRE_FALSE(config.methodPath["update"].cacheTtl);
+
+    std::vector<std::string> bodies;
+    auto client = std::make_unique<httpcl::MockHttpClient>();
+    client->postFun = [&](std::string_view, httpcl::OptionalBodyAndContentType const& body, httpcl::Config const&) {
+        bodies.emplace_back(body->body);
+        return httpcl::IHttpClient::Result{200, "response-" + body->body};
+    };
+
+    OpenAPIClient oaClient(config, {}, std::move(client));
+    auto request = [](std::uint8_t value) {
+        return [value](std::string const&, std::string const& field, ParameterValueHelper& helper) {
+            REQUIRE(field == ZSERIO_REQUEST_PART_WHOLE);
+            return helper.binary(std::vector<uint8_t>{value});
+        };
+    };
+
+    SECTION("Identical requests are answered from memory") {
+        REQUIRE(oaClient.call("lookup", request('a')) == "response-a");
+        REQUIRE(oaClient.call("lookup", request('a')) == "response-a");
+        REQUIRE(oaClient.call("lookup", request('b')) == "response-b");
+        REQUIRE(bodies == std::vector<std::string>{"a", "b"});
+        REQUIRE(oaClient.metrics().memoized == 1);
+    }
+
+    SECTION("Call context headers are part of the key") {
+        CallContext context;
+        context.headers.insert({"X-Tenant", "a"});
+        oaClient.call("lookup", request('a'));
+        oaClient.call("lookup", request('a'), &context);
+        oaClient.call("lookup", request('a'), &context);
+        REQUIRE(bodies.size() == 2);
+    }
+
+    SECTION("Other operations are not memoized") {
+        oaClient.call("update", request('a'));
+        oaClient.call("update", request('a'));
+        REQUIRE(bodies.size() == 2);
+        REQUIRE(oaClient.metrics().memoized == 0);
+    }
+}
@@ -116,6 +116,20 @@ TEST_CASE("openapi path parameters", "[zswagcl::open-api-format-helper]") {
                 REQUIRE(r == ".3,4,5");
         }
 
+        SECTION("Typed Array") {
+            auto explode = GENERATE(false, true);
+            INFO("Explode: " << explode);
+
+            auto r = pathStr(makeParameter("id", style, explode), [&](auto& helper) {
+                return helper.template array<int64_t>(std::vector<int32_t>{3, -4, 5});
+            });
+
+            if (explode)
+                REQUIRE(r == ".3.-4.5");
+            else
+                REQUIRE(r == ".3,-4,5");
+        }
+
         SECTION("Object") {
             SECTION("Normal") {
                 auto r = pathStr(makeParameter("id", style, false), [&](auto& helper) {
@@ -215,6 +229,22 @@ TEST_CASE("openapi path parameters - formats", "[zswagcl::open-api-format-helper
                 REQUIRE(r == "64,c8,12c");
             }
 
+            SECTION("Array (Negative)") {
+                auto r = pathStr(makeParameter("id", style, false, format), [&](auto& helper) {
+                    return helper.array(std::vector<int64_t>{-123, std::numeric_limits<int64_t>::min()});
+                });
+
+                REQUIRE(r == "-7b,-8000000000000000");
+            }
+
+            SECTION("Typed Array") {
+                auto r = pathStr(makeParameter("id", style, false, format), [&](auto& helper) {
+                    return helper.template array<uint64_t>(std::vector<uint8_t>{0, 255});
+                });
+
+                REQUIRE(r == "0,ff");
+            }
+
             SECTION("Object") {
                 auto r = pathStr(makeParameter("id", style, false, format), [&](auto& helper) {
                     return helper.object(object);
@@ -245,6 +275,47 @@ TEST_CASE("openapi path parameters - formats", "[zswagcl::open-api-format-helper
             }
         }
 
+        SECTION("Format ZstdBase64URL") {
+            auto format = Format::ZstdBase64url;
+
+            SECTION("Primitive Value (String)") {
+                auto r = pathStr(makeParameter("id", style, false, format), [&](auto& helper) {
+                    return helper.value("Hello World!");
+                });
+
+                REQUIRE(r == "KLUv_SAMYQAASGVsbG8gV29ybGQh");
+            }
+
+            SECTION("Binary (Compressible)") {
+                auto r = pathStr(makeParameter("id", style, false, format), [&](auto& helper) {
+                    return helper.binary(std::vector<uint8_t>(1024, 0x2a));
+                });
+
+                REQUIRE(r.size() < 32);
+            }
+        }
+
+        SECTION("Format Base64") {
+            auto format = Format::Base64;
+
+            SECTION("Typed Array") {
+                /* Raw zserio int32 arrays are widened like single int values. */
+                auto r = pathStr(makeParameter("id", style, false, format), [&](auto& helper) {
+                    return helper.template array<int64_t>(std::vector<int32_t>{1, -1});
+                });
+
+                REQUIRE(r == "AAAAAAAAAAE=,//////////8=");
+            }
+
+            SECTION("Bool Array") {
+                auto r = pathStr(makeParameter("id", style, false, format), [&](auto& helper) {
+                    return helper.array(std::vector<bool>{true, false});
+                });
+
+                REQUIRE(r == "AQ==,AA==");
+            }
+        }
+
         SECTION("Format Binary") {
             auto format = Format::Binary;
 
@@ -304,6 +375,13 @@ TEST_CASE("openapi query parameters", "[zswagcl::open-api-format-helper]") {
                     REQUIRE(v == stx::to_string(i++));
                 }
             }
+            SECTION("Typed Explode") {
+                auto r = queryOrHeaderPairs(makeParameter("id", style, true), [&](auto& helper) {
+                    return helper.template array<int64_t>(std::vector<int16_t>{3, 4});
+                });
+
+                REQUIRE(r == std::vector<std::pair<std::string, std::string>>{{"id", "3"}, {"id", "4"}});
+            }
         }
 
         SECTION("Object") {
@@ -0,0 +1,322 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+
+#include "zswagcl/private/openapi-parser.hpp"
+#include "zswagcl/private/openapi-snapshot.hpp"
+#include "stx/format.h"
+#include "yaml-cpp/yaml.h"
+
+using namespace zswagcl;
+
+namespace
+{
+
+const auto cachedSpec = R"yaml(
+openapi: 3.0.1
+servers:
+  - url: /api
+paths:
+  /get:
+    get:
+      operationId: get
+)yaml";
+
+const auto cachedJsonSpec = R"json({
+  "openapi": "3.0.1",
+  "servers": [{"url": "/api"}],
+  "paths": {"/get": {"get": {"operationId": "get"}}}
+})json";
+
+struct SpecHttpClient : public httpcl::IHttpClient
+{
+    std::function<Result(httpcl::Config const&)> getFun;
+
+    Result get(const std::string&, const httpcl::Config& config) override {
+        return getFun(config);
+    }
+    Result post(const std::string&, const httpcl::OptionalBodyAndContentType&, const httpcl::Config&) override {
+        return {0, {}};
+    }
+    Result put(const std::string&, const httpcl::OptionalBodyAndContentType&, const httpcl::Config&) override {
+        return {0, {}};
+    }
+    Result del(const std::string&, const httpcl::OptionalBodyAndContentType&, const httpcl::Config&) override {
+        return {0, {}};
+    }
+    Result patch(const std::string&, const httpcl::OptionalBodyAndContentType&, const httpcl::Config&) override {
+        return {0, {}};
+    }
+};
+
+/**
+ * Generate a JSON spec with the given number of GET operations,
+ * and a POST operation for each of them.
+ */
+std::string makeJsonSpec(int operations)
+{
+    std::string result = R"json({
+  "openapi": "3.0.1",
+  "servers": [{"url": "https://my.server.com/api"}],
+  "components": {
+    "securitySchemes": {
+      "basic": {"type": "http", "scheme": "basic"},
+      "key": {"type": "apiKey", "in": "header", "name": "X-API-Key"}
+    }
+  },
+  "security": [{"basic": []}],
+  "paths": {)json";
+
+    for (auto i = 0; i < operations; ++i) {
+        result += stx::format(R"json({}
+    "/op{}/{{id}}": {{
+      "get": {{
+        "summary": "Operation \"{}\" \u00e4",
+        "operationId": "op{}",
+        "x-zswag-body-fallback": "op{}ViaBody",
+        "security": [{{"key": [], "basic": []}}],
+        "parameters": [
+          {{"name": "id", "in": "path", "style": "label", "x-zserio-request-part": "id", "schema": {{"format": "string"}}}},
+          {{"name": "data", "in": "query", "explode": false, "x-zserio-request-part": "*", "schema": {{"format": "base64url"}}}},
+          {{"name": "X-Flag", "in": "header", "x-zserio-request-part": "flag", "schema": {{"format": "hex"}}}}
+        ],
+        "responses": {{"200": {{"description": "OK", "content": {{"application/x-zserio-object": {{"schema": {{"type": "string"}}}}}}}}}}
+      }},
+      "post": {{
+        "operationId": "op{}ViaBody",
+        "requestBody": {{"content": {{"application/x-zserio-object": {{"schema": {{"type": "string"}}}}}}}},
+        "responses": {{"200": {{"description": "OK"}}}}
+      }}
+    }})json", i > 0 ? "," : "", i, i, i, i, i);
+    }
+
+    return result + "\n  }\n}\n";
+}
+
+/**
+ * Parse a spec. A leading YAML comment forces the YAML parser for JSON specs.
+ */
+OpenAPIConfig parse(std::string const& spec, bool forceYaml = false, bool lazy = false)
+{
+    std::istringstream ss(forceYaml ? "# yaml\n" + spec : spec);
+    auto config = parseOpenAPIConfig(ss, {false, lazy});
+    config.contentHash = 0;
+    return config;
+}
+
+std::string snapshot(OpenAPIConfig const& config)
+{
+    std::ostringstream ss;
+    writeOpenAPIConfigSnapshot(config, ss);
+    return ss.str();
+}
+
+std::optional<std::string> header(httpcl::Config const& config, std::string const& name) {
+    auto it = config.headers.find(name);
+    if (it == config.headers.end())
+        return {};
+    return it->second;
+}
+
+}
+
+TEST_CASE("Cached OpenAPI spec fetching", "[zswagcl::openapi-parser]") {
+    auto cacheDir = std::filesystem::temp_directory_path() / "zswagcl-test-spec-cache";
+    std::filesystem::remove_all(cacheDir);
+    setenv("HTTP_SPEC_CACHE_DIR", cacheDir.string().c_str(), 1);
+    setenv("HTTP_SPEC_CACHE_STALE_IF_ERROR", "1", 1);
+
+    const auto url = std::string("https://my.server.com/openapi.yaml");
+    SpecHttpClient client;
+
+    // Requests are sent from another thread, so their
+    // validators are only checked on the test thread.
+    std::vector<std::optional<std::string>> validators;
+
+    // Initial fetch populates the cache.
+    client.getFun = [&](httpcl::Config const& config) {
+        validators.push_back(header(config, "If-None-Match"));
+        return httpcl::IHttpClient::Result{200, cachedSpec, {{"etag", "\"v1\""}}};
+    };
+    auto config = fetchOpenAPIConfig(url, client);
+    REQUIRE(config.methodPath.size() == 1);
+    REQUIRE(config.uri.build() == "https://my.server.com/api");
+    REQUIRE(validators == std::vector<std::optional<std::string>>{std::nullopt});
+    validators.clear();
+
+    SECTION("Not modified") {
+        client.getFun = [&](httpcl::Config const& config) {
+            validators.push_back(header(config, "If-None-Match"));
+            return httpcl::IHttpClient::Result{304, {}};
+        };
+        auto cached = fetchOpenAPIConfig(url, client);
+        REQUIRE(validators == std::vector<std::optional<std::string>>{"\"v1\""});
+        REQUIRE(cached.methodPath.count("get"));
+        REQUIRE(*cached.content == cachedSpec);
+        REQUIRE(cached.uri.build() == "https://my.server.com/api");
+    }
+
+    SECTION("Stale if error") {
+        client.getFun = [](httpcl::Config const&) {
+            return httpcl::IHttpClient::Result{503, {}};
+        };
+        REQUIRE(fetchOpenAPIConfig(url, client).methodPath.count("get"));
+
+        setenv("HTTP_SPEC_CACHE_STALE_IF_ERROR", "", 1);
+        REQUIRE_THROWS_AS(fetchOpenAPIConfig(url, client), httpcl::IHttpClient::Error);
+    }
+
+    SECTION("Missing snapshot is refetched") {
+        for (auto const& entry : std::filesystem::directory_iterator(cacheDir))
+            if (entry.path().extension() == ".oas")
+                std::filesystem::remove(entry.path());
+
+        client.getFun = [&](httpcl::Config const& config) {
+            validators.push_back(header(config, "If-None-Match"));
+            return httpcl::IHttpClient::Result{200, cachedSpec, {}};
+        };
+        REQUIRE(fetchOpenAPIConfig(url, client).methodPath.count("get"));
+        REQUIRE(validators == std::vector<std::optional<std::string>>{std::nullopt});
+    }
+
+    SECTION("Snapshot of another writer is refetched") {
+        for (auto const& entry : std::filesystem::directory_iterator(cacheDir)) {
+            if (entry.path().extension() == ".yaml") {
+                auto meta = YAML::LoadFile(entry.path().string());
+                meta["content-hash"] = "0123456789abcdef";
+                std::ofstream(entry.path()) << meta;
+            }
+        }
+
+        client.getFun = [&](httpcl::Config const& config) {
+            validators.push_back(header(config, "If-None-Match"));
+            if (validators.back())
+                return httpcl::IHttpClient::Result{304, {}};
+            return httpcl::IHttpClient::Result{200, cachedSpec, {}};
+        };
+        REQUIRE(fetchOpenAPIConfig(url, client).methodPath.count("get"));
+        REQUIRE(validators == std::vector<std::optional<std::string>>{"\"v1\"", std::nullopt});
+    }
+
+    SECTION("Lazy operations are cached as spec text") {
+        client.getFun = [&](httpcl::Config const& config) {
+            validators.push_back(header(config, "If-None-Match"));
+            return httpcl::IHttpClient::Result{200, cachedJsonSpec, {{"etag", "\"v2\""}}};
+        };
+        OpenAPIParseOptions lazy{false, true};
+        REQUIRE(fetchOpenAPIConfig(url, client, {}, lazy).methodPath.empty());
+        REQUIRE(validators == std::vector<std::optional<std::string>>{std::nullopt});
+
+        std::vector<std::filesystem::path> specs;
+        for (auto const& entry : std::filesystem::directory_iterator(cacheDir))
+            if (entry.path().extension() == ".spec")
+                specs.push_back(entry.path());
+        REQUIRE(specs.size() == 1);
+        std::ifstream specIn(specs[0], std::ios::binary);
+        REQUIRE(std::string(std::istreambuf_iterator<char>(specIn), {}) == cachedJsonSpec);
+
+        client.getFun = [&](httpcl::Config const& config) {
+            validators.push_back(header(config, "If-None-Match"));
+            return httpcl::IHttpClient::Result{304, {}};
+        };
+        auto cached = fetchOpenAPIConfig(url, client, {}, lazy);
+        REQUIRE(validators.back() == "\"v2\"");
+        REQUIRE(cached.methodPath.empty());
+        REQUIRE_FALSE(cached.content);
+        REQUIRE(cached.findPath("get"));
+        REQUIRE(cached.uri.build() == "https://my.server.com/api");
+    }
+
+    unsetenv("HTTP_SPEC_CACHE_DIR");
+    unsetenv("HTTP_SPEC_CACHE_STALE_IF_ERROR");
+    std::filesystem::remove_all(cacheDir);
+}
+
+TEST_CASE("JSON OpenAPI spec parsing", "[zswagcl::openapi-parser]") {
+    auto spec = makeJsonSpec(10);
+
+    SECTION("JSON and YAML parsers agree") {
+        auto config = parse(spec);
+        REQUIRE(config.methodPath.size() == 20);
+        REQUIRE(config.methodPath["op3"].parameters["id"].style == OpenAPIConfig::Parameter::Label);
+        REQUIRE(config.methodPath["op3"].bodyFallback == "op3ViaBody");
+        REQUIRE(config.methodPath["op3ViaBody"].bodyRequestObject);
+        REQUIRE(snapshot(config) == snapshot(parse(spec, true)));
+    }
+
+    SECTION("Escaped keys and values") {
+        auto config = parse(R"json({"paths": {"/a\u00e4": {"get": {"operationId": "get\"\ud83d\ude00"}}}})json");
+        REQUIRE(config.methodPath.count("get\"\xf0\x9f\x98\x80"));
+        REQUIRE(config.methodPath.begin()->second.path == "/a\xc3\xa4");
+    }
+
+    SECTION("YAML flow style falls back to YAML") {
+        auto config = parse("{paths: {/a: {get: {operationId: get}}}}");
+        REQUIRE(config.methodPath.count("get"));
+    }
+
+    SECTION("Schema errors are reported") {
+        REQUIRE_THROWS(parse(R"json({"paths": {"/a": {"get": {}}}})json"));
+    }
+}
+
+TEST_CASE("Lazy OpenAPI operation parsing", "[zswagcl::openapi-parser]") {
+    auto spec = makeJsonSpec(10);
+    auto config = parse(spec, false, true);
+
+    REQUIRE(config.methodPath.empty());
+    REQUIRE(config.operationIds().size() == 20);
+    REQUIRE(config.findPath("unknown") == nullptr);
+
+    SECTION("Operations are parsed on first use") {
+        auto path = config.findPath("op3");
+        REQUIRE(path);
+        REQUIRE(path == config.findPath("op3"));
+        REQUIRE(path->parameters.at("id").style == OpenAPIConfig::Parameter::Label);
+        REQUIRE(path->security->at(0).at(0) == config.securitySchemes["key"]);
+    }
+
+    SECTION("Concurrent lookups share one parse") {
+        std::vector<OpenAPIConfig::Path const*> found(8);
+        std::vector<std::thread> threads;
+        for (auto& result : found)
+            threads.emplace_back([&config, &result] { result = config.findPath("op7ViaBody"); });
+        for (auto& thread : threads)
+            thread.join();
+        REQUIRE(std::all_of(found.begin(), found.end(), [&](auto path) { return path && path == found[0]; }));
+    }
+
+    SECTION("Lazy and eager parsers agree") {
+        REQUIRE(snapshot(config) == snapshot(parse(spec)));
+    }
+
+    SECTION("Errors are reported on first use") {
+        auto invalid = parse(R"json({"paths": {"/a": {"get": {"operationId": "get", "parameters": [{"in": "query"}]}}}})json",
+                             false, true);
+        REQUIRE_THROWS(invalid.findPath("get"));
+    }
+
+    SECTION("YAML specs are parsed completely") {
+        auto yaml = parse(spec, true, true);
+        REQUIRE(yaml.methodPath.size() == 20);
+        REQUIRE(snapshot(yaml) == snapshot(parse(spec, true)));
+    }
+}
+
+TEST_CASE("OpenAPI spec parsing benchmark", "[.][benchmark]") {
+    auto spec = makeJsonSpec(1000);
+
+    BENCHMARK("JSON, 1000 operations") {
+        return parse(spec);
+    };
+
+    BENCHMARK("YAML, 1000 operations") {
+        return parse(spec, true);
+    };
+}
@@ -0,0 +1,113 @@
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <thread>
+
+#include "zswagcl/private/openapi-client.hpp"
+#include "zswagcl/private/openapi-registry.hpp"
+
+using namespace zswagcl;
+
+namespace
+{
+
+const auto registrySpec = R"yaml(
+openapi: 3.0.1
+servers:
+  - url: https://my.server.com/api
+paths:
+  /post:
+    post:
+      operationId: post
+)yaml";
+
+}
+
+TEST_CASE("Shared OpenAPI config registry", "[zswagcl::openapi-registry]") {
+    std::atomic<int> specFetches{0};
+    auto transport = std::make_shared<httpcl::MockHttpClient>();
+    transport->getFun = [&](std::string_view) {
+        ++specFetches;
+        return httpcl::IHttpClient::Result{200, registrySpec};
+    };
+
+    OpenAPIRegistry registry(transport);
+    REQUIRE(registry.httpClient() == transport);
+    REQUIRE(registry.settings());
+
+    SECTION("Specs are fetched once per URL") {
+        auto config = registry.fetch("https://my.server.com/openapi.yaml");
+        REQUIRE(config->findPath("post"));
+        REQUIRE(registry.fetch("https://my.server.com/openapi.yaml") == config);
+        REQUIRE(specFetches == 1);
+
+        // YAML specs are never parsed lazily, so they share the eager config.
+        REQUIRE(registry.fetch("https://my.server.com/openapi.yaml", {}, {true, true}) == config);
+        REQUIRE(specFetches == 2);
+
+        registry.clear();
+        REQUIRE(registry.fetch("https://my.server.com/openapi.yaml") != config);
+        REQUIRE(config->findPath("post"));
+    }
+
+    SECTION("Concurrent fetches share one request") {
+        std::vector<OpenAPIRegistry::ConfigPtr> configs(8);
+        std::vector<std::thread> threads;
+        for (auto& config : configs)
+            threads.emplace_back([&registry, &config] {
+                config = registry.fetch("https://my.server.com/openapi.yaml");
+            });
+        for (auto& thread : threads)
+            thread.join();
+        REQUIRE(specFetches == 1);
+        REQUIRE(std::all_of(configs.begin(), configs.end(), [&](auto const& c) { return c && c == configs[0]; }));
+    }
+
+    SECTION("Identical specs share one config") {
+        auto config = registry.fetch("https://my.server.com/openapi.yaml");
+        REQUIRE(registry.fetch("https://my.server.com/openapi.yaml?v=2") == config);
+        REQUIRE(specFetches == 2);
+
+        std::istringstream ss(registrySpec);
+        REQUIRE(registry.add(parseOpenAPIConfig(ss)) == config);
+    }
+
+    SECTION("Failed fetches are not registered") {
+        transport->getFun = [&](std::string_view) {
+            ++specFetches;
+            return httpcl::IHttpClient::Result{503, {}};
+        };
+        REQUIRE_THROWS(registry.fetch("https://my.server.com/openapi.yaml"));
+        REQUIRE_THROWS(registry.fetch("https://my.server.com/openapi.yaml"));
+        REQUIRE(specFetches == 2);
+    }
+
+    SECTION("Clients keep their own HTTP config") {
+        auto config = registry.fetch("https://my.server.com/openapi.yaml");
+
+        std::vector<std::string> tenants;
+        transport->postFun = [&](std::string_view uri,
+                                 httpcl::OptionalBodyAndContentType const&,
+                                 httpcl::Config const& conf) {
+            REQUIRE(uri == "https://my.server.com/api/post");
+            tenants.emplace_back(conf.headers.find("X-Tenant")->second);
+            return httpcl::IHttpClient::Result{200, {}};
+        };
+
+        httpcl::Config tenantA;
+        tenantA.headers.insert({"X-Tenant", "a"});
+        httpcl::Config tenantB;
+        tenantB.headers.insert({"X-Tenant", "b"});
+
+        OpenAPIClient clientA(config, tenantA, registry.httpClient(), registry.settings());
+        OpenAPIClient clientB(config, tenantB, registry.httpClient(), registry.settings());
+        REQUIRE(clientA.config_ == clientB.config_);
+
+        auto noParameters = [](std::string const&, std::string const&, ParameterValueHelper& helper) {
+            return helper.value(0);
+        };
+        clientA.call("post", noParameters);
+        clientB.call("post", noParameters);
+        REQUIRE(tenants == std::vector<std::string>{"a", "b"});
+    }
+}
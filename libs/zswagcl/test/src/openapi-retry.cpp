@@ -0,0 +1,150 @@
+#include <catch2/catch_all.hpp>
+
+#include <sstream>
+
+#include "zswagcl/private/openapi-client.hpp"
+#include "zswagcl/private/openapi-retry.hpp"
+
+using namespace zswagcl;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+const auto retrySpec = R"yaml(
+openapi: 3.0.1
+servers:
+  - url: https://my.server.com/api
+paths:
+  /get:
+    get:
+      operationId: get
+  /post:
+    post:
+      operationId: post
+  /post/idempotent:
+    post:
+      operationId: idempotentPost
+      x-zswag-idempotent: true
+  /put:
+    put:
+      operationId: put
+      x-zswag-idempotent: false
+)yaml";
+
+}
+
+TEST_CASE("Retry helpers", "[zswagcl::openapi-retry]") {
+    SECTION("Retryable statuses") {
+        REQUIRE(isRetryableStatus(0));
+        REQUIRE(isRetryableStatus(503));
+        REQUIRE_FALSE(isRetryableStatus(500));
+        REQUIRE_FALSE(isRetryableStatus(404));
+    }
+
+    SECTION("Backoff grows exponentially up to the maximum") {
+        httpcl::RetryPolicy policy;
+        policy.initialBackoff = 100ms;
+        policy.maxBackoff = 300ms;
+        for (auto i = 0; i < 100; ++i) {
+            REQUIRE(retryBackoff(policy, 1) <= 100ms);
+            REQUIRE(retryBackoff(policy, 2) <= 200ms);
+            REQUIRE(retryBackoff(policy, 10) <= 300ms);
+        }
+    }
+
+    SECTION("Budget") {
+        RetryBudget budget;
+        for (auto i = 0; i < RetryBudget::MAX_BALANCE; ++i)
+            REQUIRE(budget.withdraw());
+        REQUIRE_FALSE(budget.withdraw());
+
+        for (auto i = 0; i < 9; ++i)
+            budget.deposit(0.1);
+        REQUIRE_FALSE(budget.withdraw());
+        budget.deposit(0.1);
+        REQUIRE(budget.withdraw());
+
+        budget.deposit(100.);
+        REQUIRE(budget.balance() == RetryBudget::MAX_BALANCE);
+    }
+}
+
+TEST_CASE("Retrying idempotent calls", "[zswagcl::openapi-retry]") {
+    std::istringstream ss(retrySpec);
+    auto config = parseOpenAPIConfig(ss);
+
+    std::vector<httpcl::IHttpClient::Result> responses;
+    auto requests = 0u;
+    auto respond = [&] {
+        return requests < responses.size() ? responses[requests++] : (++requests, httpcl::IHttpClient::Result{200, "ok"});
+    };
+    auto client = std::make_unique<httpcl::MockHttpClient>();
+    client->getFun = [&](std::string_view) { return respond(); };
+    client->postFun = [&](std::string_view, httpcl::OptionalBodyAndContentType const&, httpcl::Config const&) { return respond(); };
+
+    httpcl::Config httpConfig;
+    httpConfig.retry = httpcl::RetryPolicy{3, 1ms, 10ms, 0.1};
+    OpenAPIClient oaClient(config, httpConfig, std::move(client));
+    auto noParameters = [](std::string const&, std::string const&, ParameterValueHelper& helper) {
+        return helper.value(0);
+    };
+
+    SECTION("Transient failures are retried") {
+        responses = {{0, {}}, {503, {}}};
+        REQUIRE(oaClient.call("get", noParameters) == "ok");
+        REQUIRE(requests == 3);
+    }
+
+    SECTION("Attempts are limited") {
+        responses = {{502, {}}, {503, {}}, {504, {}}};
+        REQUIRE_THROWS_AS(oaClient.call("get", noParameters), httpcl::IHttpClient::Error);
+        REQUIRE(requests == 3);
+    }
+
+    SECTION("Other errors are not retried") {
+        responses = {{500, {}}};
+        REQUIRE_THROWS_AS(oaClient.call("get", noParameters), httpcl::IHttpClient::Error);
+        REQUIRE(requests == 1);
+    }
+
+    SECTION("Only idempotent operations are retried") {
+        REQUIRE(config.methodPath["get"].isIdempotent());
+        REQUIRE_FALSE(config.methodPath["post"].isIdempotent());
+        REQUIRE(config.methodPath["idempotentPost"].isIdempotent());
+        REQUIRE_FALSE(config.methodPath["put"].isIdempotent());
+
+        responses = {{503, {}}};
+        REQUIRE_THROWS_AS(oaClient.call("post", noParameters), httpcl::IHttpClient::Error);
+        REQUIRE(requests == 1);
+
+        requests = 0;
+        REQUIRE(oaClient.call("idempotentPost", noParameters) == "ok");
+        REQUIRE(requests == 2);
+    }
+
+    SECTION("Long Retry-After is not waited for") {
+        responses = {{503, {}, {{"Retry-After", "60"}}}};
+        REQUIRE_THROWS_AS(oaClient.call("get", noParameters), httpcl::IHttpClient::Error);
+        REQUIRE(requests == 1);
+    }
+
+    SECTION("Retries are limited by the budget") {
+        responses = std::vector<httpcl::IHttpClient::Result>(100, {503, {}});
+        for (auto i = 0; i < 10; ++i)
+            REQUIRE_THROWS(oaClient.call("get", noParameters));
+        // Two retries each for the first five calls use up the budget.
+        REQUIRE(requests == 10 + 10);
+
+        // The deposits of the next five calls pay for one more retry.
+        REQUIRE_THROWS(oaClient.call("get", noParameters));
+        REQUIRE(requests == 11 + 10 + 1);
+    }
+
+    SECTION("Retries are disabled without a policy") {
+        oaClient.httpConfig_.retry.reset();
+        responses = {{503, {}}};
+        REQUIRE_THROWS_AS(oaClient.call("get", noParameters), httpcl::IHttpClient::Error);
+        REQUIRE(requests == 1);
+    }
+}
@@ -0,0 +1,226 @@
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <future>
+#include <sstream>
+#include <thread>
+
+#include "zswagcl/private/openapi-client.hpp"
+#include "zswagcl/private/openapi-single-flight.hpp"
+
+using namespace zswagcl;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+using Result = httpcl::IHttpClient::Result;
+
+const auto singleFlightSpec = R"yaml(
+openapi: 3.0.1
+servers:
+  - url: https://my.server.com/api
+paths:
+  /tile:
+    get:
+      operationId: getTile
+      parameters:
+        - name: id
+          in: query
+          x-zserio-request-part: id
+          schema:
+            format: string
+  /post:
+    post:
+      operationId: post
+)yaml";
+
+/**
+ * Run fun on n threads, and release the gate once all of them
+ * are sending or waiting, as reported by the started predicate.
+ */
+template <class Started, class Fun>
+void runConcurrently(std::size_t n, std::promise<void>& gate, Started&& started, Fun&& fun)
+{
+    std::vector<std::thread> threads;
+    for (auto i = 0u; i < n; ++i)
+        threads.emplace_back([&fun, i] { fun(i); });
+    while (!started())
+        std::this_thread::yield();
+    gate.set_value();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+}
+
+TEST_CASE("Single-flight requests", "[zswagcl::openapi-single-flight]") {
+    SingleFlight singleFlight;
+    std::promise<void> gate;
+    auto opened = gate.get_future().share();
+    std::atomic<int> sends{0};
+    auto send = [&] {
+        ++sends;
+        opened.wait();
+        return Result{200, "tile"};
+    };
+
+    SECTION("Concurrent requests share one response") {
+        std::vector<std::shared_ptr<const Result>> results(8);
+        std::atomic<int> shared{0};
+        auto started = [&] { return sends == 1 && singleFlight.waiting() == results.size() - 1; };
+        runConcurrently(results.size(), gate, started, [&](std::size_t i) {
+            auto isShared = false;
+            results[i] = singleFlight.run("key", send, {}, isShared);
+            shared += isShared;
+        });
+        REQUIRE(sends == 1);
+        REQUIRE(shared == 7);
+        REQUIRE(std::all_of(results.begin(), results.end(), [&](auto const& r) { return r == results[0]; }));
+        REQUIRE(results[0]->content == "tile");
+        REQUIRE(singleFlight.inFlight() == 0);
+        REQUIRE(singleFlight.waiting() == 0);
+
+        // Later requests are sent again.
+        auto isShared = true;
+        REQUIRE(singleFlight.run("key", send, {}, isShared)->content == "tile");
+        REQUIRE_FALSE(isShared);
+        REQUIRE(sends == 2);
+    }
+
+    SECTION("Different keys are sent separately") {
+        runConcurrently(2, gate, [&] { return sends == 2; }, [&](std::size_t i) {
+            auto isShared = false;
+            singleFlight.run(std::to_string(i), send, {}, isShared);
+        });
+        REQUIRE(sends == 2);
+    }
+
+    SECTION("Errors are shared") {
+        std::atomic<int> errors{0};
+        auto fail = [&]() -> Result {
+            ++sends;
+            opened.wait();
+            throw std::runtime_error("failed");
+        };
+        auto started = [&] { return sends == 1 && singleFlight.waiting() == 3; };
+        runConcurrently(4, gate, started, [&](std::size_t) {
+            auto isShared = false;
+            try {
+                singleFlight.run("key", fail, {}, isShared);
+            }
+            catch (std::runtime_error const&) {
+                ++errors;
+            }
+        });
+        REQUIRE(sends == 1);
+        REQUIRE(errors == 4);
+    }
+
+    SECTION("Waiting requests can be cancelled") {
+        std::thread leader([&] {
+            auto isShared = false;
+            singleFlight.run("key", send, {}, isShared);
+        });
+        while (singleFlight.inFlight() == 0)
+            std::this_thread::yield();
+
+        httpcl::Config config;
+        config.cancellation = std::make_shared<httpcl::CancellationToken>();
+        std::thread canceller([&] {
+            std::this_thread::sleep_for(10ms);
+            config.cancellation->cancel();
+        });
+        auto isShared = false;
+        REQUIRE(singleFlight.run("key", send, config, isShared)->status == 0);
+        canceller.join();
+
+        config.cancellation.reset();
+        config.deadline = std::chrono::steady_clock::now() + 10ms;
+        REQUIRE(singleFlight.run("key", send, config, isShared)->status == 0);
+
+        gate.set_value();
+        leader.join();
+        REQUIRE(sends == 1);
+    }
+
+    SECTION("An aborted request is not shared") {
+        httpcl::Config aborted;
+        aborted.cancellation = std::make_shared<httpcl::CancellationToken>();
+        auto abort = [&] {
+            ++sends;
+            opened.wait();
+            aborted.cancellation->cancel();
+            return Result{0, {}};
+        };
+        std::thread leader([&] {
+            auto isShared = false;
+            singleFlight.run("key", abort, aborted, isShared);
+        });
+        while (singleFlight.inFlight() == 0)
+            std::this_thread::yield();
+
+        std::thread opener([&] {
+            std::this_thread::sleep_for(10ms);
+            gate.set_value();
+        });
+        auto isShared = true;
+        REQUIRE(singleFlight.run("key", send, {}, isShared)->status == 200);
+        REQUIRE_FALSE(isShared);
+        REQUIRE(sends == 2);
+        opener.join();
+        leader.join();
+    }
+}
+
+TEST_CASE("Coalesced OpenAPI calls", "[zswagcl::openapi-single-flight]") {
+    std::istringstream ss(singleFlightSpec);
+    auto config = parseOpenAPIConfig(ss);
+
+    std::promise<void> gate;
+    auto opened = gate.get_future().share();
+    std::atomic<int> sends{0};
+    auto transport = std::make_unique<httpcl::MockHttpClient>();
+    transport->getFun = [&](std::string_view uri) {
+        ++sends;
+        opened.wait();
+        return Result{200, std::string(uri.substr(uri.find('=') + 1))};
+    };
+    transport->postFun = [&](std::string_view, httpcl::OptionalBodyAndContentType const&, httpcl::Config const&) {
+        ++sends;
+        opened.wait();
+        return Result{200, {}};
+    };
+
+    httpcl::Config httpConfig;
+    httpConfig.coalesce = true;
+    OpenAPIClient client(config, httpConfig, std::move(transport));
+
+    auto callTile = [&](std::string const& id) {
+        return client.call("getTile", [&](std::string const&, std::string const&, ParameterValueHelper& helper) {
+            return helper.value(id);
+        });
+    };
+
+    SECTION("Identical GET calls share one request") {
+        std::vector<std::string> results(6);
+        auto started = [&] { return sends == 2 && client.metrics().coalescing == 4; };
+        runConcurrently(results.size(), gate, started, [&](std::size_t i) {
+            results[i] = callTile(i % 2 ? "a" : "b");
+        });
+        REQUIRE(sends == 2);
+        REQUIRE(client.metrics().coalesced == 4);
+        REQUIRE(client.metrics().coalescing == 0);
+        REQUIRE(results == std::vector<std::string>{"b", "a", "b", "a", "b", "a"});
+    }
+
+    SECTION("Other methods are not coalesced") {
+        runConcurrently(3, gate, [&] { return sends == 3; }, [&](std::size_t) {
+            client.call("post", [](std::string const&, std::string const&, ParameterValueHelper& helper) {
+                return helper.value(0);
+            });
+        });
+        REQUIRE(sends == 3);
+        REQUIRE(client.metrics().coalesced == 0);
+    }
+}
@@ -0,0 +1,176 @@
+#include <catch2/catch_all.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "zswagcl/private/openapi-parser.hpp"
+#include "zswagcl/private/openapi-snapshot.hpp"
+
+using namespace zswagcl;
+
+namespace
+{
+
+const auto snapshotSpec = R"yaml(
+openapi: 3.0.1
+servers:
+  - url: https://my.server.com:8080/api?v=1
+  - url: https://replica.server.com/api
+components:
+  securitySchemes:
+    basic:
+      type: http
+      scheme: basic
+    key:
+      type: apiKey
+      in: query
+      name: api-key
+    cookie:
+      type: apiKey
+      in: cookie
+      name: session
+security:
+  - basic: []
+  - key: []
+paths:
+  /get/{id}:
+    get:
+      operationId: get
+      x-zswag-body-fallback: getViaBody
+      x-zswag-timeouts:
+        connect: 250
+        total: 5000
+      security:
+        - cookie: []
+          key: []
+      parameters:
+        - name: id
+          in: path
+          style: label
+          explode: true
+          x-zserio-request-part: "id"
+          schema:
+            format: x-zstd-base64url
+        - name: data
+          in: header
+          x-zserio-request-part: "*"
+          schema:
+            format: hex
+  /get/body:
+    post:
+      operationId: getViaBody
+      x-zswag-idempotent: true
+      x-zswag-cache: 60000
+      requestBody:
+        content:
+          application/x-zserio-object:
+            schema:
+              type: string
+)yaml";
+
+auto makeConfig(bool retainContent = true)
+{
+    std::istringstream ss(snapshotSpec);
+    return parseOpenAPIConfig(ss, {retainContent});
+}
+
+auto makeSnapshot(OpenAPIConfig const& config)
+{
+    std::ostringstream ss;
+    writeOpenAPIConfigSnapshot(config, ss);
+    return ss.str();
+}
+
+}
+
+TEST_CASE("OpenAPI config snapshot", "[zswagcl::openapi-snapshot]") {
+    auto config = makeConfig();
+    auto snapshot = makeSnapshot(config);
+    REQUIRE(config.contentHash == openAPIContentHash(snapshotSpec));
+
+    SECTION("Round trip") {
+        auto loaded = readOpenAPIConfigSnapshot(snapshot, config.contentHash);
+        REQUIRE(*loaded.content == snapshotSpec);
+        REQUIRE(loaded.contentHash == config.contentHash);
+        REQUIRE(loaded.uri.build() == config.uri.build());
+        REQUIRE(loaded.uri.port == 8080);
+        REQUIRE(loaded.servers.size() == 2);
+        REQUIRE(loaded.servers[1].build() == "https://replica.server.com/api");
+
+        REQUIRE(loaded.securitySchemes.size() == 3);
+        auto key = std::dynamic_pointer_cast<OpenAPIConfig::APIKeyAuth>(loaded.securitySchemes["key"]);
+        REQUIRE(key);
+        REQUIRE(key->keyName == "api-key");
+        REQUIRE(key->location == OpenAPIConfig::ParameterLocation::Query);
+        REQUIRE(std::dynamic_pointer_cast<OpenAPIConfig::BasicAuth>(loaded.securitySchemes["basic"]));
+        REQUIRE(std::dynamic_pointer_cast<OpenAPIConfig::CookieAuth>(loaded.securitySchemes["cookie"]));
+
+        REQUIRE(loaded.defaultSecurityScheme.size() == 2);
+        REQUIRE(loaded.defaultSecurityScheme[1][0] == loaded.securitySchemes["key"]);
+
+        REQUIRE(loaded.methodPath.size() == 2);
+        auto& get = loaded.methodPath["get"];
+        REQUIRE(get.path == "/get/{id}");
+        REQUIRE(get.httpMethod == "GET");
+        REQUIRE(get.bodyFallback == "getViaBody");
+        REQUIRE(get.timeouts.connect == std::chrono::milliseconds(250));
+        REQUIRE_FALSE(get.timeouts.firstByte);
+        REQUIRE(get.timeouts.total == std::chrono::milliseconds(5000));
+        REQUIRE(get.security);
+        REQUIRE(get.security->size() == 1);
+        REQUIRE((*get.security)[0].size() == 2);
+
+        auto& id = get.parameters["id"];
+        REQUIRE(id.location == OpenAPIConfig::ParameterLocation::Path);
+        REQUIRE(id.field == "id");
+        REQUIRE(id.format == OpenAPIConfig::Parameter::ZstdBase64url);
+        REQUIRE(id.style == OpenAPIConfig::Parameter::Label);
+        REQUIRE(id.explode);
+
+        auto& data = get.parameters["data"];
+        REQUIRE(data.location == OpenAPIConfig::ParameterLocation::Header);
+        REQUIRE(data.field == ZSERIO_REQUEST_PART_WHOLE);
+        REQUIRE(data.format == OpenAPIConfig::Parameter::Hex);
+
+        auto& getViaBody = loaded.methodPath["getViaBody"];
+        REQUIRE(getViaBody.httpMethod == "POST");
+        REQUIRE(getViaBody.bodyRequestObject);
+        REQUIRE_FALSE(getViaBody.security);
+        REQUIRE_FALSE(getViaBody.bodyFallback);
+        REQUIRE(getViaBody.timeouts.empty());
+        REQUIRE(getViaBody.idempotent == true);
+        REQUIRE_FALSE(get.idempotent);
+        REQUIRE(getViaBody.cacheTtl == std::chrono::milliseconds(60000));
+        REQUIRE_FALSE(get.cacheTtl);
+    }
+
+    SECTION("Skip content") {
+        REQUIRE_FALSE(readOpenAPIConfigSnapshot(snapshot, {}, false).content);
+
+        auto withoutContent = makeConfig(false);
+        REQUIRE_FALSE(withoutContent.content);
+        REQUIRE(withoutContent.contentHash == config.contentHash);
+        REQUIRE(makeSnapshot(withoutContent).size() < snapshot.size());
+    }
+
+    SECTION("Load from file") {
+        auto path = std::string("zswagcl-test-snapshot.bin");
+        std::ofstream(path, std::ios::binary) << snapshot;
+        auto loaded = loadOpenAPIConfigSnapshot(path, config.contentHash);
+        std::remove(path.c_str());
+        REQUIRE(loaded.methodPath.size() == 2);
+    }
+
+    SECTION("Reject outdated snapshot") {
+        REQUIRE_THROWS(readOpenAPIConfigSnapshot(snapshot, config.contentHash + 1));
+    }
+
+    SECTION("Reject truncated snapshot") {
+        REQUIRE_THROWS(readOpenAPIConfigSnapshot(snapshot.substr(0, snapshot.size() - 1)));
+    }
+
+    SECTION("Reject other data") {
+        REQUIRE_THROWS(readOpenAPIConfigSnapshot(snapshotSpec));
+    }
+}